@@ -27,6 +27,7 @@ public class OnlineSubsystemEpic : ModuleRules
                 "OnlineSubsystem",
                 "Json",
                 "Sockets",
+                "Networking",
                 "Projects",
             }
         );
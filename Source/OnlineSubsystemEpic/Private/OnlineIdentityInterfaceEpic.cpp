@@ -3,7 +3,11 @@
 #include "OnlineSubsystemEpic.h"
 #include "OnlineError.h"
 #include "Utilities.h"
+#include "OperationContextPoolEpic.h"
 #include "HAL/UnrealMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ConfigCacheIni.h"
+#include "HAL/PlatformMisc.h"
 
 #include "eos_sdk.h"
 #include "eos_types.h"
@@ -106,21 +110,59 @@ typedef struct FLoginCompleteAdditionalData
 	FOnlineIdentityInterfaceEpic* IdentityInterface;
 	int32 LocalUserNum;
 	EOS_EpicAccountId EpicAccountId;
+	uint64 BatchId;
+	bool bIsDeviceIdLogin;
 } FAuthLoginCompleteAdditionalData;
 
 typedef struct FCreateUserAdditionalData
 {
 	FOnlineIdentityInterfaceEpic* IdentityInterface;
 	int32 LocalUserNum;
+	uint64 BatchId;
 } FCreateUserAdditionalData;
 
+typedef struct FCreateDeviceIdAdditionalData
+{
+	FOnlineIdentityInterfaceEpic* IdentityInterface;
+} FCreateDeviceIdAdditionalData;
+
+typedef struct FLogoutAdditionalData
+{
+	FOnlineIdentityInterfaceEpic* IdentityInterface;
+} FLogoutAdditionalData;
+
+typedef struct FTokenRefreshAdditionalData
+{
+	FOnlineIdentityInterfaceEpic* IdentityInterface;
+	EOS_ProductUserId ProductUserId;
+	EOS_EpicAccountId EpicAccountId;
+} FTokenRefreshAdditionalData;
+
+/** Contexts of the running operations, passed to the EOS SDK as client data */
+static TOperationContextPoolEpic<FLoginCompleteAdditionalData> LoginContexts(TEXT("Login"));
+static TOperationContextPoolEpic<FCreateUserAdditionalData> CreateUserContexts(TEXT("CreateUser"));
+static TOperationContextPoolEpic<FCreateDeviceIdAdditionalData> CreateDeviceIdContexts(TEXT("CreateDeviceId"));
+static TOperationContextPoolEpic<FLogoutAdditionalData> LogoutContexts(TEXT("Logout"));
+static TOperationContextPoolEpic<FTokenRefreshAdditionalData> TokenRefreshContexts(TEXT("TokenRefresh"));
+
 // -----------------------------
 // EOS Callbacks
 // -----------------------------
 void FOnlineIdentityInterfaceEpic::EOS_Auth_OnLoginComplete(EOS_Auth_LoginCallbackInfo const* Data)
 {
+	// The callback is called again once the login completed, e.g. while a device code is waiting to be entered
+	if (!EOS_EResult_IsOperationComplete(Data->ResultCode))
+	{
+		UE_CLOG_ONLINE_IDENTITY(Data->PinGrantInfo, Display, TEXT("[EOS SDK] Waiting for code \"%s\" to be entered at %s"), UTF8_TO_TCHAR(Data->PinGrantInfo->UserCode), UTF8_TO_TCHAR(Data->PinGrantInfo->VerificationURI));
+		return;
+	}
+
 	// To raise the login complete delegates the interface itself has to be retrieved from the returned data
-	FLoginCompleteAdditionalData* additionalData = (FLoginCompleteAdditionalData*)Data->ClientData;
+	TOptional<FLoginCompleteAdditionalData> additionalData = LoginContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
 
 	FOnlineIdentityInterfaceEpic* thisPtr = additionalData->IdentityInterface;
 	check(thisPtr);
@@ -129,7 +171,8 @@ void FOnlineIdentityInterfaceEpic::EOS_Auth_OnLoginComplete(EOS_Auth_LoginCallba
 
 	if (Data->ResultCode == EOS_EResult::EOS_Success)
 	{
-		EOS_EpicAccountId eosId = EOS_Auth_GetLoggedInAccountByIndex(thisPtr->authHandle, additionalData->LocalUserNum);
+		// The SDK's account indices follow the login order, which differs from the local user numbers once users log in in parallel
+		EOS_EpicAccountId eosId = Data->LocalUserId;
 		if (EOS_EpicAccountId_IsValid(eosId))
 		{
 			EOS_Auth_Token* authToken = nullptr;
@@ -150,12 +193,15 @@ void FOnlineIdentityInterfaceEpic::EOS_Auth_OnLoginComplete(EOS_Auth_LoginCallba
 				nullptr
 			};
 
-			FLoginCompleteAdditionalData* newAdditionalData = new FLoginCompleteAdditionalData{
+			void* clientData = LoginContexts.Add(thisPtr, FLoginCompleteAdditionalData{
 				thisPtr,
 				additionalData->LocalUserNum,
-				eosId
-			};
-			EOS_Connect_Login(thisPtr->connectHandle, &loginOptions, newAdditionalData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete);
+				eosId,
+				additionalData->BatchId,
+				false
+			});
+			thisPtr->ReportLoginProgress(additionalData->BatchId, additionalData->LocalUserNum, EBatchLoginStepEpic::ConnectLogin);
+			EOS_Connect_Login(thisPtr->connectHandle, &loginOptions, clientData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete);
 
 			// Release the auth token
 			EOS_Auth_Token_Release(authToken);
@@ -174,15 +220,17 @@ void FOnlineIdentityInterfaceEpic::EOS_Auth_OnLoginComplete(EOS_Auth_LoginCallba
 	if (!error.IsEmpty())
 	{
 		UE_LOG_ONLINE_IDENTITY(Warning, TEXT("Epic Account Service Login failed. Message:\r\n    %s"), *error);
-		thisPtr->TriggerOnLoginCompleteDelegates(INDEX_NONE, false, FUniqueNetIdEpic(), error);
+		thisPtr->CompleteLogin(additionalData->LocalUserNum, additionalData->BatchId, false, FUniqueNetIdEpic(), error);
 	}
-
-	delete(additionalData);
 }
 
 void FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete(EOS_Connect_LoginCallbackInfo const* Data)
 {
-	FLoginCompleteAdditionalData* additionalData = (FLoginCompleteAdditionalData*)Data->ClientData;
+	TOptional<FLoginCompleteAdditionalData> additionalData = LoginContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
 
 	FOnlineIdentityInterfaceEpic* thisPtr = additionalData->IdentityInterface;
 	check(thisPtr);
@@ -201,8 +249,38 @@ void FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete(EOS_Connect_Login
 		}
 
 		userId = FUniqueNetIdEpic(Data->LocalUserId, additionalData->EpicAccountId);
-		//Added a pretty print for the user ID here as the log before was spitting undefined characters - Mike
-		UE_LOG_ONLINE_IDENTITY(Display, TEXT("Finished logging in user \"%s\""), *userId.ToDebugString());
+		if (thisPtr->AssignLocalUser(additionalData->LocalUserNum, Data->LocalUserId, additionalData->EpicAccountId, error))
+		{
+			thisPtr->UpdateLocalUserIds();
+
+			// A login of a user that's already logged in refreshes their tokens.
+			// The refresh can only be scheduled once the user has their local user number
+			thisPtr->InvalidateUserAccounts(Data->LocalUserId);
+			thisPtr->FinishTokenRefresh(Data->LocalUserId, true);
+			//Added a pretty print for the user ID here as the log before was spitting undefined characters - Mike
+			UE_LOG_ONLINE_IDENTITY(Display, TEXT("Finished logging in user \"%s\""), *userId.ToDebugString());
+		}
+		else if (additionalData->bIsDeviceIdLogin)
+		{
+			// All device id logins of a device end up as the same product user
+			error += TEXT(" The device id is already used by another local user, use a different credential type for additional users.");
+		}
+	}
+	else if (eosResult == EOS_EResult::EOS_InvalidUser && additionalData->bIsDeviceIdLogin && Data->ContinuanceToken)
+	{
+		// Headless logins can't ask anyone, the device id gets a new product user right away
+		EOS_Connect_CreateUserOptions createUserOptions = {
+			EOS_CONNECT_CREATEUSER_API_LATEST,
+			Data->ContinuanceToken
+		};
+		void* clientData = CreateUserContexts.Add(thisPtr, FCreateUserAdditionalData{
+			thisPtr,
+			additionalData->LocalUserNum,
+			additionalData->BatchId
+		});
+		thisPtr->ReportLoginProgress(additionalData->BatchId, additionalData->LocalUserNum, EBatchLoginStepEpic::CreateUser);
+		EOS_Connect_CreateUser(thisPtr->connectHandle, &createUserOptions, clientData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnUserCreated);
+		return;
 	}
 	else if (eosResult == EOS_EResult::EOS_InvalidUser)
 	{
@@ -214,7 +292,7 @@ void FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete(EOS_Connect_Login
 			// login indication.
 			UE_LOG_ONLINE_IDENTITY(Display, TEXT("[EOS SDK] Got invalid user and contiuance token."));
 			FUniqueNetIdString continuanceToken = FUniqueNetIdString(UTF8_TO_TCHAR(Data->ContinuanceToken));
-			thisPtr->TriggerOnLoginCompleteDelegates(additionalData->LocalUserNum, false, continuanceToken, TEXT(""));
+			thisPtr->CompleteLogin(additionalData->LocalUserNum, additionalData->BatchId, false, continuanceToken, TEXT(""));
 		}
 		else
 		{
@@ -229,21 +307,24 @@ void FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete(EOS_Connect_Login
 	if (!error.IsEmpty())
 	{
 		UE_LOG_ONLINE_IDENTITY(Warning, TEXT("%s encountered an error. Message:\r\n    %s"), *FString(__FUNCTION__), *error);
-		thisPtr->TriggerOnLoginCompleteDelegates(additionalData->LocalUserNum, false, FUniqueNetIdEpic(), error);
+		thisPtr->CompleteLogin(additionalData->LocalUserNum, additionalData->BatchId, false, FUniqueNetIdEpic(), error);
 	}
-	else
+	else if (eosResult == EOS_EResult::EOS_Success)
 	{
-		thisPtr->TriggerOnLoginCompleteDelegates(additionalData->LocalUserNum, true, userId, TEXT(""));
+		thisPtr->CompleteLogin(additionalData->LocalUserNum, additionalData->BatchId, true, userId, TEXT(""));
 	}
-
-	delete(additionalData);
 }
 
 void FOnlineIdentityInterfaceEpic::EOS_Connect_OnAuthExpiration(EOS_Connect_AuthExpirationCallbackInfo const* Data)
 {
-	// ToDo: Make the user see this.
 	FString localUser = FUniqueNetIdEpic::ProductUserIdToString(Data->LocalUserId);
-	UE_LOG_ONLINE_IDENTITY(Display, TEXT("Auth for user \"%s\" expired"), *localUser);
+	UE_LOG_ONLINE_IDENTITY(Display, TEXT("Auth for user \"%s\" is about to expire"), *localUser);
+
+	// The notification arrives shortly before the Connect token expires.
+	// Usually the token was already refreshed ahead of time, otherwise it's refreshed now
+	FOnlineIdentityInterfaceEpic* thisPtr = (FOnlineIdentityInterfaceEpic*)Data->ClientData;
+	thisPtr->InvalidateUserAccounts(Data->LocalUserId);
+	thisPtr->StartTokenRefresh(Data->LocalUserId);
 }
 
 void FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginStatusChanged(EOS_Connect_LoginStatusChangedCallbackInfo const* Data)
@@ -258,14 +339,42 @@ void FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginStatusChanged(EOS_Connect_
 	// ToDo: Somehow this always crashes
 	//UE_LOG_ONLINE_IDENTITY(Display, TEXT("[EOS SDK] Login status changed.\r\n%9s: %s\r\n%9s: %s\r\n%9s: %s"), TEXT("User"), *localUser, TEXT("New State"), *ELoginStatus::ToString(newStatus), TEXT("Old State"), *ELoginStatus::ToString(oldStatus));
 
+	// A user that logged out is only found before the table is updated, a user that logged in only afterwards
 	FUniqueNetIdEpic netId = FUniqueNetIdEpic(Data->LocalUserId);
 	FPlatformUserId localUserNum = thisPtr->GetPlatformUserIdFromUniqueNetId(netId);
+	thisPtr->UpdateLocalUserIds();
+	thisPtr->InvalidateUserAccounts(Data->LocalUserId);
+	if (localUserNum == PLATFORMUSERID_NONE)
+	{
+		localUserNum = thisPtr->GetPlatformUserIdFromUniqueNetId(netId);
+	}
+
+	// Tokens of users that aren't logged in anymore can't be refreshed
+	if (Data->CurrentStatus != EOS_ELoginStatus::EOS_LS_LoggedIn)
+	{
+		thisPtr->StopTokenRefresh(Data->LocalUserId);
+	}
 
 	thisPtr->TriggerOnLoginStatusChangedDelegates(localUserNum, oldStatus, newStatus, netId);
 }
 
+void FOnlineIdentityInterfaceEpic::EOS_Auth_OnLoginStatusChanged(EOS_Auth_LoginStatusChangedCallbackInfo const* Data)
+{
+	// The epic account ids are part of the local user ids and accounts.
+	// Accounts are keyed by product user id, so all of them are dropped
+	FOnlineIdentityInterfaceEpic* thisPtr = (FOnlineIdentityInterfaceEpic*)Data->ClientData;
+	thisPtr->UpdateLocalUserIds();
+	thisPtr->InvalidateUserAccounts();
+}
+
 void FOnlineIdentityInterfaceEpic::EOS_Auth_OnLogoutComplete(const EOS_Auth_LogoutCallbackInfo* Data)
 {
+	TOptional<FLogoutAdditionalData> additionalData = LogoutContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
 	if (Data->ResultCode != EOS_EResult::EOS_Success)
 	{
 		char const* resultStr = EOS_EResult_ToString(Data->ResultCode);
@@ -273,11 +382,13 @@ void FOnlineIdentityInterfaceEpic::EOS_Auth_OnLogoutComplete(const EOS_Auth_Logo
 		return;
 	}
 
-	FOnlineIdentityInterfaceEpic* thisPtr = (FOnlineIdentityInterfaceEpic*)Data->ClientData;
+	FOnlineIdentityInterfaceEpic* thisPtr = additionalData->IdentityInterface;
 	check(thisPtr);
 
 	EOS_ProductUserId puid = FUniqueNetIdEpic::ProductUserIDFromString(UTF8_TO_TCHAR(Data->LocalUserId));
 	int32 idIdx = thisPtr->GetPlatformUserIdFromUniqueNetId(FUniqueNetIdEpic(puid));
+	thisPtr->UpdateLocalUserIds();
+	thisPtr->InvalidateUserAccounts();
 
 	thisPtr->TriggerOnLogoutCompleteDelegates(idIdx, true);
 	FString localUser = FUniqueNetIdEpic::EpicAccountIdToString(Data->LocalUserId);
@@ -286,23 +397,40 @@ void FOnlineIdentityInterfaceEpic::EOS_Auth_OnLogoutComplete(const EOS_Auth_Logo
 
 void FOnlineIdentityInterfaceEpic::EOS_Connect_OnUserCreated(EOS_Connect_CreateUserCallbackInfo const* Data)
 {
-	FCreateUserAdditionalData* additionalData = static_cast<FCreateUserAdditionalData*>(Data->ClientData);
+	TOptional<FCreateUserAdditionalData> additionalData = CreateUserContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
 	FOnlineIdentityInterfaceEpic* thisPtr = additionalData->IdentityInterface;
 	check(thisPtr);
 
 	if (Data->ResultCode != EOS_EResult::EOS_Success)
 	{
 		char const* resultStr = EOS_EResult_ToString(Data->ResultCode);
-		FString error = FString::Printf(TEXT("[EOS SDK] Create User Failed - Result : %s"), UTF8_TO_TCHAR(Data->LocalUserId), resultStr);
-		thisPtr->TriggerOnLoginCompleteDelegates(additionalData->LocalUserNum, false, FUniqueNetIdEpic(), error);
+		FString error = FString::Printf(TEXT("[EOS SDK] Create User Failed - Result : %s"), UTF8_TO_TCHAR(resultStr));
+		thisPtr->CompleteLogin(additionalData->LocalUserNum, additionalData->BatchId, false, FUniqueNetIdEpic(), error);
 		return;
 	}
 	
 	// Creating a user always means we're not using an epic account
 	FUniqueNetIdEpic userId = FUniqueNetIdEpic(Data->LocalUserId);
-	UE_LOG_ONLINE_IDENTITY(Display, TEXT("Finished creating user \"%s\""), UTF8_TO_TCHAR(Data->LocalUserId));
+	UE_LOG_ONLINE_IDENTITY(Display, TEXT("Finished creating user \"%s\""), *userId.ToDebugString());
+
+	FString error;
+	if (!thisPtr->AssignLocalUser(additionalData->LocalUserNum, Data->LocalUserId, nullptr, error))
+	{
+		UE_LOG_ONLINE_IDENTITY(Warning, TEXT("%s encountered an error. Message:\r\n    %s"), *FString(__FUNCTION__), *error);
+		thisPtr->CompleteLogin(additionalData->LocalUserNum, additionalData->BatchId, false, FUniqueNetIdEpic(), error);
+		return;
+	}
+	thisPtr->UpdateLocalUserIds();
 
-	thisPtr->TriggerOnLoginCompleteDelegates(additionalData->LocalUserNum, true, userId, TEXT(""));
+	// Creating the user logged them in as well
+	thisPtr->FinishTokenRefresh(Data->LocalUserId, true);
+
+	thisPtr->CompleteLogin(additionalData->LocalUserNum, additionalData->BatchId, true, userId, TEXT(""));
 }
 
 void FOnlineIdentityInterfaceEpic::EOS_Connect_OnAccountLinked(EOS_Connect_LinkAccountCallbackInfo const* Data)
@@ -310,11 +438,90 @@ void FOnlineIdentityInterfaceEpic::EOS_Connect_OnAccountLinked(EOS_Connect_LinkA
 	// ToDo: Implement a way to notify the user that an account was linked
 }
 
+void FOnlineIdentityInterfaceEpic::EOS_Connect_OnDeviceIdCreated(EOS_Connect_CreateDeviceIdCallbackInfo const* Data)
+{
+	TOptional<FCreateDeviceIdAdditionalData> additionalData = CreateDeviceIdContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
+	FOnlineIdentityInterfaceEpic* thisPtr = additionalData->IdentityInterface;
+	check(thisPtr);
+
+	// A device id created earlier, e.g. by another process, is just as good
+	bool const bDeviceIdExists = Data->ResultCode == EOS_EResult::EOS_Success || Data->ResultCode == EOS_EResult::EOS_DuplicateNotAllowed;
+	UE_CLOG_ONLINE_IDENTITY(!bDeviceIdExists, Warning, TEXT("[EOS SDK] Creating device id failed - Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
+	thisPtr->deviceIdState = bDeviceIdExists ? EDeviceIdState::Created : EDeviceIdState::Unknown;
+
+	TArray<TFunction<void(bool)>> waiters = MoveTemp(thisPtr->deviceIdWaiters);
+	for (TFunction<void(bool)>& waiter : waiters)
+	{
+		waiter(bDeviceIdExists);
+	}
+}
+
+void FOnlineIdentityInterfaceEpic::EOS_Auth_OnTokenRefreshed(EOS_Auth_LoginCallbackInfo const* Data)
+{
+	if (!EOS_EResult_IsOperationComplete(Data->ResultCode))
+	{
+		return;
+	}
+
+	TOptional<FTokenRefreshAdditionalData> additionalData = TokenRefreshContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
+	FOnlineIdentityInterfaceEpic* thisPtr = additionalData->IdentityInterface;
+	check(thisPtr);
+
+	// With a new auth token, the Connect token is renewed next
+	if (Data->ResultCode != EOS_EResult::EOS_Success)
+	{
+		UE_LOG_ONLINE_IDENTITY(Warning, TEXT("[EOS SDK] Refreshing auth token failed - Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
+		thisPtr->FinishTokenRefresh(additionalData->ProductUserId, false);
+	}
+	else if (!thisPtr->RefreshConnectToken(additionalData->ProductUserId, additionalData->EpicAccountId))
+	{
+		thisPtr->FinishTokenRefresh(additionalData->ProductUserId, false);
+	}
+}
+
+void FOnlineIdentityInterfaceEpic::EOS_Connect_OnTokenRefreshed(EOS_Connect_LoginCallbackInfo const* Data)
+{
+	TOptional<FTokenRefreshAdditionalData> additionalData = TokenRefreshContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
+	FOnlineIdentityInterfaceEpic* thisPtr = additionalData->IdentityInterface;
+	check(thisPtr);
+
+	bool const bWasSuccessful = Data->ResultCode == EOS_EResult::EOS_Success;
+	UE_CLOG_ONLINE_IDENTITY(!bWasSuccessful, Warning, TEXT("[EOS SDK] Refreshing Connect token failed - Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
+	if (bWasSuccessful)
+	{
+		thisPtr->InvalidateUserAccounts(additionalData->ProductUserId);
+	}
+	thisPtr->FinishTokenRefresh(additionalData->ProductUserId, bWasSuccessful);
+}
+
 //-------------------------------
 // FOnlineIdentityInterfaceEpic
 //-------------------------------
 FOnlineIdentityInterfaceEpic::FOnlineIdentityInterfaceEpic(FOnlineSubsystemEpic* inSubsystem)
 	: subsystemEpic(inSubsystem)
+	, lastBatchLoginId(0)
+	, loginBatchWindow(16)
+	, deviceIdState(EDeviceIdState::Unknown)
+	, refreshTimers(1.0)
+	, connectTokenLifetime(3600.0)
+	, tokenRefreshLead(900.0)
+	, tokenRefreshJitter(60.0)
+	, tokenRefreshTimeout(30.0)
 {
 	this->authHandle = EOS_Platform_GetAuthInterface(inSubsystem->PlatformHandle);
 	this->connectHandle = EOS_Platform_GetConnectInterface(inSubsystem->PlatformHandle);
@@ -328,15 +535,47 @@ FOnlineIdentityInterfaceEpic::FOnlineIdentityInterfaceEpic(FOnlineSubsystemEpic*
 		EOS_CONNECT_ADDNOTIFYLOGINSTATUSCHANGED_API_LATEST
 	};
 	this->notifyLoginStatusChangedId = EOS_Connect_AddNotifyLoginStatusChanged(this->connectHandle, &loginStatusChangedOptions, this, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginStatusChanged);
+
+	EOS_Auth_AddNotifyLoginStatusChangedOptions authLoginStatusChangedOptions = {
+		EOS_AUTH_ADDNOTIFYLOGINSTATUSCHANGED_API_LATEST
+	};
+	this->notifyAuthLoginStatusChangedId = EOS_Auth_AddNotifyLoginStatusChanged(this->authHandle, &authLoginStatusChangedOptions, this, &FOnlineIdentityInterfaceEpic::EOS_Auth_OnLoginStatusChanged);
+
+	// Bot hosts log in more users than there are local players
+	int32 maxLocalUsers = MAX_LOCAL_PLAYERS;
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("MaxLocalUsers"), maxLocalUsers, GEngineIni);
+	this->localUserIds.SetNum(FMath::Max(1, maxLocalUsers));
+	this->UpdateLocalUserIds();
+
+	// Batched logins run this many logins in parallel
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("LoginBatchWindow"), this->loginBatchWindow, GEngineIni);
+	this->loginBatchWindow = FMath::Max(1, this->loginBatchWindow);
+
+	// Tokens are refreshed this long ahead of their expiry, moved forward by a random part of the jitter
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("ConnectTokenLifetime"), this->connectTokenLifetime, GEngineIni);
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("TokenRefreshLead"), this->tokenRefreshLead, GEngineIni);
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("TokenRefreshJitter"), this->tokenRefreshJitter, GEngineIni);
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("TokenRefreshTimeout"), this->tokenRefreshTimeout, GEngineIni);
+	this->tokenRefreshJitter = FMath::Max(0.0, this->tokenRefreshJitter);
+	this->tokenRefreshTimeout = FMath::Max(1.0, this->tokenRefreshTimeout);
 }
 
 FOnlineIdentityInterfaceEpic::~FOnlineIdentityInterfaceEpic()
 {
 	EOS_Connect_RemoveNotifyLoginStatusChanged(this->connectHandle, this->notifyLoginStatusChangedId);
 	EOS_Connect_RemoveNotifyAuthExpiration(this->connectHandle, this->notifyAuthExpiration);
+	EOS_Auth_RemoveNotifyLoginStatusChanged(this->authHandle, this->notifyAuthLoginStatusChangedId);
+
+	// Logins still running can't reach this instance anymore
+	FOperationContextPoolEpic::ReleaseAll(this);
 }
 
 bool FOnlineIdentityInterfaceEpic::Login(int32 LocalUserNum, const FOnlineAccountCredentials& AccountCredentials)
+{
+	return this->StartLogin(LocalUserNum, AccountCredentials, 0);
+}
+
+bool FOnlineIdentityInterfaceEpic::StartLogin(int32 LocalUserNum, FOnlineAccountCredentials const& AccountCredentials, uint64 BatchId)
 {
 	// The account credentials struct has the following format
 	// The "Type" field is a string that encodes the login system and login type for that system.
@@ -356,20 +595,22 @@ bool FOnlineIdentityInterfaceEpic::Login(int32 LocalUserNum, const FOnlineAccoun
 	// |           | Persistent Auth          | N / A                                           |
 	// |           | External Auth            | External System -> Id, External Token -> Token  |
 	// | CONNECT   | Apple, Nintendo (NSA)    | Display Name -> Id                              |
+	// |           | Device Id                | Display Name -> Id (optional)                   |
 	// |           | Other                    | N / A                                           |
 
 
 	FString error;
 	bool success = false;
 
-	if (0 <= LocalUserNum && LocalUserNum < MAX_LOCAL_PLAYERS)
+	if (this->localUserIds.IsValidIndex(LocalUserNum))
 	{
 		// Check if we are using the epic account system or plain connect
 		FString left, right;
 		AccountCredentials.Type.Split(TEXT(":"), &left, &right);
 		if (left.Equals(TEXT("EAS"), ESearchCase::IgnoreCase))
 		{
-			EOS_EpicAccountId eosId = EOS_Auth_GetLoggedInAccountByIndex(this->authHandle, LocalUserNum);
+			// The SDK's account indices don't match the local user numbers, the table does
+			EOS_EpicAccountId eosId = this->localUserIds[LocalUserNum] ? this->localUserIds[LocalUserNum]->ToEpicAccountId() : nullptr;
 
 			// If we already have a valid EAID, we can go straight to connect
 			if (EOS_EpicAccountId_IsValid(eosId))
@@ -391,12 +632,15 @@ bool FOnlineIdentityInterfaceEpic::Login(int32 LocalUserNum, const FOnlineAccoun
 					&connectCrendentials,
 					nullptr
 				};
-				FLoginCompleteAdditionalData* additionalData = new FLoginCompleteAdditionalData{
+				void* clientData = LoginContexts.Add(this, FLoginCompleteAdditionalData{
 					this,
 					LocalUserNum,
-					nullptr
-				};
-				EOS_Connect_Login(this->connectHandle, &loginOptions, additionalData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete);
+					eosId,
+					BatchId,
+					false
+				});
+				this->ReportLoginProgress(BatchId, LocalUserNum, EBatchLoginStepEpic::ConnectLogin);
+				EOS_Connect_Login(this->connectHandle, &loginOptions, clientData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete);
 
 				// Release the auth token
 				EOS_Auth_Token_Release(authToken);
@@ -495,11 +739,15 @@ bool FOnlineIdentityInterfaceEpic::Login(int32 LocalUserNum, const FOnlineAccoun
 				loginOpts.ScopeFlags = EOS_EAuthScopeFlags::EOS_AS_BasicProfile | EOS_EAuthScopeFlags::EOS_AS_FriendsList | EOS_EAuthScopeFlags::EOS_AS_Presence;
 				loginOpts.Credentials = &credentials;
 
-				FLoginCompleteAdditionalData* additionalData = new FLoginCompleteAdditionalData{
+				void* clientData = LoginContexts.Add(this, FLoginCompleteAdditionalData{
 					this,
-					LocalUserNum
-				};
-				EOS_Auth_Login(authHandle, &loginOpts, additionalData, &FOnlineIdentityInterfaceEpic::EOS_Auth_OnLoginComplete);
+					LocalUserNum,
+					nullptr,
+					BatchId,
+					false
+				});
+				this->ReportLoginProgress(BatchId, LocalUserNum, EBatchLoginStepEpic::AuthLogin);
+				EOS_Auth_Login(authHandle, &loginOpts, clientData, &FOnlineIdentityInterfaceEpic::EOS_Auth_OnLoginComplete);
 			}
 			success = true;
 		}
@@ -513,11 +761,11 @@ bool FOnlineIdentityInterfaceEpic::Login(int32 LocalUserNum, const FOnlineAccoun
 				//	EOS_CONNECT_CREATEUSER_API_LATEST,
 				//	TCHAR_TO_UTF8(*AccountCredentials.Token)
 				//};
-				//FCreateUserAdditionalData* additionalData = new FCreateUserAdditionalData{
+				//void* clientData = CreateUserContexts.Add(this, FCreateUserAdditionalData{
 				//	this,
 				//	LocalUserNum
-				//};
-				//EOS_Connect_CreateUser(this->connectHandle, &createUserOptions, this, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnUserCreated);
+				//});
+				//EOS_Connect_CreateUser(this->connectHandle, &createUserOptions, clientData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnUserCreated);
 			}
 			else if (right.Equals(TEXT("Link"), ESearchCase::IgnoreCase))
 			{
@@ -542,7 +790,14 @@ bool FOnlineIdentityInterfaceEpic::Login(int32 LocalUserNum, const FOnlineAccoun
 				EOS_EExternalCredentialType externalType = externalTypeTuple.Get<0>();
 
 				// Make sure we have a valid connect type
-				if (externalTypeTuple.Get<1>())
+				if (externalTypeTuple.Get<1>() && externalType == EOS_EExternalCredentialType::EOS_ECT_DEVICEID_ACCESS_TOKEN)
+				{
+					// Device ids need no token, the display name is made up if none was given
+					FString const displayName = AccountCredentials.Id.IsEmpty() ? FString::Printf(TEXT("Player%d"), LocalUserNum) : AccountCredentials.Id;
+					this->LoginWithDeviceId(LocalUserNum, displayName, BatchId);
+					success = true;
+				}
+				else if (externalTypeTuple.Get<1>())
 				{
 					EOS_Connect_Credentials connectCrendentials = {
 						   EOS_CONNECT_CREDENTIALS_API_LATEST,
@@ -576,12 +831,15 @@ bool FOnlineIdentityInterfaceEpic::Login(int32 LocalUserNum, const FOnlineAccoun
 						};
 					}
 
-					FLoginCompleteAdditionalData* additionalData = new FLoginCompleteAdditionalData{
+					void* clientData = LoginContexts.Add(this, FLoginCompleteAdditionalData{
 						this,
 						LocalUserNum,
-						nullptr // Since this is the connect login flow, no EAID is available
-					};
-					EOS_Connect_Login(this->connectHandle, &loginOptions, additionalData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete);
+						nullptr, // Since this is the connect login flow, no EAID is available
+						BatchId,
+						false
+					});
+					this->ReportLoginProgress(BatchId, LocalUserNum, EBatchLoginStepEpic::ConnectLogin);
+					EOS_Connect_Login(this->connectHandle, &loginOptions, clientData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete);
 
 					success = true;
 				}
@@ -602,18 +860,36 @@ bool FOnlineIdentityInterfaceEpic::Login(int32 LocalUserNum, const FOnlineAccoun
 	}
 	else
 	{
-		error = FString::Printf(TEXT("\"%d\" is outside the range of allowed user indices [0 - %d["), LocalUserNum, MAX_LOCAL_PLAYERS);
+		error = FString::Printf(TEXT("\"%d\" is outside the range of allowed user indices [0 - %d["), LocalUserNum, this->localUserIds.Num());
 	}
 
-	if (!success)
+	if (success)
+	{
+		this->loggingInUserNums.Add(LocalUserNum);
+	}
+	else
 	{
 		UE_CLOG_ONLINE_IDENTITY(!error.IsEmpty(), Warning, TEXT("%s encountered an error. Message:\r\n    %s"), *FString(__FUNCTION__), *error);
-		this->TriggerOnLoginCompleteDelegates(LocalUserNum, false, FUniqueNetIdEpic(), error);
+		this->CompleteLogin(LocalUserNum, BatchId, false, FUniqueNetIdEpic(), error);
 	}
 
 	return success;
 }
 
+uint64 FOnlineIdentityInterfaceEpic::LoginMultiple(TArray<TPair<int32, FOnlineAccountCredentials>> const& Logins)
+{
+	uint64 const batchId = ++this->lastBatchLoginId;
+
+	FBatchLoginEpic& batch = this->batchLogins.Add(batchId);
+	batch.Logins = Logins;
+	batch.StartTime = FPlatformTime::Seconds();
+
+	UE_LOG_ONLINE_IDENTITY(Log, TEXT("Logging in %d users in batch %llu"), Logins.Num(), batchId);
+	this->StartBatchLogins(batchId);
+
+	return batchId;
+}
+
 bool FOnlineIdentityInterfaceEpic::AutoLogin(int32 LocalUserNum)
 {
 	FOnlineAccountCredentials credentials;
@@ -642,14 +918,12 @@ TArray<TSharedPtr<FUserOnlineAccount>> FOnlineIdentityInterfaceEpic::GetAllUserA
 {
 	TArray<TSharedPtr< FUserOnlineAccount>> accounts;
 
-	int32 loggedInCount = EOS_Connect_GetLoggedInUsersCount(this->connectHandle);
-	for (int32 i = 0; i < loggedInCount; ++i)
+	for (TSharedPtr<FUniqueNetIdEpic const> const& localUserId : this->localUserIds)
 	{
-		EOS_ProductUserId puid = EOS_Connect_GetLoggedInUserByIndex(this->connectHandle, i);
-
-		TSharedPtr<FUserOnlineAccount> userAccount = this->OnlineUserAcccountFromPUID(puid);
-
-		accounts.Add(userAccount);
+		if (localUserId)
+		{
+			accounts.Add(this->GetCachedUserAccount(localUserId->ToProductUserId()));
+		}
 	}
 	return accounts;
 }
@@ -659,7 +933,7 @@ TSharedPtr<FUserOnlineAccount> FOnlineIdentityInterfaceEpic::GetUserAccount(cons
 	TSharedRef<FUniqueNetIdEpic const> epicNetId = StaticCastSharedRef<FUniqueNetIdEpic const>(UserId.AsShared());
 	EOS_ProductUserId puid = epicNetId->ToProductUserId();
 
-	return this->OnlineUserAcccountFromPUID(puid);
+	return this->GetCachedUserAccount(puid);
 }
 
 FString FOnlineIdentityInterfaceEpic::GetAuthToken(int32 LocalUserNum) const
@@ -714,12 +988,27 @@ ELoginStatus::Type FOnlineIdentityInterfaceEpic::GetLoginStatus(int32 LocalUserN
 
 FPlatformUserId FOnlineIdentityInterfaceEpic::GetPlatformUserIdFromUniqueNetId(const FUniqueNetId& UniqueNetId) const
 {
-	for (int i = 0; i < MAX_LOCAL_PLAYERS; ++i)
+	if (UniqueNetId.GetType() != EPIC_SUBSYSTEM)
 	{
-		auto id = this->GetUniquePlayerId(i);
-		if (id.IsValid() && (*id == UniqueNetId))
+		return PLATFORMUSERID_NONE;
+	}
+
+	FUniqueNetIdEpic const& epicNetId = static_cast<FUniqueNetIdEpic const&>(UniqueNetId);
+	if (epicNetId.IsProductUserIdValid())
+	{
+		int32 const* localUserNum = this->localUserNumsByPUID.Find(epicNetId.ToProductUserId());
+		return localUserNum ? *localUserNum : PLATFORMUSERID_NONE;
+	}
+
+	// Ids without a product user id can only be matched by their epic account id
+	if (epicNetId.IsEpicAccountIdValid())
+	{
+		for (int32 i = 0; i < this->localUserIds.Num(); ++i)
 		{
-			return i;
+			if (this->localUserIds[i] && this->localUserIds[i]->ToEpicAccountId() == epicNetId.ToEpicAccountId())
+			{
+				return i;
+			}
 		}
 	}
 
@@ -748,13 +1037,9 @@ FString FOnlineIdentityInterfaceEpic::GetPlayerNickname(int32 LocalUserNum) cons
 
 TSharedPtr<const FUniqueNetId> FOnlineIdentityInterfaceEpic::GetUniquePlayerId(int32 LocalUserNum) const
 {
-	EOS_ProductUserId puid = EOS_Connect_GetLoggedInUserByIndex(this->connectHandle, LocalUserNum);
-	EOS_EpicAccountId eaid = EOS_Auth_GetLoggedInAccountByIndex(this->authHandle, LocalUserNum);
-
-	if (EOS_ProductUserId_IsValid(puid))
+	if (this->localUserIds.IsValidIndex(LocalUserNum))
 	{
-		// We don't care if the EAID is invalid
-		return MakeShared<FUniqueNetIdEpic>(puid, eaid);
+		return this->localUserIds[LocalUserNum];
 	}
 	return nullptr;
 }
@@ -779,9 +1064,8 @@ bool FOnlineIdentityInterfaceEpic::Logout(int32 LocalUserNum)
 				id->ToEpicAccountId()
 			};
 
-			EOS_EpicAccountId epicId = EOS_Auth_GetLoggedInAccountByIndex(authHandle, LocalUserNum);
-			logoutOpts.LocalUserId = epicId;
-			EOS_Auth_Logout(authHandle, &logoutOpts, this, &FOnlineIdentityInterfaceEpic::EOS_Auth_OnLogoutComplete);
+			void* clientData = LogoutContexts.Add(this, FLogoutAdditionalData{ this });
+			EOS_Auth_Logout(authHandle, &logoutOpts, clientData, &FOnlineIdentityInterfaceEpic::EOS_Auth_OnLogoutComplete);
 		}
 		else
 		{
@@ -892,3 +1176,507 @@ ELoginStatus::Type FOnlineIdentityInterfaceEpic::EOSLoginStatusToUELoginStatus(E
 
 	return ELoginStatus::NotLoggedIn;
 }
+
+void FOnlineIdentityInterfaceEpic::Tick(float DeltaTime)
+{
+	this->refreshTimers.Tick(DeltaTime);
+}
+
+bool FOnlineIdentityInterfaceEpic::DeferWhileRefreshingToken(FUniqueNetId const& UserId, TFunction<void(FUniqueNetId const&)>&& Operation)
+{
+	FPlatformUserId const localUserNum = this->GetPlatformUserIdFromUniqueNetId(UserId);
+	if (localUserNum == PLATFORMUSERID_NONE)
+	{
+		return false;
+	}
+
+	FTokenRefreshEpic* refresh = this->tokenRefreshes.Find(this->localUserIds[localUserNum]->ToProductUserId());
+	if (!refresh || !refresh->bRefreshing)
+	{
+		return false;
+	}
+
+	refresh->Waiters.Add(MoveTemp(Operation));
+	return true;
+}
+
+void FOnlineIdentityInterfaceEpic::UpdateLocalUserIds()
+{
+	TSet<EOS_ProductUserId> loggedInUsers;
+	int32 const numLoggedIn = EOS_Connect_GetLoggedInUsersCount(this->connectHandle);
+	for (int32 i = 0; i < numLoggedIn; ++i)
+	{
+		loggedInUsers.Add(EOS_Connect_GetLoggedInUserByIndex(this->connectHandle, i));
+	}
+
+	// Drop users that logged out. Ids are immutable, a user whose epic account logged out gets a new one
+	for (TSharedPtr<FUniqueNetIdEpic const>& localUserId : this->localUserIds)
+	{
+		if (!localUserId)
+		{
+			continue;
+		}
+
+		EOS_ProductUserId const puid = localUserId->ToProductUserId();
+		if (!loggedInUsers.Contains(puid))
+		{
+			this->adoptedUserNums.Remove(this->localUserNumsByPUID.FindAndRemoveChecked(puid));
+			this->userAccounts.Remove(puid);
+			localUserId.Reset();
+		}
+		else if (localUserId->IsEpicAccountIdValid() && EOS_Auth_GetLoginStatus(this->authHandle, localUserId->ToEpicAccountId()) != EOS_ELoginStatus::EOS_LS_LoggedIn)
+		{
+			localUserId = MakeShared<FUniqueNetIdEpic const>(puid);
+		}
+	}
+
+	// Users logged in elsewhere, e.g. by an earlier instance of this interface, take the first free number.
+	// The SDK doesn't tell which epic account belongs to which product user, so they only get their product user id
+	int32 freeLocalUserNum = 0;
+	for (int32 i = 0; i < numLoggedIn; ++i)
+	{
+		EOS_ProductUserId puid = EOS_Connect_GetLoggedInUserByIndex(this->connectHandle, i);
+		if (this->localUserNumsByPUID.Contains(puid))
+		{
+			continue;
+		}
+
+		while (freeLocalUserNum < this->localUserIds.Num() && (this->localUserIds[freeLocalUserNum] || this->loggingInUserNums.Contains(freeLocalUserNum)))
+		{
+			++freeLocalUserNum;
+		}
+		if (freeLocalUserNum == this->localUserIds.Num())
+		{
+			break;
+		}
+
+		this->localUserIds[freeLocalUserNum] = MakeShared<FUniqueNetIdEpic const>(puid);
+		this->localUserNumsByPUID.Add(puid, freeLocalUserNum);
+		this->adoptedUserNums.Add(freeLocalUserNum);
+	}
+}
+
+bool FOnlineIdentityInterfaceEpic::AssignLocalUser(int32 LocalUserNum, EOS_ProductUserId PUID, EOS_EpicAccountId EAID, FString& Error)
+{
+	if (!this->localUserIds.IsValidIndex(LocalUserNum))
+	{
+		Error = FString::Printf(TEXT("Invalid local user number %d."), LocalUserNum);
+		return false;
+	}
+
+	int32 const* previousLocalUserNum = this->localUserNumsByPUID.Find(PUID);
+	if (previousLocalUserNum && *previousLocalUserNum != LocalUserNum && !this->adoptedUserNums.Contains(*previousLocalUserNum))
+	{
+		Error = FString::Printf(TEXT("User \"%s\" is already logged in as local user %d."), *FUniqueNetIdEpic::ProductUserIdToString(PUID), *previousLocalUserNum);
+		return false;
+	}
+
+	TSharedPtr<FUniqueNetIdEpic const>& localUserId = this->localUserIds[LocalUserNum];
+	bool const bOtherUser = localUserId && localUserId->ToProductUserId() != PUID;
+	if (bOtherUser && !this->adoptedUserNums.Contains(LocalUserNum))
+	{
+		Error = FString::Printf(TEXT("Local user %d is already logged in as another user."), LocalUserNum);
+		return false;
+	}
+
+	// A user that was put at another number by an update moves to the one they logged in with
+	if (previousLocalUserNum && *previousLocalUserNum != LocalUserNum)
+	{
+		this->localUserIds[*previousLocalUserNum].Reset();
+		this->adoptedUserNums.Remove(*previousLocalUserNum);
+	}
+
+	// Another user put at this number by an update stays logged in with the SDK and gets a free number on the next update
+	if (bOtherUser)
+	{
+		this->localUserNumsByPUID.Remove(localUserId->ToProductUserId());
+	}
+	this->adoptedUserNums.Remove(LocalUserNum);
+
+	if (!localUserId || localUserId->ToProductUserId() != PUID || localUserId->ToEpicAccountId() != EAID)
+	{
+		localUserId = MakeShared<FUniqueNetIdEpic const>(PUID, EAID);
+	}
+	this->localUserNumsByPUID.Add(PUID, LocalUserNum);
+	return true;
+}
+
+TSharedPtr<FUserOnlineAccount> FOnlineIdentityInterfaceEpic::GetCachedUserAccount(EOS_ProductUserId const& PUID) const
+{
+	if (TSharedPtr<FUserOnlineAccount> const* cachedAccount = this->userAccounts.Find(PUID))
+	{
+		return *cachedAccount;
+	}
+
+	// Only local users are cached. Their number is bounded and their entries are dropped when they log out.
+	// Accounts of remote users, e.g. looked up for presence, are built on every call
+	TSharedPtr<FUserOnlineAccount> userAccount = this->OnlineUserAcccountFromPUID(PUID);
+	if (userAccount && this->localUserNumsByPUID.Contains(PUID))
+	{
+		this->userAccounts.Add(PUID, userAccount);
+	}
+	return userAccount;
+}
+
+void FOnlineIdentityInterfaceEpic::InvalidateUserAccounts(EOS_ProductUserId PUID)
+{
+	if (PUID)
+	{
+		this->userAccounts.Remove(PUID);
+	}
+	else
+	{
+		this->userAccounts.Empty();
+	}
+}
+
+void FOnlineIdentityInterfaceEpic::ScheduleTokenRefresh(EOS_ProductUserId PUID)
+{
+	int32 const* localUserNum = this->localUserNumsByPUID.Find(PUID);
+	if (!localUserNum)
+	{
+		return;
+	}
+
+	double const now = FPlatformTime::Seconds();
+	FTokenRefreshEpic& refresh = this->tokenRefreshes.FindOrAdd(PUID);
+	refresh.ConnectExpiry = now + this->connectTokenLifetime;
+	refresh.AuthExpiry = 0.0;
+
+	// The SDK refreshes auth tokens on its own, but a token it failed to refresh is renewed with the Connect token
+	EOS_EpicAccountId eaid = this->localUserIds[*localUserNum]->ToEpicAccountId();
+	if (EOS_EpicAccountId_IsValid(eaid))
+	{
+		EOS_Auth_Token* authToken = nullptr;
+		EOS_Auth_CopyUserAuthTokenOptions copyAuthTokenOptions = {
+			EOS_AUTH_COPYUSERAUTHTOKEN_API_LATEST
+		};
+		if (EOS_Auth_CopyUserAuthToken(this->authHandle, &copyAuthTokenOptions, eaid, &authToken) == EOS_EResult::EOS_Success)
+		{
+			refresh.AuthExpiry = now + authToken->ExpiresIn;
+			EOS_Auth_Token_Release(authToken);
+		}
+	}
+
+	double const expiry = refresh.AuthExpiry > 0.0 ? FMath::Min(refresh.ConnectExpiry, refresh.AuthExpiry) : refresh.ConnectExpiry;
+	double const delay = FMath::Max(0.0, expiry - now - this->tokenRefreshLead - FMath::FRand() * this->tokenRefreshJitter);
+
+	this->refreshTimers.Cancel(refresh.TimerHandle);
+	refresh.TimerHandle = this->refreshTimers.Schedule(delay, [this, PUID]()
+	{
+		this->StartTokenRefresh(PUID);
+	});
+
+	UE_LOG_ONLINE_IDENTITY(Verbose, TEXT("Refreshing tokens of user \"%s\" in %.0f seconds"), *FUniqueNetIdEpic::ProductUserIdToString(PUID), delay);
+}
+
+void FOnlineIdentityInterfaceEpic::StartTokenRefresh(EOS_ProductUserId PUID)
+{
+	int32 const* localUserNum = this->localUserNumsByPUID.Find(PUID);
+	if (!localUserNum)
+	{
+		return;
+	}
+
+	// Logging in with external credentials needs a new token from the platform, only the game can log these users in again
+	EOS_EpicAccountId eaid = this->localUserIds[*localUserNum]->ToEpicAccountId();
+	if (!EOS_EpicAccountId_IsValid(eaid))
+	{
+		UE_LOG_ONLINE_IDENTITY(Display, TEXT("Tokens of user \"%s\" expire soon. The user has to be logged in again"), *FUniqueNetIdEpic::ProductUserIdToString(PUID));
+		return;
+	}
+
+	// Users that were logged in before this interface existed don't have a refresh scheduled yet
+	FTokenRefreshEpic& refresh = this->tokenRefreshes.FindOrAdd(PUID);
+	if (refresh.bRefreshing)
+	{
+		return;
+	}
+
+	refresh.bRefreshing = true;
+	refresh.RefreshStartTime = FPlatformTime::Seconds();
+
+	// A refresh that didn't complete in time releases its waiting operations
+	this->refreshTimers.Cancel(refresh.TimerHandle);
+	refresh.TimerHandle = this->refreshTimers.Schedule(this->tokenRefreshTimeout, [this, PUID]()
+	{
+		UE_LOG_ONLINE_IDENTITY(Warning, TEXT("Refreshing tokens of user \"%s\" timed out"), *FUniqueNetIdEpic::ProductUserIdToString(PUID));
+		this->FinishTokenRefresh(PUID, false);
+	});
+
+	EOS_Auth_Token* authToken = nullptr;
+	EOS_Auth_CopyUserAuthTokenOptions copyAuthTokenOptions = {
+		EOS_AUTH_COPYUSERAUTHTOKEN_API_LATEST
+	};
+	if (EOS_Auth_CopyUserAuthToken(this->authHandle, &copyAuthTokenOptions, eaid, &authToken) != EOS_EResult::EOS_Success)
+	{
+		UE_LOG_ONLINE_IDENTITY(Warning, TEXT("No auth token to refresh the tokens of user \"%s\" with"), *FUniqueNetIdEpic::ProductUserIdToString(PUID));
+		this->FinishTokenRefresh(PUID, false);
+		return;
+	}
+
+	if (authToken->ExpiresIn > this->tokenRefreshLead)
+	{
+		EOS_Auth_Token_Release(authToken);
+		if (!this->RefreshConnectToken(PUID, eaid))
+		{
+			this->FinishTokenRefresh(PUID, false);
+		}
+		return;
+	}
+
+	// The auth token expires as well, so it's renewed with its refresh token first
+	EOS_Auth_Credentials credentials = {
+		EOS_AUTH_CREDENTIALS_API_LATEST
+	};
+	credentials.Token = authToken->RefreshToken;
+	credentials.Type = EOS_ELoginCredentialType::EOS_LCT_RefreshToken;
+
+	EOS_Auth_LoginOptions loginOpts = {};
+	loginOpts.ApiVersion = EOS_AUTH_LOGIN_API_LATEST;
+	loginOpts.ScopeFlags = EOS_EAuthScopeFlags::EOS_AS_BasicProfile | EOS_EAuthScopeFlags::EOS_AS_FriendsList | EOS_EAuthScopeFlags::EOS_AS_Presence;
+	loginOpts.Credentials = &credentials;
+
+	void* clientData = TokenRefreshContexts.Add(this, FTokenRefreshAdditionalData{
+		this,
+		PUID,
+		eaid
+	});
+	EOS_Auth_Login(this->authHandle, &loginOpts, clientData, &FOnlineIdentityInterfaceEpic::EOS_Auth_OnTokenRefreshed);
+
+	EOS_Auth_Token_Release(authToken);
+}
+
+bool FOnlineIdentityInterfaceEpic::RefreshConnectToken(EOS_ProductUserId PUID, EOS_EpicAccountId EAID)
+{
+	EOS_Auth_Token* authToken = nullptr;
+	EOS_Auth_CopyUserAuthTokenOptions copyAuthTokenOptions = {
+		EOS_AUTH_COPYUSERAUTHTOKEN_API_LATEST
+	};
+	if (EOS_Auth_CopyUserAuthToken(this->authHandle, &copyAuthTokenOptions, EAID, &authToken) != EOS_EResult::EOS_Success)
+	{
+		return false;
+	}
+
+	EOS_Connect_Credentials connectCredentials = {
+		EOS_CONNECT_CREDENTIALS_API_LATEST,
+		authToken->AccessToken,
+		EOS_EExternalCredentialType::EOS_ECT_EPIC
+	};
+	EOS_Connect_LoginOptions loginOptions = {
+		EOS_CONNECT_LOGIN_API_LATEST,
+		&connectCredentials,
+		nullptr
+	};
+	void* clientData = TokenRefreshContexts.Add(this, FTokenRefreshAdditionalData{
+		this,
+		PUID,
+		EAID
+	});
+	EOS_Connect_Login(this->connectHandle, &loginOptions, clientData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnTokenRefreshed);
+
+	EOS_Auth_Token_Release(authToken);
+	return true;
+}
+
+void FOnlineIdentityInterfaceEpic::FinishTokenRefresh(EOS_ProductUserId PUID, bool bWasSuccessful)
+{
+	FTokenRefreshEpic* refresh = this->tokenRefreshes.Find(PUID);
+	if (!refresh || !refresh->bRefreshing)
+	{
+		if (bWasSuccessful)
+		{
+			this->ScheduleTokenRefresh(PUID);
+		}
+		return;
+	}
+
+	double const latency = FPlatformTime::Seconds() - refresh->RefreshStartTime;
+	refresh->bRefreshing = false;
+	this->refreshTimers.Cancel(refresh->TimerHandle);
+	refresh->TimerHandle = 0;
+
+	this->tokenRefreshStats.LastLatency = latency;
+	this->tokenRefreshStats.MaxLatency = FMath::Max(this->tokenRefreshStats.MaxLatency, latency);
+	this->tokenRefreshStats.TotalLatency += latency;
+	if (bWasSuccessful)
+	{
+		++this->tokenRefreshStats.NumRefreshes;
+	}
+	else
+	{
+		++this->tokenRefreshStats.NumFailures;
+	}
+
+	// Waiting operations run even if the refresh failed, they report their own errors
+	TArray<TFunction<void(FUniqueNetId const&)>> waiters = MoveTemp(refresh->Waiters);
+
+	if (bWasSuccessful)
+	{
+		this->ScheduleTokenRefresh(PUID);
+	}
+	else if (FPlatformTime::Seconds() < refresh->ConnectExpiry)
+	{
+		// The current token is still valid for a while, so the refresh is tried again halfway to its expiry
+		double const retryDelay = FMath::Max(1.0, (refresh->ConnectExpiry - FPlatformTime::Seconds()) * 0.5);
+		refresh->TimerHandle = this->refreshTimers.Schedule(retryDelay, [this, PUID]()
+		{
+			this->StartTokenRefresh(PUID);
+		});
+	}
+
+	int32 const* localUserNumPtr = this->localUserNumsByPUID.Find(PUID);
+	int32 const localUserNum = localUserNumPtr ? *localUserNumPtr : INDEX_NONE;
+	UE_LOG_ONLINE_IDENTITY(Log, TEXT("Refreshing tokens of user \"%s\" %s after %.3f seconds. %d operation(s) were waiting"),
+		*FUniqueNetIdEpic::ProductUserIdToString(PUID), bWasSuccessful ? TEXT("succeeded") : TEXT("failed"), latency, waiters.Num());
+	this->TriggerOnTokenRefreshCompleteDelegates(localUserNum, bWasSuccessful, latency);
+
+	if (waiters.Num() > 0)
+	{
+		TSharedRef<FUniqueNetIdEpic const> userId = localUserNum != INDEX_NONE ? this->localUserIds[localUserNum].ToSharedRef() : MakeShared<FUniqueNetIdEpic const>(PUID);
+		for (TFunction<void(FUniqueNetId const&)>& waiter : waiters)
+		{
+			waiter(*userId);
+		}
+	}
+}
+
+void FOnlineIdentityInterfaceEpic::StopTokenRefresh(EOS_ProductUserId PUID)
+{
+	this->FinishTokenRefresh(PUID, false);
+
+	// Waiting operations could have changed the refreshes
+	if (FTokenRefreshEpic* refresh = this->tokenRefreshes.Find(PUID))
+	{
+		this->refreshTimers.Cancel(refresh->TimerHandle);
+		this->tokenRefreshes.Remove(PUID);
+	}
+}
+
+void FOnlineIdentityInterfaceEpic::LoginWithDeviceId(int32 LocalUserNum, FString const& DisplayName, uint64 BatchId)
+{
+	// The device id is created once. Logins started meanwhile wait for it
+	if (this->deviceIdState != EDeviceIdState::Created)
+	{
+		this->deviceIdWaiters.Add([this, LocalUserNum, DisplayName, BatchId](bool bDeviceIdExists)
+		{
+			if (bDeviceIdExists)
+			{
+				this->LoginWithDeviceId(LocalUserNum, DisplayName, BatchId);
+			}
+			else
+			{
+				this->CompleteLogin(LocalUserNum, BatchId, false, FUniqueNetIdEpic(), TEXT("[EOS SDK] Couldn't create device id"));
+			}
+		});
+
+		if (this->deviceIdState == EDeviceIdState::Unknown)
+		{
+			this->deviceIdState = EDeviceIdState::Creating;
+
+			FString const deviceModel = FPlatformMisc::GetDeviceMakeAndModel();
+			EOS_Connect_CreateDeviceIdOptions createDeviceIdOptions = {
+				EOS_CONNECT_CREATEDEVICEID_API_LATEST,
+				TCHAR_TO_UTF8(*deviceModel)
+			};
+			void* clientData = CreateDeviceIdContexts.Add(this, FCreateDeviceIdAdditionalData{ this });
+			EOS_Connect_CreateDeviceId(this->connectHandle, &createDeviceIdOptions, clientData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnDeviceIdCreated);
+		}
+		this->ReportLoginProgress(BatchId, LocalUserNum, EBatchLoginStepEpic::CreateDeviceId);
+		return;
+	}
+
+	EOS_Connect_Credentials connectCredentials = {
+		EOS_CONNECT_CREDENTIALS_API_LATEST,
+		nullptr,
+		EOS_EExternalCredentialType::EOS_ECT_DEVICEID_ACCESS_TOKEN
+	};
+
+	// Display names are at most 32 characters long
+	FTCHARToUTF8 const displayName(*DisplayName.Left(32));
+	EOS_Connect_UserLoginInfo loginInfo = {
+		EOS_CONNECT_USERLOGININFO_API_LATEST,
+		displayName.Get()
+	};
+	EOS_Connect_LoginOptions loginOptions = {
+		EOS_CONNECT_LOGIN_API_LATEST,
+		&connectCredentials,
+		&loginInfo
+	};
+
+	void* clientData = LoginContexts.Add(this, FLoginCompleteAdditionalData{
+		this,
+		LocalUserNum,
+		nullptr,
+		BatchId,
+		true
+	});
+	this->ReportLoginProgress(BatchId, LocalUserNum, EBatchLoginStepEpic::ConnectLogin);
+	EOS_Connect_Login(this->connectHandle, &loginOptions, clientData, &FOnlineIdentityInterfaceEpic::EOS_Connect_OnLoginComplete);
+}
+
+void FOnlineIdentityInterfaceEpic::CompleteLogin(int32 LocalUserNum, uint64 BatchId, bool bWasSuccessful, FUniqueNetId const& UserId, FString const& Error)
+{
+	this->loggingInUserNums.Remove(LocalUserNum);
+	this->TriggerOnLoginCompleteDelegates(LocalUserNum, bWasSuccessful, UserId, Error);
+
+	FBatchLoginEpic* batch = this->batchLogins.Find(BatchId);
+	if (!batch)
+	{
+		return;
+	}
+
+	--batch->NumRunning;
+	if (bWasSuccessful)
+	{
+		++batch->NumSucceeded;
+	}
+	else
+	{
+		++batch->NumFailed;
+	}
+
+	this->ReportLoginProgress(BatchId, LocalUserNum, bWasSuccessful ? EBatchLoginStepEpic::Succeeded : EBatchLoginStepEpic::Failed);
+	this->StartBatchLogins(BatchId);
+}
+
+void FOnlineIdentityInterfaceEpic::ReportLoginProgress(uint64 BatchId, int32 LocalUserNum, EBatchLoginStepEpic Step)
+{
+	if (BatchId != 0)
+	{
+		this->TriggerOnBatchLoginProgressDelegates(BatchId, LocalUserNum, Step);
+	}
+}
+
+void FOnlineIdentityInterfaceEpic::StartBatchLogins(uint64 BatchId)
+{
+	FBatchLoginEpic* batch = this->batchLogins.Find(BatchId);
+	if (!batch || batch->bStartingLogins)
+	{
+		return;
+	}
+
+	batch->bStartingLogins = true;
+	while (batch->NumRunning < this->loginBatchWindow && batch->NextLogin < batch->Logins.Num())
+	{
+		// Copied, logins failing right away complete before StartLogin returns and can start other batches
+		TPair<int32, FOnlineAccountCredentials> const login = batch->Logins[batch->NextLogin++];
+		++batch->NumRunning;
+		this->StartLogin(login.Key, login.Value, BatchId);
+		batch = this->batchLogins.Find(BatchId);
+	}
+	batch->bStartingLogins = false;
+
+	if (batch->NumRunning > 0 || batch->NextLogin < batch->Logins.Num())
+	{
+		return;
+	}
+
+	int32 const numSucceeded = batch->NumSucceeded;
+	int32 const numFailed = batch->NumFailed;
+	double const duration = FPlatformTime::Seconds() - batch->StartTime;
+	this->batchLogins.Remove(BatchId);
+
+	UE_LOG_ONLINE_IDENTITY(Log, TEXT("Batch %llu logged in %d users in %.3f seconds. %d logins failed"), BatchId, numSucceeded, duration, numFailed);
+	this->TriggerOnBatchLoginCompleteDelegates(BatchId, numSucceeded, numFailed);
+}
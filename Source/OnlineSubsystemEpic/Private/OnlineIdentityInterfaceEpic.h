@@ -5,9 +5,155 @@
 #include "Interfaces/OnlineIdentityInterface.h"
 #include "OnlineSubsystemEpicTypes.h"
 #include "eos_sdk.h"
+#include "TimerWheelEpic.h"
 
 class FOnlineSubsystemEpic;
 
+/**
+ * Delegate fired when the tokens of a local user were refreshed
+ * @param LocalUserNum - The local user whose tokens were refreshed
+ * @param bWasSuccessful - Whether the user holds new tokens
+ * @param LatencyInSeconds - Time from the start of the refresh until it completed
+ */
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnTokenRefreshComplete, int32, bool, double);
+typedef FOnTokenRefreshComplete::FDelegate FOnTokenRefreshCompleteDelegate;
+
+/** The steps a user passes through during a batched login */
+enum class EBatchLoginStepEpic : uint8
+{
+	/** Logging into the epic account services */
+	AuthLogin,
+	/** Creating the device id of a device id login */
+	CreateDeviceId,
+	/** Logging into Connect */
+	ConnectLogin,
+	/** Creating a product user for a device id that has none yet */
+	CreateUser,
+	/** The user is logged in */
+	Succeeded,
+	/** The login failed */
+	Failed
+};
+
+/**
+ * Delegate fired every time a user of a batched login advanced to another step
+ * @param BatchId - The id returned by LoginMultiple
+ * @param LocalUserNum - The local user that advanced
+ * @param Step - The step the user advanced to
+ */
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnBatchLoginProgress, uint64, int32, EBatchLoginStepEpic);
+typedef FOnBatchLoginProgress::FDelegate FOnBatchLoginProgressDelegate;
+
+/**
+ * Delegate fired once every user of a batched login is logged in or failed
+ * @param BatchId - The id returned by LoginMultiple
+ * @param NumSucceeded - The number of users that were logged in
+ * @param NumFailed - The number of users whose login failed
+ */
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnBatchLoginComplete, uint64, int32, int32);
+typedef FOnBatchLoginComplete::FDelegate FOnBatchLoginCompleteDelegate;
+
+/** A login of multiple local users started by LoginMultiple */
+struct FBatchLoginEpic
+{
+	/** The local user number and credentials of every user */
+	TArray<TPair<int32, FOnlineAccountCredentials>> Logins;
+
+	/** The index of the next login to start */
+	int32 NextLogin;
+
+	/** The number of logins started, but not completed */
+	int32 NumRunning;
+
+	/** The number of users that were logged in */
+	int32 NumSucceeded;
+
+	/** The number of users whose login failed */
+	int32 NumFailed;
+
+	/** Time at which the batch was started, in FPlatformTime::Seconds */
+	double StartTime;
+
+	/** Whether logins are being started. Logins completing meanwhile don't start further ones */
+	bool bStartingLogins;
+
+	FBatchLoginEpic()
+		: NextLogin(0)
+		, NumRunning(0)
+		, NumSucceeded(0)
+		, NumFailed(0)
+		, StartTime(0.0)
+		, bStartingLogins(false)
+	{
+	}
+};
+
+/** Outcomes and latency of all token refreshes completed so far */
+struct FTokenRefreshStatsEpic
+{
+	/** Refreshes that got new tokens */
+	int32 NumRefreshes;
+
+	/** Refreshes that failed or timed out */
+	int32 NumFailures;
+
+	/** Time in seconds the last refresh took */
+	double LastLatency;
+
+	/** Time in seconds the slowest refresh took */
+	double MaxLatency;
+
+	/** Sum of the time all refreshes took */
+	double TotalLatency;
+
+	FTokenRefreshStatsEpic()
+		: NumRefreshes(0)
+		, NumFailures(0)
+		, LastLatency(0.0)
+		, MaxLatency(0.0)
+		, TotalLatency(0.0)
+	{
+	}
+
+	/** Returns the average time a refresh took */
+	double GetAverageLatency() const
+	{
+		int32 const numCompleted = this->NumRefreshes + this->NumFailures;
+		return numCompleted > 0 ? this->TotalLatency / numCompleted : 0.0;
+	}
+};
+
+/** Token expiry and refresh state of a logged in user */
+struct FTokenRefreshEpic
+{
+	/** Time at which the Connect token expires, in FPlatformTime::Seconds */
+	double ConnectExpiry;
+
+	/** Time at which the auth token expires. Zero for users without an epic account */
+	double AuthExpiry;
+
+	/** The timer starting the next refresh, or timing out the running one */
+	uint64 TimerHandle;
+
+	/** Whether a refresh is running */
+	bool bRefreshing;
+
+	/** Time at which the running refresh started */
+	double RefreshStartTime;
+
+	/** Operations issued during the running refresh. Called with the user's id once it completed */
+	TArray<TFunction<void(FUniqueNetId const&)>> Waiters;
+
+	FTokenRefreshEpic()
+		: ConnectExpiry(0.0)
+		, AuthExpiry(0.0)
+		, TimerHandle(0)
+		, bRefreshing(false)
+		, RefreshStartTime(0.0)
+	{
+	}
+};
+
 class FOnlineIdentityInterfaceEpic
 	: public IOnlineIdentity
 {
@@ -21,6 +167,70 @@ class FOnlineIdentityInterfaceEpic
 
 	EOS_NotificationId notifyAuthExpiration;
 
+	EOS_NotificationId notifyAuthLoginStatusChangedId;
+
+	/**
+	 * The ids of the logged in local users, indexed by their local user number.
+	 * Updated whenever the login status of a user changes, so looking up an id doesn't call into the SDK.
+	 * An id is only replaced if the user at its index changed, callers can hold on to the shared ids.
+	 */
+	TArray<TSharedPtr<FUniqueNetIdEpic const>> localUserIds;
+
+	/** The local user number of each logged in user, keyed by their product user id */
+	TMap<EOS_ProductUserId, int32> localUserNumsByPUID;
+
+	/** Local user numbers with a login in progress. Users logged in elsewhere don't take these numbers */
+	TSet<int32> loggingInUserNums;
+
+	/** Local user numbers taken by users logged in elsewhere. A login through this interface may move them */
+	TSet<int32> adoptedUserNums;
+
+	/** Batched logins in progress, keyed by their id */
+	TMap<uint64, FBatchLoginEpic> batchLogins;
+
+	/** The id of the last batched login */
+	uint64 lastBatchLoginId;
+
+	/** The maximum number of logins of a batch running at the same time */
+	int32 loginBatchWindow;
+
+	/** Whether this device's device id exists, is being created, or wasn't looked at yet */
+	enum class EDeviceIdState : uint8
+	{
+		Unknown,
+		Creating,
+		Created
+	} deviceIdState;
+
+	/** Device id logins waiting for the device id to be created. Called with whether the device id exists */
+	TArray<TFunction<void(bool)>> deviceIdWaiters;
+
+	/**
+	 * Accounts of the local users, keyed by their product user id.
+	 * An account is only created again once the login status or the auth token of its user changed.
+	 */
+	mutable TMap<EOS_ProductUserId, TSharedPtr<FUserOnlineAccount>> userAccounts;
+
+	/** Token expiry and refresh state of the logged in users, keyed by their product user id */
+	TMap<EOS_ProductUserId, FTokenRefreshEpic> tokenRefreshes;
+
+	/** Schedules token refreshes and refresh timeouts */
+	FTimerWheelEpic refreshTimers;
+
+	/** Time in seconds a Connect token is valid after login. The SDK doesn't expose the expiry of Connect tokens */
+	double connectTokenLifetime;
+
+	/** Time in seconds before a token expires at which it's refreshed */
+	double tokenRefreshLead;
+
+	/** The maximum random time in seconds by which a refresh is moved forward, so refreshes of many users don't line up */
+	double tokenRefreshJitter;
+
+	/** Time in seconds after which a refresh that didn't complete is considered failed */
+	double tokenRefreshTimeout;
+
+	FTokenRefreshStatsEpic tokenRefreshStats;
+
 	FOnlineIdentityInterfaceEpic() = delete;
 
 	static void EOS_Connect_OnLoginComplete(EOS_Connect_LoginCallbackInfo const* Data);
@@ -28,17 +238,131 @@ class FOnlineIdentityInterfaceEpic
 	static void EOS_Connect_OnLoginStatusChanged(EOS_Connect_LoginStatusChangedCallbackInfo const* Data);
 	static void EOS_Auth_OnLoginComplete(EOS_Auth_LoginCallbackInfo const* Data);
 	static void EOS_Auth_OnLogoutComplete(const EOS_Auth_LogoutCallbackInfo* Data);
+	static void EOS_Auth_OnLoginStatusChanged(EOS_Auth_LoginStatusChangedCallbackInfo const* Data);
 	static void EOS_Connect_OnUserCreated(EOS_Connect_CreateUserCallbackInfo const* Data);
 	static void EOS_Connect_OnAccountLinked(EOS_Connect_LinkAccountCallbackInfo const* Data);
+	static void EOS_Connect_OnDeviceIdCreated(EOS_Connect_CreateDeviceIdCallbackInfo const* Data);
+	static void EOS_Auth_OnTokenRefreshed(EOS_Auth_LoginCallbackInfo const* Data);
+	static void EOS_Connect_OnTokenRefreshed(EOS_Connect_LoginCallbackInfo const* Data);
 
 	TSharedPtr<FUserOnlineAccount> OnlineUserAcccountFromPUID(EOS_ProductUserId const& PUID) const;
+
+	/** Returns the account of a user. Accounts of local users are cached, the ones of other users are created on every call */
+	TSharedPtr<FUserOnlineAccount> GetCachedUserAccount(EOS_ProductUserId const& PUID) const;
+
+	/**
+	 * Drops cached user accounts, so they're created again with the current data
+	 * @param PUID - The product user id of the account to drop. Nullptr drops all accounts
+	 */
+	void InvalidateUserAccounts(EOS_ProductUserId PUID = nullptr);
+
 	ELoginStatus::Type EOSLoginStatusToUELoginStatus(EOS_ELoginStatus LoginStatus);
 
+	/**
+	 * Reads the logged in users from the SDK and updates the local user id table.
+	 * Users keep the local user number they logged in with, users logged in elsewhere take the first free one
+	 */
+	void UpdateLocalUserIds();
+
+	/**
+	 * Puts a user that just logged in at the local user number they logged in with.
+	 * Users logged in through this interface are never moved or replaced.
+	 *
+	 * @param Error Set if the user is logged in at another number, or another user is logged in at this one
+	 * @returns Whether the user was put at the number
+	 */
+	bool AssignLocalUser(int32 LocalUserNum, EOS_ProductUserId PUID, EOS_EpicAccountId EAID, FString& Error);
+
+	/**
+	 * Starts the login of a single user
+	 * @param BatchId - The batched login the login belongs to. Zero for single logins
+	 * @returns - True if the login was started
+	 */
+	bool StartLogin(int32 LocalUserNum, FOnlineAccountCredentials const& AccountCredentials, uint64 BatchId);
+
+	/** Logs a user into Connect with this device's device id. Creates a product user for the device id if necessary */
+	void LoginWithDeviceId(int32 LocalUserNum, FString const& DisplayName, uint64 BatchId);
+
+	/** Fires the login complete delegates and advances the user's batched login */
+	void CompleteLogin(int32 LocalUserNum, uint64 BatchId, bool bWasSuccessful, FUniqueNetId const& UserId, FString const& Error);
+
+	/** Fires the progress delegates of a batched login. Does nothing for single logins */
+	void ReportLoginProgress(uint64 BatchId, int32 LocalUserNum, EBatchLoginStepEpic Step);
+
+	/** Starts logins of a batch until the window is full, and completes the batch once every login completed */
+	void StartBatchLogins(uint64 BatchId);
+
+	/** Reads the expiry of a user's tokens and schedules their refresh ahead of the earliest one */
+	void ScheduleTokenRefresh(EOS_ProductUserId PUID);
+
+	/**
+	 * Starts refreshing the tokens of a user. Operations issued for the user wait until the refresh completed.
+	 * Users with an epic account are logged in again with their auth token. Other users have to be logged in again by the game,
+	 * their operations don't wait
+	 */
+	void StartTokenRefresh(EOS_ProductUserId PUID);
+
+	/**
+	 * Logs a user into Connect again with their current auth token
+	 * @returns - False if the user has no auth token
+	 */
+	bool RefreshConnectToken(EOS_ProductUserId PUID, EOS_EpicAccountId EAID);
+
+	/**
+	 * Completes the running refresh of a user's tokens, runs the operations waiting for it and schedules the next refresh.
+	 * Without a running refresh only the next refresh is scheduled
+	 */
+	void FinishTokenRefresh(EOS_ProductUserId PUID, bool bWasSuccessful);
+
+	/** Fails the running refresh of a user that logged out and stops refreshing their tokens */
+	void StopTokenRefresh(EOS_ProductUserId PUID);
+
 public:
 	virtual ~FOnlineIdentityInterfaceEpic();
 
 	FOnlineIdentityInterfaceEpic(FOnlineSubsystemEpic* inSubsystem);
 
+	/** Starts due token refreshes and times out refreshes that didn't complete */
+	void Tick(float DeltaTime);
+
+	/**
+	 * Logs in multiple local users at once. Up to LoginBatchWindow logins run in parallel, the others start as soon as one completed.
+	 * Every login fires the login complete delegates like a single login. Use "CONNECT:DeviceId" for headless logins, e.g. of test bots
+	 * @param Logins - The local user number and credentials of each user
+	 * @returns - The id of the batch, passed to the batch delegates. If no login could be started, OnBatchLoginComplete fires before this returns
+	 */
+	uint64 LoginMultiple(TArray<TPair<int32, FOnlineAccountCredentials>> const& Logins);
+
+	/** Fired every time a user of a batched login advanced to another step */
+	DEFINE_ONLINE_DELEGATE_THREE_PARAM(OnBatchLoginProgress, uint64, int32, EBatchLoginStepEpic);
+
+	/** Fired once every user of a batched login is logged in or failed */
+	DEFINE_ONLINE_DELEGATE_THREE_PARAM(OnBatchLoginComplete, uint64, int32, int32);
+
+	/** Returns the number of local users that can be logged in at the same time */
+	int32 GetMaxLocalUsers() const
+	{
+		return this->localUserIds.Num();
+	}
+
+	/**
+	 * Defers an operation of a local user until the running refresh of their tokens completed,
+	 * so the operation isn't sent with an expiring token
+	 * @param UserId - The user issuing the operation
+	 * @param Operation - Called with the user's id once the refresh completed, whether it succeeded or not
+	 * @returns - True if the operation was deferred. False if no refresh is running and the operation can be issued right away
+	 */
+	bool DeferWhileRefreshingToken(FUniqueNetId const& UserId, TFunction<void(FUniqueNetId const&)>&& Operation);
+
+	/** Fired every time a refresh of a local user's tokens completed */
+	DEFINE_ONLINE_DELEGATE_THREE_PARAM(OnTokenRefreshComplete, int32, bool, double);
+
+	/** Returns the outcomes and latency of all token refreshes completed so far */
+	FTokenRefreshStatsEpic const& GetTokenRefreshStats() const
+	{
+		return this->tokenRefreshStats;
+	}
+
 	virtual bool Login(int32 LocalUserNum, const FOnlineAccountCredentials& AccountCredentials) override;
 	bool AutoLogin(int32 LocalUserNum) override;
 	TSharedPtr<const FUniqueNetId> CreateUniquePlayerId(const FString& Str) override;
@@ -1,4 +1,5 @@
 #include "OnlinePresenceEpic.h"
+#include "OperationContextPoolEpic.h"
 #include "eos_presence.h"
 #include "OnlineSubsystemEpicTypes.h"
 #include "eos_connect.h"
@@ -16,8 +17,8 @@
 typedef struct FPresenceAdditionalData
 {
 	FOnlinePresenceEpic const* This;
-	FUniqueNetIdEpic const& EpicNetId;
-	FOnlinePresenceEpic::FOnPresenceTaskCompleteDelegate const& Delegate;
+	FUniqueNetIdEpic EpicNetId;
+	FOnlinePresenceEpic::FOnPresenceTaskCompleteDelegate Delegate;
 } FSetPresenceAdditionalData;
 
 typedef struct FQueryExternalMappingForPresenceAdditionalInformation
@@ -27,12 +28,20 @@ typedef struct FQueryExternalMappingForPresenceAdditionalInformation
 	TSharedPtr<FUniqueNetId const> LocalUser;
 } FQueryExternalMappingForPresenceAdditionalInformation;
 
+/** Contexts of the running operations, passed to the EOS SDK as client data */
+static TOperationContextPoolEpic<FPresenceAdditionalData> PresenceContexts(TEXT("Presence"));
+static TOperationContextPoolEpic<FQueryExternalMappingForPresenceAdditionalInformation> PresenceMappingContexts(TEXT("QueryExternalMappingForPresence"));
+
 // -----------------------------
 // EOS Callbacks
 // -----------------------------
 void FOnlinePresenceEpic::EOS_SetPresenceComplete(EOS_Presence_SetPresenceCallbackInfo const* data)
 {
-	FPresenceAdditionalData* additionalData = static_cast<FPresenceAdditionalData*>(data->ClientData);
+	TOptional<FPresenceAdditionalData> additionalData = PresenceContexts.Remove(data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
 
 	if (data->ResultCode == EOS_EResult::EOS_Success)
 	{
@@ -44,14 +53,15 @@ void FOnlinePresenceEpic::EOS_SetPresenceComplete(EOS_Presence_SetPresenceCallba
 		UE_LOG_ONLINE_PRESENCE(Warning, TEXT("[EOS SDK] Couldn't update presence information. Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(data->ResultCode)));
 		additionalData->Delegate.ExecuteIfBound(additionalData->EpicNetId, false);
 	}
-
-	// Release the additional data memory
-	delete(additionalData);
 }
 
 void FOnlinePresenceEpic::EOS_QueryPresenceComplete(EOS_Presence_QueryPresenceCallbackInfo const* data)
 {
-	FPresenceAdditionalData* additionalData = static_cast<FPresenceAdditionalData*>(data->ClientData);
+	TOptional<FPresenceAdditionalData> additionalData = PresenceContexts.Remove(data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
 
 	bool success = data->ResultCode == EOS_EResult::EOS_Success;
 
@@ -59,8 +69,6 @@ void FOnlinePresenceEpic::EOS_QueryPresenceComplete(EOS_Presence_QueryPresenceCa
 	UE_CLOG_ONLINE_PRESENCE(!success, Warning, TEXT("[EOS SDK] QueryPresence encountered an error: %s"), *FString(__FUNCTION__));
 
 	additionalData->Delegate.ExecuteIfBound(additionalData->EpicNetId, success);
-
-	delete additionalData;
 }
 
 void FOnlinePresenceEpic::EOS_OnPresenceChanged(EOS_Presence_PresenceChangedCallbackInfo const* data)
@@ -146,12 +154,12 @@ void FOnlinePresenceEpic::EOS_OnPresenceChanged(EOS_Presence_PresenceChangedCall
 					ids,
 					EOS_CONNECT_QUERYEXTERNALACCOUNTMAPPINGS_MAX_ACCOUNT_IDS
 				};
-				auto additionalData = new FQueryExternalMappingForPresenceAdditionalInformation{
+				void* clientData = PresenceMappingContexts.Add(THIS, FQueryExternalMappingForPresenceAdditionalInformation{
 					 THIS,
 					 data->PresenceUserId,
 					 fittingNetId
-				};
-				EOS_Connect_QueryExternalAccountMappings(connectHandle, &queryExternalOptions, additionalData, &FOnlinePresenceEpic::EOS_QueryExternalAccountMappingsForPresenceComplete);
+				});
+				EOS_Connect_QueryExternalAccountMappings(connectHandle, &queryExternalOptions, clientData, &FOnlinePresenceEpic::EOS_QueryExternalAccountMappingsForPresenceComplete);
 			}
 		}
 		else
@@ -167,7 +175,12 @@ void FOnlinePresenceEpic::EOS_OnPresenceChanged(EOS_Presence_PresenceChangedCall
 
 void FOnlinePresenceEpic::EOS_QueryExternalAccountMappingsForPresenceComplete(EOS_Connect_QueryExternalAccountMappingsCallbackInfo const* data)
 {
-	auto additionalData = static_cast<FQueryExternalMappingForPresenceAdditionalInformation*>(data->ClientData);
+	TOptional<FQueryExternalMappingForPresenceAdditionalInformation> additionalData = PresenceMappingContexts.Remove(data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
 	FOnlinePresenceEpic* THIS = additionalData->PresencePtr;
 
 	if (data->ResultCode == EOS_EResult::EOS_Success)
@@ -221,8 +234,6 @@ void FOnlinePresenceEpic::EOS_QueryExternalAccountMappingsForPresenceComplete(EO
 	{
 		UE_LOG_ONLINE_PRESENCE(Warning, TEXT("Couldn't query external account mapping for presence information"));
 	}
-
-	delete additionalData;
 }
 
 
@@ -283,6 +294,12 @@ FOnlinePresenceEpic::FOnlinePresenceEpic(FOnlineSubsystemEpic const* InSubsystem
 	};
 }
 
+FOnlinePresenceEpic::~FOnlinePresenceEpic()
+{
+	// Queries still running can't reach this instance anymore
+	FOperationContextPoolEpic::ReleaseAll(this);
+}
+
 void FOnlinePresenceEpic::SetPresence(const FUniqueNetId& User, const FOnlineUserPresenceStatus& Status, const FOnPresenceTaskCompleteDelegate& Delegate)
 {
 	FString error;
@@ -346,12 +363,12 @@ void FOnlinePresenceEpic::SetPresence(const FUniqueNetId& User, const FOnlineUse
 							epicNetId.ToEpicAccountId(),
 							modHandle
 						};
-						FPresenceAdditionalData* additionalData = new FPresenceAdditionalData{
+						void* clientData = PresenceContexts.Add(this, FPresenceAdditionalData{
 							this,
 							epicNetId,
 							Delegate
-						};
-						EOS_Presence_SetPresence(this->presenceHandle, &setPresenceOptions, additionalData, &FOnlinePresenceEpic::EOS_SetPresenceComplete);
+						});
+						EOS_Presence_SetPresence(this->presenceHandle, &setPresenceOptions, clientData, &FOnlinePresenceEpic::EOS_SetPresenceComplete);
 					}
 					else
 					{
@@ -394,12 +411,12 @@ void FOnlinePresenceEpic::QueryPresence(const FUniqueNetId& User, const FOnPrese
 			epicUser.ToEpicAccountId(),
 			epicUser.ToEpicAccountId()
 		};
-		FPresenceAdditionalData* additionalData = new FPresenceAdditionalData{
+		void* clientData = PresenceContexts.Add(this, FPresenceAdditionalData{
 			this,
 			epicUser,
 			Delegate
-		};
-		EOS_Presence_QueryPresence(this->presenceHandle, &queryPresenceOptions, additionalData, &FOnlinePresenceEpic::EOS_QueryPresenceComplete);
+		});
+		EOS_Presence_QueryPresence(this->presenceHandle, &queryPresenceOptions, clientData, &FOnlinePresenceEpic::EOS_QueryPresenceComplete);
 	}
 	else
 	{
@@ -28,6 +28,8 @@ private:
 public:
 	FOnlinePresenceEpic(FOnlineSubsystemEpic const* InSubsystem);
 
+	virtual ~FOnlinePresenceEpic();
+
 	virtual void SetPresence(const FUniqueNetId& User, const FOnlineUserPresenceStatus& Status, const FOnPresenceTaskCompleteDelegate& Delegate = FOnPresenceTaskCompleteDelegate()) override;
 
 	virtual void QueryPresence(const FUniqueNetId& User, const FOnPresenceTaskCompleteDelegate& Delegate = FOnPresenceTaskCompleteDelegate()) override;
@@ -1,11 +1,16 @@
 #include "OnlineSessionInterfaceEpic.h"
-#include "Misc/ScopeLock.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/MemStack.h"
 #include "OnlineSubsystemEpicTypes.h"
 #include "OnlineSubsystem.h"
 #include "Interfaces/OnlineIdentityInterface.h"
 #include "eos_sessions.h"
 #include "SocketSubsystem.h"
+#include "IPAddress.h"
 #include "Utilities.h"
+#include "OperationContextPoolEpic.h"
+#include "OnlineSubsystemEpic.h"
+#include "OnlineIdentityInterfaceEpic.h"
 #include "eos_auth.h"
 
 // ---------------------------------------------
@@ -44,44 +49,72 @@ typedef struct FSessionStateChangeAdditionalData
 typedef struct FUpdateSessionAdditionalData
 {
 	FOnlineSessionEpic* OnlineSessionPtr;
-	FOnlineSessionSettings OldSessionSettings;
+	FName SessionName;
 } FUpdateSessionAdditionalData;
 
 /**
  * To find the search handle in the callback,
- * the key needs to be passed along.
+ * the search id needs to be passed along.
  */
 typedef struct FFindSessionsAdditionalData {
 	FOnlineSessionEpic* OnlineSessionPtr;
-	double SearchStartTime;
+	uint64 SearchId;
+	EOS_HSessionSearch SearchHandle;
 } FFindSessionsAdditionalData;
 
 typedef struct FJoinSessionAdditionalData
 {
 	FOnlineSessionEpic* OnlineSessionPtr;
 	FName SessionName;
+	bool bForMatchmaking;
 } FJoinSessionAdditionalData;
 
-typedef struct FFindFriendSessionAdditionalData
+typedef struct FRosterCallAdditionalData
 {
 	FOnlineSessionEpic* OnlineSessionPtr;
-	double SearchCreationTime;
-	FUniqueNetId const& SearchingUserId;
-} FFindFriendSessionAdditionalData;
+	FName SessionName;
+	TArray<TSharedRef<const FUniqueNetId>> Players;
+	TSharedRef<FRosterBatchEpic> Batch;
+} FRosterCallAdditionalData;
 
-typedef struct FRegisterPlayersAdditionalData
+typedef struct FSessionLookupAdditionalData
 {
 	FOnlineSessionEpic* OnlineSessionPtr;
-	FName SessionName;
-	TArray<TSharedRef<const FUniqueNetId>> RegisteredPlayers;
-} FRegisterPlayersAdditionalData;
+	EOS_HSessionSearch SearchHandle;
+	FOnSessionSearchCompleteEpic OnComplete;
+} FSessionLookupAdditionalData;
 
 typedef struct FCreateSessionAdditionalData
 {
 	FOnlineSessionEpic* OnlineSessionPtr;
 	TSharedRef<FUniqueNetId const> CreatingUserId;
+	FOnlineSessionSettings PushedSessionSettings;
+	bool bForMatchmaking;
 } FCreateSessionAdditionalData;
 
+typedef struct FSendInviteAdditionalData
+{
+	FOnlineSessionEpic* OnlineSessionPtr;
+} FSendInviteAdditionalData;
+
+/** Contexts of the running operations, passed to the EOS SDK as client data */
+static TOperationContextPoolEpic<FSessionStateChangeAdditionalData> SessionStateChangeContexts(TEXT("SessionStateChange"));
+static TOperationContextPoolEpic<FUpdateSessionAdditionalData> UpdateSessionContexts(TEXT("UpdateSession"));
+static TOperationContextPoolEpic<FFindSessionsAdditionalData> FindSessionsContexts(TEXT("FindSessions"), [](FFindSessionsAdditionalData& Context)
+	{
+		// A pending find owns the handle of its search
+		EOS_SessionSearch_Release(Context.SearchHandle);
+	});
+static TOperationContextPoolEpic<FJoinSessionAdditionalData> JoinSessionContexts(TEXT("JoinSession"));
+static TOperationContextPoolEpic<FRosterCallAdditionalData> RosterCallContexts(TEXT("RosterCall"));
+static TOperationContextPoolEpic<FSessionLookupAdditionalData> SessionLookupContexts(TEXT("SessionLookup"), [](FSessionLookupAdditionalData& Context)
+	{
+		// The lookup owns its search handle, which is otherwise released in its callback
+		EOS_SessionSearch_Release(Context.SearchHandle);
+	});
+static TOperationContextPoolEpic<FCreateSessionAdditionalData> CreateSessionContexts(TEXT("CreateSession"));
+static TOperationContextPoolEpic<FSendInviteAdditionalData> SendInviteContexts(TEXT("SendInvite"));
+
 
 // ---------------------------------------------
 // Free functions/Utility functions.
@@ -89,6 +122,404 @@ typedef struct FCreateSessionAdditionalData
 // Most free functions should be moved to be private class functions
 // ---------------------------------------------
 
+/**
+ * Maps the advertisement settings to an EOS permission level.
+ * More restrictive from left to right. More restrictive takes precedence.
+ */
+static EOS_EOnlineSessionPermissionLevel GetPermissionLevel(FOnlineSessionSettings const& SessionSettings)
+{
+	EOS_EOnlineSessionPermissionLevel permissionLevel = EOS_EOnlineSessionPermissionLevel::EOS_OSPF_InviteOnly;
+	if (SessionSettings.bShouldAdvertise)
+	{
+		if (SessionSettings.bAllowJoinViaPresence)
+		{
+			permissionLevel = EOS_EOnlineSessionPermissionLevel::EOS_OSPF_PublicAdvertised;
+		}
+		if (SessionSettings.bAllowJoinViaPresenceFriendsOnly)
+		{
+			permissionLevel = EOS_EOnlineSessionPermissionLevel::EOS_OSPF_JoinViaPresence;
+		}
+	}
+	return permissionLevel;
+}
+
+/**
+ * Converts a string to UTF-8, stored in a scratch arena.
+ * The returned string is valid until the arena is popped.
+ */
+static char const* ToScratchUtf8(TCHAR const* Str, int32 Len, FMemStackBase& Scratch)
+{
+	int32 const utf8Len = FTCHARToUTF8_Convert::ConvertedLength(Str, Len);
+	ANSICHAR* utf8 = (ANSICHAR*)Scratch.PushBytes(utf8Len + 1, alignof(ANSICHAR));
+	FTCHARToUTF8_Convert::Convert(utf8, utf8Len, Str, Len);
+	utf8[utf8Len] = '\0';
+	return utf8;
+}
+
+/** Converts a name to UTF-8, stored in a scratch arena */
+static char const* ToScratchUtf8(FName const& Name, FMemStackBase& Scratch)
+{
+	TCHAR nameStr[NAME_SIZE];
+	uint32 const nameLen = Name.ToString(nameStr, NAME_SIZE);
+	return ToScratchUtf8(nameStr, nameLen, Scratch);
+}
+
+/** Writes the value of a built-in session setting into an EOS attribute */
+typedef void(*FEncodeBuiltInSessionAttribute)(FOnlineSessionSettings const& SessionSettings, EOS_Sessions_AttributeData& OutAttributeData);
+
+/** A session setting that is always advertised as EOS attribute */
+struct FBuiltInSessionAttribute
+{
+	/** The attribute key, already UTF-8 encoded */
+	char const* Key;
+
+	/** Writes the value of the setting */
+	FEncodeBuiltInSessionAttribute Encode;
+};
+
+#define BUILTIN_SESSION_ATTRIBUTE_INT(Member) \
+	{ #Member, [](FOnlineSessionSettings const& SessionSettings, EOS_Sessions_AttributeData& OutAttributeData) \
+		{ \
+			OutAttributeData.ValueType = EOS_ESessionAttributeType::EOS_AT_INT64; \
+			OutAttributeData.Value.AsInt64 = SessionSettings.Member; \
+		} }
+
+#define BUILTIN_SESSION_ATTRIBUTE_BOOL(Member) \
+	{ #Member, [](FOnlineSessionSettings const& SessionSettings, EOS_Sessions_AttributeData& OutAttributeData) \
+		{ \
+			OutAttributeData.ValueType = EOS_ESessionAttributeType::EOS_AT_BOOLEAN; \
+			OutAttributeData.Value.AsBool = SessionSettings.Member ? EOS_TRUE : EOS_FALSE; \
+		} }
+
+/** The built-in session settings. The attribute keys match the member names */
+static FBuiltInSessionAttribute const BuiltInSessionAttributes[] =
+{
+	BUILTIN_SESSION_ATTRIBUTE_INT(NumPublicConnections),
+	BUILTIN_SESSION_ATTRIBUTE_INT(NumPrivateConnections),
+	BUILTIN_SESSION_ATTRIBUTE_BOOL(bUsesPresence),
+	BUILTIN_SESSION_ATTRIBUTE_BOOL(bIsLANMatch),
+	BUILTIN_SESSION_ATTRIBUTE_BOOL(bIsDedicated),
+	BUILTIN_SESSION_ATTRIBUTE_BOOL(bUsesStats),
+	BUILTIN_SESSION_ATTRIBUTE_BOOL(bAllowInvites),
+	BUILTIN_SESSION_ATTRIBUTE_BOOL(bAntiCheatProtected),
+	BUILTIN_SESSION_ATTRIBUTE_INT(BuildUniqueId)
+};
+
+#undef BUILTIN_SESSION_ATTRIBUTE_INT
+#undef BUILTIN_SESSION_ATTRIBUTE_BOOL
+
+/** A boolean session setting packed into the compact session flags attribute */
+struct FCompactSessionFlag
+{
+	/** The search parameter key of the setting, same as the key of its built-in attribute */
+	TCHAR const* Key;
+
+	/** The UTF-8 encoded key of the setting's built-in attribute, advertised by hosts without compact session flags */
+	char const* AttributeKey;
+
+	/** The setting itself */
+	bool FOnlineSessionSettings::* Member;
+};
+
+#define COMPACT_SESSION_FLAG(Member) { TEXT(#Member), #Member, &FOnlineSessionSettings::Member }
+
+/**
+ * The settings packed into the compact session flags attribute. The bit of a flag is its index.
+ * Hosts and clients have to agree on the layout, so only ever append to this list
+ */
+static FCompactSessionFlag const CompactSessionFlags[] =
+{
+	COMPACT_SESSION_FLAG(bUsesPresence),
+	COMPACT_SESSION_FLAG(bIsLANMatch),
+	COMPACT_SESSION_FLAG(bIsDedicated),
+	COMPACT_SESSION_FLAG(bUsesStats),
+	COMPACT_SESSION_FLAG(bAllowInvites),
+	COMPACT_SESSION_FLAG(bAntiCheatProtected)
+};
+
+#undef COMPACT_SESSION_FLAG
+
+static int32 const NumCompactSessionFlags = sizeof(CompactSessionFlags) / sizeof(CompactSessionFlags[0]);
+
+/** The key of the compact session flags attribute */
+static char const* const CompactSessionFlagsKey = "SessionFlags";
+
+/** The search parameter key EOS uses for the bucket id */
+static FName const EosBucketIdKey(UTF8_TO_TCHAR(EOS_SESSIONS_SEARCH_BUCKET_ID));
+
+/** Packs the boolean session settings into a bitmask */
+static int64 EncodeSessionFlags(FOnlineSessionSettings const& SessionSettings)
+{
+	int64 flags = 0;
+	for (int32 i = 0; i < NumCompactSessionFlags; ++i)
+	{
+		if (SessionSettings.*CompactSessionFlags[i].Member)
+		{
+			flags |= int64(1) << i;
+		}
+	}
+	return flags;
+}
+
+/** Unpacks the boolean session settings from a bitmask */
+static void DecodeSessionFlags(int64 Flags, FOnlineSessionSettings& OutSessionSettings)
+{
+	for (int32 i = 0; i < NumCompactSessionFlags; ++i)
+	{
+		OutSessionSettings.*CompactSessionFlags[i].Member = (Flags & (int64(1) << i)) != 0;
+	}
+}
+
+/** Returns the bit of the compact session flag with the given key. INDEX_NONE if the key isn't a compact session flag */
+static int32 FindCompactSessionFlag(FName const& Key)
+{
+	for (int32 i = 0; i < NumCompactSessionFlags; ++i)
+	{
+		if (Key == CompactSessionFlags[i].Key)
+		{
+			return i;
+		}
+	}
+	return INDEX_NONE;
+}
+
+/**
+ * Turns the search parameters on compact session flags into a bitmask filter.
+ * EOS can't compare single bits of an attribute, so sessions are filtered on the client.
+ * A session passes if (Flags & OutMask) == OutValue
+ */
+static void GetSessionFlagsFilter(FOnlineSearchSettings const& SearchSettings, int64& OutMask, int64& OutValue)
+{
+	OutMask = 0;
+	OutValue = 0;
+	for (auto const& param : SearchSettings.SearchParams)
+	{
+		int32 const flagIdx = FindCompactSessionFlag(param.Key);
+		if (flagIdx == INDEX_NONE || param.Value.Data.GetType() != EOnlineKeyValuePairDataType::Bool)
+		{
+			continue;
+		}
+
+		bool bValue = false;
+		param.Value.Data.GetValue(bValue);
+		if (param.Value.ComparisonOp == EOnlineComparisonOp::NotEquals)
+		{
+			bValue = !bValue;
+		}
+
+		int64 const flag = int64(1) << flagIdx;
+		OutMask |= flag;
+		OutValue = bValue ? OutValue | flag : OutValue & ~flag;
+	}
+}
+
+/** Returns the fields that differ between two results for the same session */
+static ESessionResultFieldsEpic DiffSearchResult(FOnlineSessionSearchResult const& PreviousResult, FOnlineSessionSearchResult const& SearchResult)
+{
+	FOnlineSession const& previousSession = PreviousResult.Session;
+	FOnlineSession const& session = SearchResult.Session;
+
+	ESessionResultFieldsEpic changedFields = ESessionResultFieldsEpic::None;
+	if (previousSession.NumOpenPublicConnections != session.NumOpenPublicConnections
+		|| previousSession.NumOpenPrivateConnections != session.NumOpenPrivateConnections)
+	{
+		changedFields |= ESessionResultFieldsEpic::OpenConnections;
+	}
+	if (previousSession.SessionSettings.NumPublicConnections != session.SessionSettings.NumPublicConnections
+		|| previousSession.SessionSettings.NumPrivateConnections != session.SessionSettings.NumPrivateConnections)
+	{
+		changedFields |= ESessionResultFieldsEpic::MaxConnections;
+	}
+	// Results that weren't pinged yet keep their last ping, see DiffSearchResults
+	if (SearchResult.PingInMs >= 0 && PreviousResult.PingInMs != SearchResult.PingInMs)
+	{
+		changedFields |= ESessionResultFieldsEpic::Ping;
+	}
+
+	TSharedPtr<FOnlineSessionInfoEpic const> previousSessionInfo = StaticCastSharedPtr<FOnlineSessionInfoEpic const>(previousSession.SessionInfo);
+	TSharedPtr<FOnlineSessionInfoEpic const> sessionInfo = StaticCastSharedPtr<FOnlineSessionInfoEpic const>(session.SessionInfo);
+	bool const bHadHostAddr = previousSessionInfo.IsValid() && previousSessionInfo->HostAddr.IsValid();
+	bool const bHasHostAddr = sessionInfo.IsValid() && sessionInfo->HostAddr.IsValid();
+	if (bHadHostAddr != bHasHostAddr || (bHasHostAddr && !(*previousSessionInfo->HostAddr == *sessionInfo->HostAddr)))
+	{
+		changedFields |= ESessionResultFieldsEpic::HostAddress;
+	}
+
+	if (EncodeSessionFlags(previousSession.SessionSettings) != EncodeSessionFlags(session.SessionSettings))
+	{
+		changedFields |= ESessionResultFieldsEpic::SessionFlags;
+	}
+
+	FSessionSettings const& previousSettings = previousSession.SessionSettings.Settings;
+	FSessionSettings const& settings = session.SessionSettings.Settings;
+	bool bSettingsChanged = previousSettings.Num() != settings.Num();
+	for (auto It = settings.CreateConstIterator(); It && !bSettingsChanged; ++It)
+	{
+		FOnlineSessionSetting const* previousSetting = previousSettings.Find(It.Key());
+		bSettingsChanged = !previousSetting || !(previousSetting->Data == It.Value().Data);
+	}
+	if (bSettingsChanged)
+	{
+		changedFields |= ESessionResultFieldsEpic::Settings;
+	}
+
+	bool const bOwnerIdChanged = previousSession.OwningUserId.IsValid() != session.OwningUserId.IsValid()
+		|| (session.OwningUserId.IsValid() && *previousSession.OwningUserId != *session.OwningUserId);
+	if (bOwnerIdChanged || previousSession.OwningUserName != session.OwningUserName)
+	{
+		changedFields |= ESessionResultFieldsEpic::Owner;
+	}
+
+	return changedFields;
+}
+
+/**
+ * Compares the results of the last run of a differential search to the results of the previous one.
+ * The current results replace the previous ones afterwards.
+ * @param PreparedSearch - The differential search
+ * @param OutDeltas - Receives the added, removed and changed results
+ */
+static void DiffSearchResults(FPreparedSessionSearchEpic& PreparedSearch, TArray<FSessionResultDeltaEpic>& OutDeltas)
+{
+	TArray<FOnlineSessionSearchResult> const& searchResults = PreparedSearch.SessionSearch->SearchResults;
+
+	TMap<FString, FOnlineSessionSearchResult> currentResults;
+	currentResults.Reserve(searchResults.Num());
+	for (int32 resultIndex = 0; resultIndex < searchResults.Num(); ++resultIndex)
+	{
+		FOnlineSessionSearchResult const& searchResult = searchResults[resultIndex];
+		FString const sessionId = searchResult.GetSessionIdStr();
+		if (currentResults.Contains(sessionId))
+		{
+			continue;
+		}
+		FOnlineSessionSearchResult& currentResult = currentResults.Add(sessionId, searchResult);
+
+		// Pings mostly arrive after the run completed. Until then the last known ping is kept,
+		// so OnPreparedSearchResultPinged only reports pings that actually changed
+		FOnlineSessionSearchResult const* previousResult = PreparedSearch.PreviousResults.Find(sessionId);
+		if (previousResult && currentResult.PingInMs < 0)
+		{
+			currentResult.PingInMs = previousResult->PingInMs;
+		}
+		if (!previousResult)
+		{
+			OutDeltas.Add(FSessionResultDeltaEpic{ ESessionResultChangeEpic::Added, sessionId, resultIndex, ESessionResultFieldsEpic::None });
+			continue;
+		}
+
+		ESessionResultFieldsEpic const changedFields = DiffSearchResult(*previousResult, searchResult);
+		if (changedFields != ESessionResultFieldsEpic::None)
+		{
+			OutDeltas.Add(FSessionResultDeltaEpic{ ESessionResultChangeEpic::Changed, sessionId, resultIndex, changedFields });
+		}
+	}
+
+	for (auto const& previousResult : PreparedSearch.PreviousResults)
+	{
+		if (!currentResults.Contains(previousResult.Key))
+		{
+			OutDeltas.Add(FSessionResultDeltaEpic{ ESessionResultChangeEpic::Removed, previousResult.Key, INDEX_NONE, ESessionResultFieldsEpic::None });
+		}
+	}
+
+	PreparedSearch.PreviousResults = MoveTemp(currentResults);
+}
+
+/** Copies the compact session flags of a session. Returns false if the session doesn't advertise them */
+static bool CopySessionFlags(EOS_HSessionDetails DetailsHandle, int64& OutFlags)
+{
+	EOS_SessionDetails_CopySessionAttributeByKeyOptions copyAttributeOptions = {
+		EOS_SESSIONDETAILS_COPYSESSIONATTRIBUTEBYKEY_API_LATEST,
+		CompactSessionFlagsKey
+	};
+	EOS_SessionDetails_Attribute* attribute = nullptr;
+	if (EOS_SessionDetails_CopySessionAttributeByKey(DetailsHandle, &copyAttributeOptions, &attribute) != EOS_EResult::EOS_Success)
+	{
+		return false;
+	}
+
+	bool const bIsInt = attribute->Data && attribute->Data->ValueType == EOS_ESessionAttributeType::EOS_AT_INT64;
+	if (bIsInt)
+	{
+		OutFlags = attribute->Data->Value.AsInt64;
+	}
+	EOS_SessionDetails_Attribute_Release(attribute);
+	return bIsInt;
+}
+
+/**
+ * Copies the boolean session settings of a session that advertises them as individual attributes.
+ * Only the settings in Mask are copied. Returns false if the session doesn't advertise one of them
+ */
+static bool CopyIndividualSessionFlags(EOS_HSessionDetails DetailsHandle, int64 Mask, int64& OutFlags)
+{
+	OutFlags = 0;
+	for (int32 i = 0; i < NumCompactSessionFlags; ++i)
+	{
+		int64 const flag = int64(1) << i;
+		if ((Mask & flag) == 0)
+		{
+			continue;
+		}
+
+		EOS_SessionDetails_CopySessionAttributeByKeyOptions copyAttributeOptions = {
+			EOS_SESSIONDETAILS_COPYSESSIONATTRIBUTEBYKEY_API_LATEST,
+			CompactSessionFlags[i].AttributeKey
+		};
+		EOS_SessionDetails_Attribute* attribute = nullptr;
+		if (EOS_SessionDetails_CopySessionAttributeByKey(DetailsHandle, &copyAttributeOptions, &attribute) != EOS_EResult::EOS_Success)
+		{
+			return false;
+		}
+
+		bool const bIsBool = attribute->Data && attribute->Data->ValueType == EOS_ESessionAttributeType::EOS_AT_BOOLEAN;
+		if (bIsBool && attribute->Data->Value.AsBool == EOS_TRUE)
+		{
+			OutFlags |= flag;
+		}
+		EOS_SessionDetails_Attribute_Release(attribute);
+		if (!bIsBool)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Returns true if two encoded built-in attributes hold the same value */
+static bool BuiltInAttributeValuesEqual(EOS_Sessions_AttributeData const& A, EOS_Sessions_AttributeData const& B)
+{
+	if (A.ValueType != B.ValueType)
+	{
+		return false;
+	}
+	return A.ValueType == EOS_ESessionAttributeType::EOS_AT_BOOLEAN
+		? A.Value.AsBool == B.Value.AsBool
+		: A.Value.AsInt64 == B.Value.AsInt64;
+}
+
+/**
+ * Looks up a value interned by a UTF-8 string. Doesn't allocate
+ * @returns - The interned value. Null if the string wasn't interned, or a different string with the same hash was
+ */
+template <typename ValueType>
+static ValueType const* FindInterned(TLruCache<uint32, TInternedValueEpic<ValueType>>& Cache, uint32 KeyHash, char const* Key)
+{
+	TInternedValueEpic<ValueType> const* interned = Cache.FindAndTouch(KeyHash);
+	return interned && FCStringAnsi::Strcmp(interned->Key.GetData(), Key) == 0 ? &interned->Value : nullptr;
+}
+
+/** Interns a value by a UTF-8 string, replacing the value of a string with the same hash */
+template <typename ValueType>
+static void AddInterned(TLruCache<uint32, TInternedValueEpic<ValueType>>& Cache, uint32 KeyHash, char const* Key, ValueType const& Value)
+{
+	TInternedValueEpic<ValueType> interned;
+	interned.Key.Append(Key, FCStringAnsi::Strlen(Key) + 1);
+	interned.Value = Value;
+	Cache.Add(KeyHash, interned);
+}
+
 TPair<bool, TSharedPtr<FInternetAddr>> FOnlineSessionEpic::StringToInternetAddress(FString addressStr)
 {
 	TSharedPtr<FInternetAddr> address = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
@@ -103,16 +534,52 @@ TPair<bool, TSharedPtr<FInternetAddr>> FOnlineSessionEpic::StringToInternetAddre
 	return MakeTuple(isValid, address);
 }
 
-void FOnlineSessionEpic::SetSessionDetails(FOnlineSession* session, EOS_SessionDetails_Info const* SessionDetails)
+bool FOnlineSessionEpic::SetSessionDetails(FOnlineSession* session, EOS_SessionDetails_Info const* SessionDetails, EOS_HSessionDetails DetailsHandle)
 {
 	// Update the maximum number of open connections
 	session->NumOpenPublicConnections = SessionDetails->NumOpenPublicConnections;
+	if (SessionDetails->Settings)
+	{
+		session->SessionSettings.NumPublicConnections = SessionDetails->Settings->NumPublicConnections;
+	}
+
+	// Setup the host session info.
+	// Host addresses and session infos are interned, so refreshing a known session doesn't allocate
+	char const* hostAddress = SessionDetails->HostAddress ? SessionDetails->HostAddress : "";
+	uint32 const hostAddressHash = FCrc::StrCrc32(hostAddress);
+	TSharedPtr<FInternetAddr> const* internedHostAddr = FindInterned(this->HostAddressCache, hostAddressHash, hostAddress);
+	TSharedPtr<FInternetAddr> hostAddr = internedHostAddr ? *internedHostAddr : nullptr;
+	if (!internedHostAddr)
+	{
+		hostAddr = this->StringToInternetAddress(UTF8_TO_TCHAR(hostAddress)).Get<1>();
+		AddInterned(this->HostAddressCache, hostAddressHash, hostAddress, hostAddr);
+	}
+
+	uint32 const sessionIdHash = FCrc::StrCrc32(SessionDetails->SessionId);
+	TSharedPtr<FOnlineSessionInfoEpic> const* internedSessionInfo = FindInterned(this->SessionInfoCache, sessionIdHash, SessionDetails->SessionId);
+	if (internedSessionInfo && (*internedSessionInfo)->HostAddr == hostAddr)
+	{
+		session->SessionInfo = *internedSessionInfo;
+	}
+	else
+	{
+		// A session keeps its id, even if its host moved
+		TSharedPtr<FOnlineSessionInfoEpic> sessionInfo = MakeShared<FOnlineSessionInfoEpic>();
+		sessionInfo->HostAddr = hostAddr;
+		sessionInfo->SessionId = internedSessionInfo
+			? (*internedSessionInfo)->SessionId
+			: this->CreateSessionIdFromString(UTF8_TO_TCHAR(SessionDetails->SessionId));
+		AddInterned(this->SessionInfoCache, sessionIdHash, SessionDetails->SessionId, sessionInfo);
+		session->SessionInfo = sessionInfo;
+	}
 
-	// Setup the host session info
-	TSharedPtr<FOnlineSessionInfoEpic> sessionInfo = MakeShared<FOnlineSessionInfoEpic>();
-	sessionInfo->HostAddr = this->StringToInternetAddress(UTF8_TO_TCHAR(SessionDetails->HostAddress)).Get<1>();
-	sessionInfo->SessionId = this->CreateSessionIdFromString(UTF8_TO_TCHAR(SessionDetails->SessionId));
-	session->SessionInfo = sessionInfo;
+	// Sessions advertising compact session flags carry all boolean settings in a single attribute
+	int64 sessionFlags = 0;
+	bool const bHasCompactSessionFlags = DetailsHandle && CopySessionFlags(DetailsHandle, sessionFlags);
+	if (bHasCompactSessionFlags)
+	{
+		DecodeSessionFlags(sessionFlags, session->SessionSettings);
+	}
 
 	// ToDo: Do we want to do this here?
 	//	// Replace the session settings with updated ones from the server
@@ -126,21 +593,23 @@ void FOnlineSessionEpic::SetSessionDetails(FOnlineSession* session, EOS_SessionD
 	//	session->SessionSettings.bAllowInvites = eosSessionSettings->bInvitesAllowed == EOS_TRUE ? true : false;
 	//	
 	//	session->SessionSettings.BuildUniqueId = this->Subsystem->GetBuildUniqueId();
+
+	return bHasCompactSessionFlags;
 }
 
 /**
  * Creates EOS Attribute data from UE4s variant data
- * @param attributeName - The name for the data.
+ * @param attributeKey - The UTF-8 encoded name for the data. Must outlive the returned data
  * @param variantData - The variable data itself
- * @outAttributeData - The EOS AttributeData populated with the variant data
+ * @param scratch - Arena owning string values. Must not be popped before the returned data was passed to EOS
  * @error - The error message if the creation was unsuccessful
- * @returns - True if the creation was successful, false otherwise
+ * @returns - The EOS AttributeData populated with the variant data
 */
-EOS_Sessions_AttributeData FOnlineSessionEpic::CreateEOSAttributeData(FString const attributeName, FVariantData const variantData, FString& error)
+EOS_Sessions_AttributeData FOnlineSessionEpic::CreateEOSAttributeData(char const* attributeKey, FVariantData const& variantData, FMemStackBase& scratch, FString& error)
 {
 	EOS_Sessions_AttributeData outAttributeData;
 	outAttributeData.ApiVersion = EOS_SESSIONS_SESSIONATTRIBUTEDATA_API_LATEST;
-	outAttributeData.Key = TCHAR_TO_UTF8(*attributeName);
+	outAttributeData.Key = attributeKey;
 
 	bool success = false;
 	if (variantData.GetType() == EOnlineKeyValuePairDataType::Json
@@ -200,7 +669,7 @@ EOS_Sessions_AttributeData FOnlineSessionEpic::CreateEOSAttributeData(FString co
 	{
 		FString sData;
 		variantData.GetValue(sData);
-		outAttributeData.Value.AsUtf8 = TCHAR_TO_UTF8(*sData);
+		outAttributeData.Value.AsUtf8 = ToScratchUtf8(*sData, sData.Len(), scratch);
 		outAttributeData.ValueType = EOS_ESessionAttributeType::EOS_AT_STRING;
 		success = true;
 	}
@@ -241,12 +710,38 @@ bool FOnlineSessionEpic::GetConnectStringFromSessionInfo(TSharedPtr<FOnlineSessi
 	return bSuccess;
 }
 
-/** Takes the session search handle and populates it the session query settings */
-void FOnlineSessionEpic::UpdateSessionSearchParameters(TSharedRef<FOnlineSessionSearch> const& sessionSearchPtr, EOS_HSessionSearch eosSessionSearch, FString& error)
+bool FOnlineSessionEpic::PrepareSearchParameters(FUniqueNetId const& SearchingPlayerId, FOnlineSessionSearch const& SessionSearch, FPreparedSessionSearchEpic& OutPreparedSearch, FString& error)
 {
-	FOnlineSearchSettings SearchSettings = sessionSearchPtr->QuerySettings;
-	for (auto param : SearchSettings.SearchParams)
+	OutPreparedSearch.Fingerprint = GetSearchFingerprint(SearchingPlayerId, SessionSearch);
+	OutPreparedSearch.MaxSearchResults = SessionSearch.MaxSearchResults;
+	if (this->bCompactSessionFlags)
+	{
+		GetSessionFlagsFilter(SessionSearch.QuerySettings, OutPreparedSearch.FlagsMask, OutPreparedSearch.FlagsValue);
+	}
+
+	// Keys and string values are converted in scratch memory and then copied into the prepared search
+	FMemMark scratchMark(FMemStack::Get());
+
+	FOnlineSearchSettings const& SearchSettings = SessionSearch.QuerySettings;
+	for (auto const& param : SearchSettings.SearchParams)
 	{
+		if (param.Value.Data.GetType() == EOnlineKeyValuePairDataType::Empty)
+		{
+			continue;
+		}
+
+		// Compact session flags are filtered on the client, see GetSessionFlagsFilter
+		if (this->bCompactSessionFlags && FindCompactSessionFlag(param.Key) != INDEX_NONE)
+		{
+			if (param.Value.Data.GetType() != EOnlineKeyValuePairDataType::Bool
+				|| (param.Value.ComparisonOp != EOnlineComparisonOp::Equals && param.Value.ComparisonOp != EOnlineComparisonOp::NotEquals))
+			{
+				error = FString::Printf(TEXT("%s can only be compared to a bool with Equals or NotEquals."), *param.Key.ToString());
+				return false;
+			}
+			continue;
+		}
+
 		EOS_EOnlineComparisonOp compOp = EOS_EOnlineComparisonOp::EOS_CO_ANYOF;
 		switch (param.Value.ComparisonOp)
 		{
@@ -347,373 +842,1724 @@ void FOnlineSessionEpic::UpdateSessionSearchParameters(TSharedRef<FOnlineSession
 
 		if (!error.IsEmpty())
 		{
-			// ToDo: Maybe return nullptr here?
-			return;
+			return false;
 		}
 
 		// Create the attribute data struct
-		EOS_Sessions_AttributeData attributeData = CreateEOSAttributeData(param.Key.ToString(), param.Value.Data, error);
-		if (error.IsEmpty())
+		EOS_Sessions_AttributeData attributeData = CreateEOSAttributeData(ToScratchUtf8(param.Key, FMemStack::Get()), param.Value.Data, FMemStack::Get(), error);
+		if (!error.IsEmpty())
 		{
-			EOS_SessionSearch_SetParameterOptions eosParam = {
-				EOS_SESSIONSEARCH_SETPARAMETER_API_LATEST,
-				&attributeData,
-				compOp
-			};
-
-			// Pass the parameter to the session search
-			EOS_SessionSearch_SetParameter(eosSessionSearch, &eosParam);
+			return false;
 		}
-		else
+
+		// The strings are stored by offset, so the prepared search stays valid when it's copied
+		FPreparedSearchParamEpic& preparedParam = OutPreparedSearch.Params[OutPreparedSearch.Params.AddDefaulted()];
+		preparedParam.Data = attributeData;
+		preparedParam.ComparisonOp = compOp;
+		preparedParam.KeyOffset = OutPreparedSearch.Strings.Num();
+		OutPreparedSearch.Strings.Append(attributeData.Key, FCStringAnsi::Strlen(attributeData.Key) + 1);
+		preparedParam.ValueOffset = INDEX_NONE;
+		if (attributeData.ValueType == EOS_ESessionAttributeType::EOS_AT_STRING)
 		{
-			return;
+			preparedParam.ValueOffset = OutPreparedSearch.Strings.Num();
+			OutPreparedSearch.Strings.Append(attributeData.Value.AsUtf8, FCStringAnsi::Strlen(attributeData.Value.AsUtf8) + 1);
 		}
 	}
+
+	return true;
 }
 
-void FOnlineSessionEpic::CreateSessionModificationHandle(FOnlineSessionSettings const& NewSessionSettings, EOS_HSessionModification& ModificationHandle, FString& Error)
+void FOnlineSessionEpic::ApplySearchParameters(FPreparedSessionSearchEpic const& PreparedSearch, EOS_HSessionSearch eosSessionSearch)
 {
-	// Note on GoTo usage:
-	// Goto was used here to remove duplicate calls to Printf
-	// and make error handling easier in general.
-	// Initializations need to be put in their own scope
+	for (FPreparedSearchParamEpic const& preparedParam : PreparedSearch.Params)
+	{
+		EOS_Sessions_AttributeData attributeData = preparedParam.Data;
+		attributeData.Key = PreparedSearch.Strings.GetData() + preparedParam.KeyOffset;
+		if (preparedParam.ValueOffset != INDEX_NONE)
+		{
+			attributeData.Value.AsUtf8 = PreparedSearch.Strings.GetData() + preparedParam.ValueOffset;
+		}
+
+		EOS_SessionSearch_SetParameterOptions eosParam = {
+			EOS_SESSIONSEARCH_SETPARAMETER_API_LATEST,
+			&attributeData,
+			preparedParam.ComparisonOp
+		};
 
+		// Pass the parameter to the session search
+		EOS_SessionSearch_SetParameter(eosSessionSearch, &eosParam);
+	}
+}
+
+int32 FOnlineSessionEpic::CreateSessionModificationHandle(FOnlineSessionSettings const& NewSessionSettings, FOnlineSessionSettings const* PushedSessionSettings, EOS_HSessionModification ModificationHandle, FString& Error)
+{
+	int32 numChanges = 0;
 	EOS_EResult eosResult = EOS_EResult::EOS_Success;
-	FString setting;
-	FVariantData data;
-	FString error;
 
-	// NumPublicConnections
+	// Owns converted keys and string values. EOS copies the attribute data, so they only need to live for this call
+	FMemStackBase& scratch = FMemStack::Get();
+	FMemMark scratchMark(scratch);
+
+	// Adds a single attribute to the modification handle
+	auto addAttribute = [&](EOS_Sessions_AttributeData const& AttributeData, EOnlineDataAdvertisementType::Type AdvertisementType) -> bool
+	{
+		EOS_SessionModification_AddAttributeOptions attrOpts = {
+			EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
+			&AttributeData,
+			AdvertisementType == EOnlineDataAdvertisementType::DontAdvertise
+				? EOS_ESessionAttributeAdvertisementType::EOS_SAAT_DontAdvertise
+				: EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
+		};
+		eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
+		if (eosResult != EOS_EResult::EOS_Success)
+		{
+			Error = FString::Printf(TEXT("Cannot update setting: %s - Error Code: %s"), UTF8_TO_TCHAR(AttributeData.Key), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+			return false;
+		}
+		++numChanges;
+		return true;
+	};
+
+	// Built-in settings, which are always advertised
+	for (FBuiltInSessionAttribute const& builtIn : BuiltInSessionAttributes)
 	{
-		setting = TEXT("NumPublicConnections");
-		data.SetValue(NewSessionSettings.NumPublicConnections);
+		EOS_Sessions_AttributeData attrData = {};
+		attrData.ApiVersion = EOS_SESSIONS_SESSIONATTRIBUTEDATA_API_LATEST;
+		attrData.Key = builtIn.Key;
+		builtIn.Encode(NewSessionSettings, attrData);
 
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
+		// Boolean settings are part of the compact session flags
+		if (this->bCompactSessionFlags && attrData.ValueType == EOS_ESessionAttributeType::EOS_AT_BOOLEAN)
 		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
+			continue;
+		}
 
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-			if (eosResult != EOS_EResult::EOS_Success)
+		if (PushedSessionSettings)
+		{
+			EOS_Sessions_AttributeData pushedAttrData = {};
+			builtIn.Encode(*PushedSessionSettings, pushedAttrData);
+			if (BuiltInAttributeValuesEqual(attrData, pushedAttrData))
 			{
-				goto handleError;
+				continue;
 			}
 		}
-		else
+
+		if (!addAttribute(attrData, EOnlineDataAdvertisementType::ViaOnlineService))
+		{
+			return numChanges;
+		}
+	}
+
+	// The boolean built-in settings, packed into a single attribute
+	int64 const sessionFlags = EncodeSessionFlags(NewSessionSettings);
+	if (this->bCompactSessionFlags && (!PushedSessionSettings || EncodeSessionFlags(*PushedSessionSettings) != sessionFlags))
+	{
+		EOS_Sessions_AttributeData attrData = {};
+		attrData.ApiVersion = EOS_SESSIONS_SESSIONATTRIBUTEDATA_API_LATEST;
+		attrData.Key = CompactSessionFlagsKey;
+		attrData.ValueType = EOS_ESessionAttributeType::EOS_AT_INT64;
+		attrData.Value.AsInt64 = sessionFlags;
+		if (!addAttribute(attrData, EOnlineDataAdvertisementType::ViaOnlineService))
 		{
-			goto handleError;
+			return numChanges;
 		}
 	}
 
-	// NumPrivateConnections
+	// Add all custom settings that are new or changed since they were last pushed
+	for (auto const& setting : NewSessionSettings.Settings)
 	{
-		setting = TEXT("NumPrivateConnections");
-		data.SetValue(NewSessionSettings.NumPrivateConnections);
+		if (setting.Value.Data.GetType() == EOnlineKeyValuePairDataType::Empty)
+		{
+			continue;
+		}
 
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
+		FOnlineSessionSetting const* pushedSetting = PushedSessionSettings ? PushedSessionSettings->Settings.Find(setting.Key) : nullptr;
+		if (pushedSetting
+			&& pushedSetting->Data == setting.Value.Data
+			&& pushedSetting->AdvertisementType == setting.Value.AdvertisementType)
 		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
+			continue;
+		}
 
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-			if (eosResult != EOS_EResult::EOS_Success)
-			{
-				goto handleError;
-			}
+		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(ToScratchUtf8(setting.Key, scratch), setting.Value.Data, scratch, Error);
+		if (!Error.IsEmpty())
+		{
+			Error = FString::Printf(TEXT("Cannot update setting: %s - Error: %s"), *setting.Key.ToString(), *Error);
+			return numChanges;
 		}
-		else
+
+		if (!addAttribute(attrData, setting.Value.AdvertisementType))
 		{
-			goto handleError;
+			return numChanges;
 		}
 	}
 
-	// bUsesPresence
+	// Remove all custom settings that were pushed, but are gone now
+	if (PushedSessionSettings)
 	{
-		setting = TEXT("bUsesPresence");
-		data.SetValue(NewSessionSettings.bShouldAdvertise);
-
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
+		for (auto const& setting : PushedSessionSettings->Settings)
 		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
+			if (NewSessionSettings.Settings.Contains(setting.Key))
+			{
+				continue;
+			}
 
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
+			EOS_SessionModification_RemoveAttributeOptions removeAttrOpts = {
+				EOS_SESSIONMODIFICATION_REMOVEATTRIBUTE_API_LATEST,
+				ToScratchUtf8(setting.Key, scratch)
+			};
+			eosResult = EOS_SessionModification_RemoveAttribute(ModificationHandle, &removeAttrOpts);
 			if (eosResult != EOS_EResult::EOS_Success)
 			{
-				goto handleError;
+				Error = FString::Printf(TEXT("Cannot remove setting: %s - Error Code: %s"), *setting.Key.ToString(), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+				return numChanges;
 			}
-		}
-		else
-		{
-			goto handleError;
+			++numChanges;
 		}
 	}
 
 	// bAllowJoinInProgress
+	if (!PushedSessionSettings || PushedSessionSettings->bAllowJoinInProgress != NewSessionSettings.bAllowJoinInProgress)
 	{
 		EOS_SessionModification_SetJoinInProgressAllowedOptions joinInProgresOpts = {
-		EOS_SESSIONMODIFICATION_SETJOININPROGRESSALLOWED_API_LATEST,
-		NewSessionSettings.bAllowJoinInProgress
+			EOS_SESSIONMODIFICATION_SETJOININPROGRESSALLOWED_API_LATEST,
+			NewSessionSettings.bAllowJoinInProgress
 		};
 		eosResult = EOS_SessionModification_SetJoinInProgressAllowed(ModificationHandle, &joinInProgresOpts);
 		if (eosResult != EOS_EResult::EOS_Success)
 		{
-			setting = TEXT("JoinInProgress");
-			goto handleError;
+			Error = FString::Printf(TEXT("Cannot update setting: JoinInProgress - Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+			return numChanges;
 		}
+		++numChanges;
 	}
 
-	// bIsLANMatch
+	// bShouldAdvertise || bAllowJoinViaPresence || bAllowJoinViaPresenceFriendsOnly
+	EOS_EOnlineSessionPermissionLevel const permissionLevel = GetPermissionLevel(NewSessionSettings);
+	if (!PushedSessionSettings || GetPermissionLevel(*PushedSessionSettings) != permissionLevel)
 	{
-		setting = TEXT("bIsLANMatch");
-		data.SetValue(NewSessionSettings.bIsLANMatch);
-
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
+		EOS_SessionModification_SetPermissionLevelOptions permissionOpts{
+			EOS_SESSIONMODIFICATION_SETPERMISSIONLEVEL_API_LATEST,
+			permissionLevel
+		};
+		eosResult = EOS_SessionModification_SetPermissionLevel(ModificationHandle, &permissionOpts);
+		if (eosResult != EOS_EResult::EOS_Success)
 		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
-
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-			if (eosResult != EOS_EResult::EOS_Success)
+			Error = FString::Printf(TEXT("Cannot update setting: bShouldAdvertise || bAllowJoinViaPresence || bAllowJoinViaPresenceFriendsOnly - Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+			return numChanges;
+		}
+		++numChanges;
+	}
+
+	// Set the total players, which are (public + private) connections
+	int32 const maxPlayers = NewSessionSettings.NumPrivateConnections + NewSessionSettings.NumPublicConnections;
+	if (!PushedSessionSettings || PushedSessionSettings->NumPrivateConnections + PushedSessionSettings->NumPublicConnections != maxPlayers)
+	{
+		EOS_SessionModification_SetMaxPlayersOptions playerOpts = {};
+		playerOpts.ApiVersion = EOS_SESSIONMODIFICATION_SETMAXPLAYERS_API_LATEST;
+		playerOpts.MaxPlayers = maxPlayers;
+
+		eosResult = EOS_SessionModification_SetMaxPlayers(ModificationHandle, &playerOpts);
+		if (eosResult != EOS_EResult::EOS_Success)
+		{
+			Error = FString::Printf(TEXT("Cannot update setting: MaxPlayers - Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+			return numChanges;
+		}
+		++numChanges;
+	}
+
+	return numChanges;
+}
+
+// ---------------------------------------------
+// Session advertisement
+// ---------------------------------------------
+
+void FOnlineSessionEpic::PushSessionUpdate(FName SessionName)
+{
+	FSessionAdvertisementEpic& advertisement = this->SessionAdvertisements.FindChecked(SessionName);
+	check(!advertisement.bInFlight);
+
+	int32 const numCalls = advertisement.NumQueuedCalls;
+	advertisement.bDirty = false;
+	advertisement.bSlotsDirty = false;
+	advertisement.NumQueuedCalls = 0;
+	advertisement.LastPushTime = FPlatformTime::Seconds();
+
+	FNamedOnlineSession* session = this->GetNamedSession(SessionName);
+	if (!session)
+	{
+		this->SessionAdvertisements.Remove(SessionName);
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Session \"%s\" destroyed before its update was sent."), *SessionName.ToString());
+		this->CompleteSessionUpdateCalls(SessionName, numCalls, false);
+		return;
+	}
+
+	FString err;
+	uint32 result = ONLINE_FAIL;
+
+	// Modify the local session with the modified session options
+	EOS_HSessionModification sessionModificationHandle = nullptr;
+	EOS_Sessions_UpdateSessionModificationOptions sessionModificationOptions =
+	{
+		EOS_SESSIONS_UPDATESESSIONMODIFICATION_API_LATEST,
+		TCHAR_TO_UTF8(*SessionName.ToString())
+	};
+	EOS_EResult eosResult = EOS_Sessions_UpdateSessionModification(this->sessionsHandle, &sessionModificationOptions, &sessionModificationHandle);
+	if (eosResult == EOS_EResult::EOS_Success)
+	{
+		// Only send what changed since the last successful push
+		int32 numChanges = this->CreateSessionModificationHandle(session->SessionSettings, this->PushedSessionSettings.Find(SessionName), sessionModificationHandle, err);
+		if (!err.IsEmpty())
+		{
+			err = FString::Printf(TEXT("[EOS SDK] Error creating session modification - Error: %s"), *err);
+		}
+		else if (numChanges == 0)
+		{
+			UE_LOG_ONLINE_SESSION(Verbose, TEXT("Session \"%s\" unchanged, skipping update."), *SessionName.ToString());
+			result = ONLINE_SUCCESS;
+		}
+		else
+		{
+			// Update the remote session
+			EOS_Sessions_UpdateSessionOptions updateSessionOptions = {};
+			updateSessionOptions.ApiVersion = EOS_SESSIONS_UPDATESESSION_API_LATEST;
+			updateSessionOptions.SessionModificationHandle = sessionModificationHandle;
+
+			advertisement.bInFlight = true;
+			advertisement.NumInFlightCalls = numCalls;
+			advertisement.InFlightSettings = session->SessionSettings;
+
+			void* clientData = UpdateSessionContexts.Add(this, FUpdateSessionAdditionalData{
+				this,
+				SessionName
+			});
+			EOS_Sessions_UpdateSession(this->sessionsHandle, &updateSessionOptions, clientData, &FOnlineSessionEpic::OnEOSUpdateSessionComplete);
+			result = ONLINE_IO_PENDING;
+		}
+
+		EOS_SessionModification_Release(sessionModificationHandle);
+	}
+	else
+	{
+		char const* resultStr = EOS_EResult_ToString(eosResult);
+		err = FString::Printf(TEXT("[EOS SDK] Error modifying session options - Error Code: %s"), UTF8_TO_TCHAR(resultStr));
+	}
+
+	if (result != ONLINE_IO_PENDING)
+	{
+		UE_CLOG_ONLINE_SESSION(!err.IsEmpty(), Warning, TEXT("%s"), *err);
+		this->CompleteSessionUpdateCalls(SessionName, numCalls, result == ONLINE_SUCCESS);
+	}
+}
+
+void FOnlineSessionEpic::CompleteSessionUpdateCalls(FName SessionName, int32 NumCalls, bool bWasSuccessful)
+{
+	for (int32 i = 0; i < NumCalls; ++i)
+	{
+		TriggerOnUpdateSessionCompleteDelegates(SessionName, bWasSuccessful);
+	}
+}
+
+// ---------------------------------------------
+// Session search registry
+// ---------------------------------------------
+
+uint64 FOnlineSessionEpic::AddSessionSearch(EOS_HSessionSearch SearchHandle, TSharedRef<FOnlineSessionSearch> const& SessionSearch)
+{
+	// Searches that already completed for the same search object are superseded by the new one
+	this->SupersedeSessionSearches(SessionSearch);
+
+	uint64 searchId = this->NextSessionSearchId++;
+	this->SessionSearches.Add(searchId, FSessionSearchEntryEpic(SearchHandle, SessionSearch));
+
+	// Searches registered without a handle already completed
+	if (!SearchHandle)
+	{
+		this->ScheduleSearchRetention(searchId);
+	}
+	return searchId;
+}
+
+void FOnlineSessionEpic::SupersedeSessionSearches(TSharedRef<FOnlineSessionSearch> const& SessionSearch)
+{
+	TArray<uint64> supersededSearches;
+	for (auto const& search : this->SessionSearches)
+	{
+		if (search.Value.SessionSearch == SessionSearch && !search.Value.SearchHandle)
+		{
+			supersededSearches.Add(search.Key);
+		}
+	}
+	for (uint64 searchId : supersededSearches)
+	{
+		this->RemoveSessionSearch(searchId);
+	}
+}
+
+void FOnlineSessionEpic::RemoveSessionSearch(uint64 SearchId)
+{
+	FSessionSearchEntryEpic* search = this->SessionSearches.Find(SearchId);
+	if (!search)
+	{
+		return;
+	}
+
+	this->SearchTimers.Cancel(search->TimerHandle);
+	ReleaseSearchHandle(*search);
+
+	// Only drop index entries that still point to this search.
+	// A session might have been returned by a newer search in the meantime.
+	for (FOnlineSessionSearchResult const& searchResult : search->SessionSearch->SearchResults)
+	{
+		FString const sessionId = searchResult.GetSessionIdStr();
+		FSessionSearchResultLocationEpic const* location = this->SearchResultsBySessionId.Find(sessionId);
+		if (location && location->SearchId == SearchId)
+		{
+			this->SearchResultsBySessionId.Remove(sessionId);
+		}
+	}
+
+	this->SessionSearches.Remove(SearchId);
+}
+
+void FOnlineSessionEpic::ReleaseSearchHandle(FSessionSearchEntryEpic& Search)
+{
+	if (Search.SearchHandle && !Search.bFindPending)
+	{
+		EOS_SessionSearch_Release(Search.SearchHandle);
+	}
+	Search.SearchHandle = nullptr;
+}
+
+void FOnlineSessionEpic::OnSessionSearchTimeout(uint64 SearchId)
+{
+	FSessionSearchEntryEpic* search = this->SessionSearches.Find(SearchId);
+	if (!search || !search->SearchHandle)
+	{
+		return;
+	}
+
+	search->TimerHandle = 0;
+
+	// The results converted so far are kept, but the search counts as failed.
+	// EOS might still answer later, which is ignored.
+	UE_LOG_ONLINE_SESSION(Warning, TEXT("Session search with id %llu timed out after %.1f seconds"), SearchId, search->SessionSearch->TimeoutInSeconds);
+	this->FinishSessionSearch(SearchId, false);
+}
+
+void FOnlineSessionEpic::ScheduleSearchRetention(uint64 SearchId)
+{
+	FSessionSearchEntryEpic* search = this->SessionSearches.Find(SearchId);
+	if (!search)
+	{
+		return;
+	}
+
+	this->SearchTimers.Cancel(search->TimerHandle);
+	search->TimerHandle = this->SearchTimers.Schedule(this->SearchRetention, [this, SearchId]()
+		{
+			FSessionSearchEntryEpic* expiredSearch = this->SessionSearches.Find(SearchId);
+			if (!expiredSearch)
+			{
+				return;
+			}
+
+			// Results stay joinable as long as the game holds on to the search object
+			expiredSearch->TimerHandle = 0;
+			if (expiredSearch->SessionSearch.IsUnique())
+			{
+				this->RemoveSessionSearch(SearchId);
+			}
+			else
+			{
+				this->ScheduleSearchRetention(SearchId);
+			}
+		});
+}
+
+void FOnlineSessionEpic::IndexSearchResult(uint64 SearchId, int32 ResultIndex)
+{
+	FSessionSearchEntryEpic const* search = this->SessionSearches.Find(SearchId);
+	if (search && search->SessionSearch->SearchResults.IsValidIndex(ResultIndex))
+	{
+		FString const sessionId = search->SessionSearch->SearchResults[ResultIndex].GetSessionIdStr();
+		this->SearchResultsBySessionId.Add(sessionId, FSessionSearchResultLocationEpic{ SearchId, ResultIndex });
+	}
+}
+
+FOnlineSessionSearchResult* FOnlineSessionEpic::FindSearchResultBySessionId(FString const& SessionId)
+{
+	FSessionSearchResultLocationEpic const* location = this->SearchResultsBySessionId.Find(SessionId);
+	if (!location)
+	{
+		return nullptr;
+	}
+
+	// The search object is owned by the caller, who might have modified the results since they were indexed.
+	FSessionSearchEntryEpic* search = this->SessionSearches.Find(location->SearchId);
+	if (search && search->SessionSearch->SearchResults.IsValidIndex(location->ResultIndex))
+	{
+		FOnlineSessionSearchResult& searchResult = search->SessionSearch->SearchResults[location->ResultIndex];
+		if (searchResult.GetSessionIdStr() == SessionId)
+		{
+			return &searchResult;
+		}
+	}
+
+	// Stale entry, drop it
+	this->SearchResultsBySessionId.Remove(SessionId);
+	return nullptr;
+}
+
+int32 FOnlineSessionEpic::ConvertSearchResults(uint64 SearchId, int32 MaxResults)
+{
+	FSessionSearchEntryEpic* search = this->SessionSearches.Find(SearchId);
+	if (!search || !search->SearchHandle)
+	{
+		return 0;
+	}
+
+	TSharedRef<FOnlineSessionSearch> searchRef = search->SessionSearch;
+	int32 const firstNewResult = searchRef->SearchResults.Num();
+	int32 numConverted = 0;
+
+
+	for (; search->NextResultIndex < search->NumResults && numConverted < MaxResults; ++search->NextResultIndex, ++numConverted)
+	{
+		EOS_SessionSearch_CopySearchResultByIndexOptions copySearchResultsByIndex = {
+			EOS_SESSIONSEARCH_COPYSEARCHRESULTBYINDEX_API_LATEST,
+			static_cast<uint32_t>(search->NextResultIndex)
+		};
+		EOS_HSessionDetails sessionDetailsHandle = nullptr;
+		EOS_EResult eosResult = EOS_SessionSearch_CopySearchResultByIndex(search->SearchHandle, &copySearchResultsByIndex, &sessionDetailsHandle);
+		if (eosResult != EOS_EResult::EOS_Success)
+		{
+			UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't get session details handle.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+			continue;
+		}
+
+		// Copy the session details
+		EOS_SessionDetails_Info* eosSessionInfo = nullptr;
+		EOS_SessionDetails_CopyInfoOptions copyInfoOptions = {
+			EOS_SESSIONDETAILS_COPYINFO_API_LATEST
+		};
+		eosResult = EOS_SessionDetails_CopyInfo(sessionDetailsHandle, &copyInfoOptions, &eosSessionInfo);
+		if (eosResult == EOS_EResult::EOS_Success)
+		{
+			// Create a new search result.
+			// Ping is set to -1, as we have no way of retrieving it for now
+			FOnlineSessionSearchResult searchResult;
+			searchResult.PingInMs = -1;
+
+			// Take the session from the search results and update its details
+			bool const bHasCompactSessionFlags = this->SetSessionDetails(&searchResult.Session, eosSessionInfo, sessionDetailsHandle);
+
+			// Search parameters on compact session flags weren't sent to EOS.
+			// Hosts without compact session flags are checked against their individual attributes instead
+			bool bMatchesSessionFlags = true;
+			if (search->FlagsMask != 0)
+			{
+				int64 sessionFlags = 0;
+				if (bHasCompactSessionFlags)
+				{
+					sessionFlags = EncodeSessionFlags(searchResult.Session.SessionSettings);
+				}
+				else if (!CopyIndividualSessionFlags(sessionDetailsHandle, search->FlagsMask, sessionFlags))
+				{
+					// Neither advertised, so the session can't be matched
+					bMatchesSessionFlags = false;
+				}
+				bMatchesSessionFlags = bMatchesSessionFlags && (sessionFlags & search->FlagsMask) == search->FlagsValue;
+			}
+
+			if (bMatchesSessionFlags)
+			{
+				// Add the session to the list of search results and make it available for joining
+				int32 resultIndex = searchRef->SearchResults.Add(searchResult);
+				this->IndexSearchResult(SearchId, resultIndex);
+
+				if (this->bPingSearchResults)
+				{
+					this->PingSearchResult(searchRef, resultIndex);
+				}
+
+				// Keep the handle, so the session can be joined without searching for it again
+				this->CacheSessionDetails(sessionDetailsHandle, eosSessionInfo);
+				sessionDetailsHandle = nullptr;
+			}
+
+			// Release the prevously allocated memory for the session info;
+			EOS_SessionDetails_Info_Release(eosSessionInfo);
+		}
+		else
+		{
+			UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't copy session info.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		}
+
+		if (sessionDetailsHandle)
+		{
+			EOS_SessionDetails_Release(sessionDetailsHandle);
+		}
+	}
+
+	// Tell everyone waiting on this query about the new results
+	int32 const numNewResults = searchRef->SearchResults.Num() - firstNewResult;
+	if (numNewResults > 0)
+	{
+		// Copy the shared searches, the delegates might start new searches
+		TArray<TSharedRef<FOnlineSessionSearch>> const sharedSearches = search->SharedSearches;
+
+		this->NotifySearchResultsAvailable(searchRef, numNewResults);
+		for (TSharedRef<FOnlineSessionSearch> const& sharedSearch : sharedSearches)
+		{
+			sharedSearch->SearchResults.Append(searchRef->SearchResults.GetData() + firstNewResult, numNewResults);
+			this->NotifySearchResultsAvailable(sharedSearch, numNewResults);
+		}
+	}
+
+	return numConverted;
+}
+
+bool FOnlineSessionEpic::PingSearchResult(TSharedRef<FOnlineSessionSearch> const& SessionSearch, int32 ResultIndex)
+{
+	if (!SessionSearch->SearchResults.IsValidIndex(ResultIndex))
+	{
+		return false;
+	}
+
+	FOnlineSessionSearchResult const& searchResult = SessionSearch->SearchResults[ResultIndex];
+	TSharedPtr<FOnlineSessionInfoEpic const> sessionInfo = StaticCastSharedPtr<FOnlineSessionInfoEpic const>(searchResult.Session.SessionInfo);
+	if (!sessionInfo.IsValid() || !sessionInfo->HostAddr.IsValid() || !sessionInfo->HostAddr->IsValid())
+	{
+		return false;
+	}
+
+	if (!this->PingClient)
+	{
+		int32 pingWindow = 32;
+		GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("PingWindow"), pingWindow, GEngineIni);
+		double pingTimeout = 2.0;
+		GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("PingTimeout"), pingTimeout, GEngineIni);
+
+		this->PingClient = MakeUnique<FOnlineSessionPingEpic>(pingWindow, pingTimeout);
+		if (!this->PingClient->Init())
+		{
+			this->PingClient.Reset();
+			return false;
+		}
+	}
+
+	// The responder listens on its own port on the same host the game is running on
+	TSharedRef<FInternetAddr> pingAddress = sessionInfo->HostAddr->Clone();
+	pingAddress->SetPort(this->PingPort);
+
+	// The search result might be gone by the time the host answered.
+	// Hold on to the search weakly and make sure the result at the index is still the same session.
+	TWeakPtr<FOnlineSessionSearch> weakSearch = SessionSearch;
+	FString sessionId = searchResult.GetSessionIdStr();
+	this->PingClient->Ping(pingAddress, [this, weakSearch, ResultIndex, sessionId](int32 PingInMs)
+		{
+			TSharedPtr<FOnlineSessionSearch> search = weakSearch.Pin();
+			if (search.IsValid() && search->SearchResults.IsValidIndex(ResultIndex))
+			{
+				FOnlineSessionSearchResult& result = search->SearchResults[ResultIndex];
+				if (result.GetSessionIdStr() == sessionId)
+				{
+					result.PingInMs = PingInMs;
+					this->TriggerOnSearchResultPingCompleteDelegates(result);
+
+					// The delegates might have changed the results, so the result isn't used anymore
+					this->OnPreparedSearchResultPinged(*search, sessionId, ResultIndex, PingInMs);
+				}
+			}
+		});
+
+	return true;
+}
+
+void FOnlineSessionEpic::FinishSessionSearch(uint64 SearchId, bool bWasSuccessful)
+{
+	FSessionSearchEntryEpic* search = this->SessionSearches.Find(SearchId);
+	if (!search)
+	{
+		return;
+	}
+
+	TSharedRef<FOnlineSessionSearch> searchRef = search->SessionSearch;
+	searchRef->SearchState = bWasSuccessful ? EOnlineAsyncTaskState::Done : EOnlineAsyncTaskState::Failed;
+
+	// The EOS handle isn't needed anymore, the results are kept for joining
+	ReleaseSearchHandle(*search);
+	this->ScheduleSearchRetention(SearchId);
+
+	// The query isn't in flight anymore. Cache its results, if caching is enabled
+	FString const fingerprint = search->Fingerprint;
+	TArray<TSharedRef<FOnlineSessionSearch>> sharedSearches = MoveTemp(search->SharedSearches);
+	this->InFlightSearches.Remove(fingerprint);
+	if (bWasSuccessful && this->SearchCacheTTL > 0.0 && !fingerprint.IsEmpty())
+	{
+		this->SearchResultCache.Add(fingerprint, FSessionSearchCacheEntryEpic{ searchRef->SearchResults, FPlatformTime::Seconds() });
+	}
+
+	UE_CLOG_ONLINE_SESSION(bWasSuccessful, Display, TEXT("Finished session search with id %llu"), SearchId);
+	this->CompleteSessionSearch(searchRef, bWasSuccessful);
+
+	// Every search that issued the same query while this one was running already holds the results.
+	// Each one gets its own registration, so its results can be joined.
+	for (TSharedRef<FOnlineSessionSearch> const& sharedSearch : sharedSearches)
+	{
+		sharedSearch->SearchState = searchRef->SearchState;
+
+		uint64 sharedSearchId = this->AddSessionSearch(nullptr, sharedSearch);
+		for (int32 resultIndex = 0; resultIndex < sharedSearch->SearchResults.Num(); ++resultIndex)
+		{
+			this->IndexSearchResult(sharedSearchId, resultIndex);
+		}
+
+		this->CompleteSessionSearch(sharedSearch, bWasSuccessful);
+	}
+}
+
+FString FOnlineSessionEpic::GetSearchFingerprint(FUniqueNetId const& SearchingPlayerId, FOnlineSessionSearch const& SessionSearch)
+{
+	// Sort the keys, so the order in which the parameters were added doesn't matter.
+	// The bucket id is a search parameter as well and therefore part of the fingerprint
+	TArray<FName> keys;
+	SessionSearch.QuerySettings.SearchParams.GetKeys(keys);
+	keys.Sort(FNameLexicalLess());
+
+	FString fingerprint = FString::Printf(TEXT("Player=%s;Lan=%d;Max=%d;"), *SearchingPlayerId.ToString(), SessionSearch.bIsLanQuery ? 1 : 0, SessionSearch.MaxSearchResults);
+	for (FName const& key : keys)
+	{
+		FOnlineSessionSearchParam const& param = SessionSearch.QuerySettings.SearchParams[key];
+		fingerprint += FString::Printf(TEXT("%s|%s|%s|%s;"),
+			*key.ToString(),
+			EOnlineComparisonOp::ToString(param.ComparisonOp),
+			EOnlineKeyValuePairDataType::ToString(param.Data.GetType()),
+			*param.Data.ToString());
+	}
+	return fingerprint;
+}
+
+bool FOnlineSessionEpic::StartInternalSessionSearch(FUniqueNetId const& SearchingPlayerId, TSharedRef<FOnlineSessionSearch> const& SessionSearch, FOnSessionSearchCompleteEpic&& OnComplete, FOnSessionSearchResultsEpic&& OnResultsAvailable)
+{
+	this->SearchCompletionHooks.Add(&SessionSearch.Get(), MoveTemp(OnComplete));
+	if (OnResultsAvailable)
+	{
+		this->SearchResultHooks.Add(&SessionSearch.Get(), MoveTemp(OnResultsAvailable));
+	}
+	return this->FindSessions(SearchingPlayerId, SessionSearch);
+}
+
+void FOnlineSessionEpic::CompleteSessionSearch(TSharedRef<FOnlineSessionSearch> const& SessionSearch, bool bWasSuccessful)
+{
+	// No more results to come
+	this->SearchResultHooks.Remove(&SessionSearch.Get());
+
+	FOnSessionSearchCompleteEpic onComplete;
+	if (this->SearchCompletionHooks.RemoveAndCopyValue(&SessionSearch.Get(), onComplete))
+	{
+		onComplete(bWasSuccessful);
+	}
+	else
+	{
+		this->TriggerOnFindSessionsCompleteDelegates(bWasSuccessful);
+	}
+}
+
+void FOnlineSessionEpic::NotifySearchResultsAvailable(TSharedRef<FOnlineSessionSearch> const& SessionSearch, int32 NumNewResults)
+{
+	if (FOnSessionSearchResultsEpic const* onResultsAvailable = this->SearchResultHooks.Find(&SessionSearch.Get()))
+	{
+		// Copy the callback, it might start or complete searches
+		FOnSessionSearchResultsEpic const callback = *onResultsAvailable;
+		callback(NumNewResults);
+	}
+	else
+	{
+		this->TriggerOnFindSessionsResultsAvailableDelegates(SessionSearch, NumNewResults);
+	}
+}
+
+// ---------------------------------------------
+// Bucket search
+// ---------------------------------------------
+
+void FOnlineSessionEpic::MergeBucketSearchResults(uint64 BucketSearchId, int32 BucketIndex)
+{
+	FBucketSearchEpic* bucketSearch = this->BucketSearches.Find(BucketSearchId);
+	if (!bucketSearch)
+	{
+		// Already finished
+		return;
+	}
+
+	TArray<FOnlineSessionSearchResult> const& bucketResults = bucketSearch->BucketSearches[BucketIndex]->SearchResults;
+	TArray<FOnlineSessionSearchResult>& mergedResults = bucketSearch->SessionSearch->SearchResults;
+	int32 const firstNewResult = mergedResults.Num();
+	for (int32& resultIdx = bucketSearch->NumMergedResults[BucketIndex]; resultIdx < bucketResults.Num(); ++resultIdx)
+	{
+		FOnlineSessionSearchResult const& bucketResult = bucketResults[resultIdx];
+
+		bool bAlreadyMerged = false;
+		bucketSearch->SessionIds.Add(bucketResult.GetSessionIdStr(), &bAlreadyMerged);
+		if (!bAlreadyMerged)
+		{
+			mergedResults.Add(bucketResult);
+		}
+	}
+
+	int32 const numNewResults = mergedResults.Num() - firstNewResult;
+	if (numNewResults > 0)
+	{
+		// Copy the search, the delegates might finish the bucket search
+		TSharedRef<FOnlineSessionSearch> const sessionSearch = bucketSearch->SessionSearch;
+		this->TriggerOnFindSessionsResultsAvailableDelegates(sessionSearch, numNewResults);
+	}
+}
+
+void FOnlineSessionEpic::OnBucketSearchComplete(uint64 BucketSearchId, int32 BucketIndex, bool bWasSuccessful)
+{
+	this->MergeBucketSearchResults(BucketSearchId, BucketIndex);
+
+	FBucketSearchEpic* bucketSearch = this->BucketSearches.Find(BucketSearchId);
+	if (!bucketSearch)
+	{
+		// Finished by the deadline or cancelled
+		return;
+	}
+
+	bucketSearch->bAnySucceeded |= bWasSuccessful;
+	if (--bucketSearch->NumPendingBuckets == 0)
+	{
+		this->FinishBucketSearch(BucketSearchId);
+	}
+}
+
+void FOnlineSessionEpic::FinishBucketSearch(uint64 BucketSearchId)
+{
+	FBucketSearchEpic bucketSearch = this->BucketSearches.FindAndRemoveChecked(BucketSearchId);
+	this->SearchTimers.Cancel(bucketSearch.DeadlineTimer);
+
+	// Searches still running complete on their own, their results are ignored.
+	// Results found after the deadline simply don't make it into the merged search.
+	bool const bWasSuccessful = bucketSearch.bAnySucceeded || bucketSearch.SessionSearch->SearchResults.Num() > 0;
+	bucketSearch.SessionSearch->SearchState = bWasSuccessful ? EOnlineAsyncTaskState::Done : EOnlineAsyncTaskState::Failed;
+
+	// Register the merged search, so its results stay joinable once the bucket searches are gone
+	uint64 const searchId = this->AddSessionSearch(nullptr, bucketSearch.SessionSearch);
+	for (int32 resultIndex = 0; resultIndex < bucketSearch.SessionSearch->SearchResults.Num(); ++resultIndex)
+	{
+		this->IndexSearchResult(searchId, resultIndex);
+	}
+
+	UE_LOG_ONLINE_SESSION(Display, TEXT("Finished session search across %d bucket(s) with %d result(s). %d bucket(s) didn't complete in time."),
+		bucketSearch.BucketSearches.Num(), bucketSearch.SessionSearch->SearchResults.Num(), bucketSearch.NumPendingBuckets);
+	this->TriggerOnFindSessionsCompleteDelegates(bWasSuccessful);
+}
+
+// ---------------------------------------------
+// Friend session search
+// ---------------------------------------------
+
+void FOnlineSessionEpic::StartFriendSessionSearches(uint64 FriendSearchId)
+{
+	FFriendSessionSearchEpic* friendSearch = this->FriendSessionSearches.Find(FriendSearchId);
+	if (!friendSearch)
+	{
+		return;
+	}
+
+	while (friendSearch->NumInFlight < this->FriendSessionSearchWindow && friendSearch->NextFriendIndex < friendSearch->Friends.Num())
+	{
+		TSharedRef<FUniqueNetId const> const friendId = friendSearch->Friends[friendSearch->NextFriendIndex++];
+		if (this->StartFriendSessionSearch(FriendSearchId, friendId))
+		{
+			++friendSearch->NumInFlight;
+		}
+	}
+
+	// Every friend was searched
+	if (friendSearch->NumInFlight == 0)
+	{
+		FFriendSessionSearchEpic const finishedSearch = this->FriendSessionSearches.FindAndRemoveChecked(FriendSearchId);
+
+		IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
+		FPlatformUserId userIdx = identityPtr->GetPlatformUserIdFromUniqueNetId(*finishedSearch.LocalUserId);
+
+		UE_LOG_ONLINE_SESSION(Display, TEXT("Searched the sessions of %d friend(s). Found %d session(s)."), finishedSearch.Friends.Num(), finishedSearch.SearchResults.Num());
+		this->TriggerOnFindFriendSessionCompleteDelegates(userIdx, finishedSearch.bAnySucceeded, finishedSearch.SearchResults);
+	}
+}
+
+bool FOnlineSessionEpic::StartFriendSessionSearch(uint64 FriendSearchId, TSharedRef<FUniqueNetId const> const& Friend)
+{
+	// Ids of other subsystems, e.g. platform friends, can't be searched for
+	if (Friend->GetType() != EPIC_SUBSYSTEM)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Can't search sessions of friend %s. The id belongs to subsystem %s"), *Friend->ToString(), *Friend->GetType().ToString());
+		return false;
+	}
+
+	TSharedRef<FUniqueNetIdEpic const> const epicFriendId = StaticCastSharedRef<FUniqueNetIdEpic const>(Friend);
+	if (!epicFriendId->IsProductUserIdValid())
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Can't search sessions of friend %s without a product user id"), *Friend->ToString());
+		return false;
+	}
+
+	// A friend can be in more than one session at a time, e.g. a party and a match
+	TSharedRef<FOnlineSessionSearch> sessionSearch = MakeShared<FOnlineSessionSearch>();
+	sessionSearch->MaxSearchResults = this->FriendSessionSearchMaxResults;
+	EOS_Sessions_CreateSessionSearchOptions sessionSearchOptions = {
+		EOS_SESSIONS_CREATESESSIONSEARCH_API_LATEST,
+		static_cast<uint32_t>(sessionSearch->MaxSearchResults)
+	};
+	EOS_HSessionSearch sessionSearchHandle = nullptr;
+	EOS_EResult eosResult = EOS_Sessions_CreateSessionSearch(this->sessionsHandle, &sessionSearchOptions, &sessionSearchHandle);
+	if (eosResult != EOS_EResult::EOS_Success)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't create sessionsearch. Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		return false;
+	}
+
+	// Only search for the sessions the friend is in
+	EOS_SessionSearch_SetTargetUserIdOptions targetUserIdOptions = {
+		EOS_SESSIONSEARCH_SETTARGETUSERID_API_LATEST,
+		epicFriendId->ToProductUserId()
+	};
+	eosResult = EOS_SessionSearch_SetTargetUserId(sessionSearchHandle, &targetUserIdOptions);
+	if (eosResult != EOS_EResult::EOS_Success)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't set target user %s. Error: %s"), *Friend->ToString(), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		EOS_SessionSearch_Release(sessionSearchHandle);
+		return false;
+	}
+
+	EOS_ProductUserId const localUserId = StaticCastSharedRef<FUniqueNetIdEpic const>(this->FriendSessionSearches.FindChecked(FriendSearchId).LocalUserId)->ToProductUserId();
+
+	// The search runs through the registry like any other, but reports to the friend request instead of the game
+	sessionSearch->SearchState = EOnlineAsyncTaskState::InProgress;
+	uint64 const searchId = this->AddSessionSearch(sessionSearchHandle, sessionSearch);
+	this->SearchCompletionHooks.Add(&sessionSearch.Get(), [this, FriendSearchId, sessionSearch](bool bWasSuccessful)
+		{
+			this->OnFriendSessionSearchComplete(FriendSearchId, sessionSearch, bWasSuccessful);
+		});
+	this->SearchResultHooks.Add(&sessionSearch.Get(), [](int32 NumNewResults)
+		{
+			// The results are reported once the friend's search completed
+		});
+
+	EOS_SessionSearch_FindOptions findOptions = {
+		EOS_SESSIONSEARCH_FIND_API_LATEST,
+		localUserId
+	};
+	void* clientData = FindSessionsContexts.Add(this, FFindSessionsAdditionalData{
+		this,
+		searchId,
+		sessionSearchHandle
+	});
+	this->SessionSearches.FindChecked(searchId).bFindPending = true;
+	EOS_SessionSearch_Find(sessionSearchHandle, &findOptions, clientData, &FOnlineSessionEpic::OnEOSFindSessionComplete);
+	return true;
+}
+
+void FOnlineSessionEpic::OnFriendSessionSearchComplete(uint64 FriendSearchId, TSharedRef<FOnlineSessionSearch> const& FriendSearch, bool bWasSuccessful)
+{
+	FFriendSessionSearchEpic* friendSearch = this->FriendSessionSearches.Find(FriendSearchId);
+	if (!friendSearch)
+	{
+		return;
+	}
+
+	--friendSearch->NumInFlight;
+	friendSearch->bAnySucceeded |= bWasSuccessful;
+
+	TArray<FOnlineSessionSearchResult> newResults;
+	for (FOnlineSessionSearchResult const& searchResult : FriendSearch->SearchResults)
+	{
+		bool bAlreadyFound = false;
+		friendSearch->SessionIds.Add(searchResult.GetSessionIdStr(), &bAlreadyFound);
+		if (!bAlreadyFound)
+		{
+			newResults.Add(searchResult);
+		}
+	}
+
+	if (newResults.Num() > 0)
+	{
+		friendSearch->SearchResults.Append(newResults);
+
+		IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
+		FPlatformUserId userIdx = identityPtr->GetPlatformUserIdFromUniqueNetId(*friendSearch->LocalUserId);
+		this->TriggerOnFindFriendSessionResultsAvailableDelegates(userIdx, newResults);
+	}
+
+	// Fill the window up again, or finish the request
+	this->StartFriendSessionSearches(FriendSearchId);
+}
+
+// ---------------------------------------------
+// Prepared search
+// ---------------------------------------------
+
+void FOnlineSessionEpic::OnPreparedSessionSearchComplete(uint64 PreparedSearchId, bool bWasSuccessful)
+{
+	// Differential searches report what changed since the last successful run.
+	// Failed runs are skipped, so they don't remove every result
+	FPreparedSessionSearchEpic* preparedSearch = this->PreparedSearches.Find(PreparedSearchId);
+	TArray<FSessionResultDeltaEpic> deltas;
+	if (preparedSearch && preparedSearch->bDifferential && bWasSuccessful)
+	{
+		DiffSearchResults(*preparedSearch, deltas);
+	}
+
+	// The deltas go first, the result indices are only valid until the search runs again
+	if (deltas.Num() > 0)
+	{
+		this->TriggerOnSessionSearchResultsChangedDelegates(PreparedSearchId, deltas);
+	}
+
+	// Every run completes like a regular FindSessions call
+	this->TriggerOnFindSessionsCompleteDelegates(bWasSuccessful);
+
+	// The delegates might have released the search or run it again
+	preparedSearch = this->PreparedSearches.Find(PreparedSearchId);
+	if (preparedSearch && preparedSearch->RefreshInterval > 0.0 && preparedSearch->RefreshTimer == 0)
+	{
+		preparedSearch->RefreshTimer = this->SearchTimers.Schedule(preparedSearch->RefreshInterval, [this, PreparedSearchId]()
 			{
-				goto handleError;
-			}
+				this->ExecutePreparedSessionSearch(PreparedSearchId);
+			});
+	}
+}
+
+void FOnlineSessionEpic::OnPreparedSearchResultPinged(FOnlineSessionSearch const& SessionSearch, FString const& SessionId, int32 ResultIndex, int32 PingInMs)
+{
+	// The delegates might release or prepare searches, so they're fired once the searches were walked
+	TArray<uint64> changedSearches;
+	for (auto& preparedSearch : this->PreparedSearches)
+	{
+		if (!preparedSearch.Value.bDifferential || preparedSearch.Value.SessionSearch.Get() != &SessionSearch)
+		{
+			continue;
 		}
-		else
+
+		// Sessions that aren't part of the last completed run are reported as added once the current run completed
+		FOnlineSessionSearchResult* previousResult = preparedSearch.Value.PreviousResults.Find(SessionId);
+		if (previousResult && previousResult->PingInMs != PingInMs)
 		{
-			goto handleError;
+			previousResult->PingInMs = PingInMs;
+			changedSearches.Add(preparedSearch.Key);
 		}
 	}
 
-	// bIsDedicated
+	TArray<FSessionResultDeltaEpic> deltas;
+	deltas.Add(FSessionResultDeltaEpic{ ESessionResultChangeEpic::Changed, SessionId, ResultIndex, ESessionResultFieldsEpic::Ping });
+	for (uint64 preparedSearchId : changedSearches)
 	{
-		setting = TEXT("bIsDedicated");
-		data.SetValue(NewSessionSettings.bIsDedicated);
+		this->TriggerOnSessionSearchResultsChangedDelegates(preparedSearchId, deltas);
+	}
+}
 
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
-		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
+// ---------------------------------------------
+// Session details cache
+// ---------------------------------------------
 
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-			if (eosResult != EOS_EResult::EOS_Success)
+void FOnlineSessionEpic::CacheSessionDetails(EOS_HSessionDetails DetailsHandle, EOS_SessionDetails_Info const* SessionInfo, bool bPin)
+{
+	FString const sessionId = UTF8_TO_TCHAR(SessionInfo->SessionId);
+	if (FSessionDetailsCacheEntryEpic* cachedDetails = this->SessionDetailsCache.Find(sessionId))
+	{
+		// Newer details replace the old ones
+		EOS_SessionDetails_Release(cachedDetails->DetailsHandle);
+		cachedDetails->DetailsHandle = DetailsHandle;
+		cachedDetails->LastUsedTime = FPlatformTime::Seconds();
+		cachedDetails->bPinned |= bPin;
+		return;
+	}
+
+	if (this->SessionDetailsCache.Num() >= this->SessionDetailsCacheSize)
+	{
+		// The cache is small, a linear scan for the least recently used entry is cheap enough.
+		// Pinned entries are only evicted if every entry is pinned
+		TPair<FString, FSessionDetailsCacheEntryEpic> const* leastRecentlyUsed = nullptr;
+		for (auto const& cachedDetails : this->SessionDetailsCache)
+		{
+			if (!leastRecentlyUsed
+				|| (leastRecentlyUsed->Value.bPinned && !cachedDetails.Value.bPinned)
+				|| (leastRecentlyUsed->Value.bPinned == cachedDetails.Value.bPinned && cachedDetails.Value.LastUsedTime < leastRecentlyUsed->Value.LastUsedTime))
 			{
-				goto handleError;
+				leastRecentlyUsed = &cachedDetails;
 			}
 		}
-		else
+		FString const evictedSessionId = leastRecentlyUsed->Key;
+		EOS_SessionDetails_Release(leastRecentlyUsed->Value.DetailsHandle);
+		this->SessionDetailsCache.Remove(evictedSessionId);
+	}
+
+	this->SessionDetailsCache.Add(sessionId, FSessionDetailsCacheEntryEpic{ DetailsHandle, FPlatformTime::Seconds(), bPin });
+}
+
+EOS_HSessionDetails FOnlineSessionEpic::FindCachedSessionDetails(FString const& SessionId)
+{
+	FSessionDetailsCacheEntryEpic* cachedDetails = this->SessionDetailsCache.Find(SessionId);
+	if (!cachedDetails)
+	{
+		return nullptr;
+	}
+
+	cachedDetails->LastUsedTime = FPlatformTime::Seconds();
+	return cachedDetails->DetailsHandle;
+}
+
+bool FOnlineSessionEpic::CreateSearchResultFromDetails(EOS_HSessionDetails DetailsHandle, FOnlineSessionSearchResult& OutSearchResult)
+{
+	EOS_SessionDetails_Info* eosSessionInfo = nullptr;
+	EOS_SessionDetails_CopyInfoOptions copyInfoOptions = {
+		EOS_SESSIONDETAILS_COPYINFO_API_LATEST
+	};
+	EOS_EResult eosResult = EOS_SessionDetails_CopyInfo(DetailsHandle, &copyInfoOptions, &eosSessionInfo);
+	if (eosResult != EOS_EResult::EOS_Success)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't copy session info.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		return false;
+	}
+
+	// Ping is set to -1, as we have no way of retrieving it for now
+	OutSearchResult.PingInMs = -1;
+	this->SetSessionDetails(&OutSearchResult.Session, eosSessionInfo, DetailsHandle);
+
+	EOS_SessionDetails_Info_Release(eosSessionInfo);
+	return true;
+}
+
+bool FOnlineSessionEpic::CacheInviteSession(char const* InviteId, bool bPin, FOnlineSessionSearchResult& OutSearchResult)
+{
+	EOS_Sessions_CopySessionHandleByInviteIdOptions copySessionHandleByInviteIdOptions = {
+		EOS_SESSIONS_COPYSESSIONHANDLEBYINVITEID_API_LATEST,
+		InviteId
+	};
+	EOS_HSessionDetails sessionDetailsHandle = nullptr;
+	EOS_EResult eosResult = EOS_Sessions_CopySessionHandleByInviteId(this->sessionsHandle, &copySessionHandleByInviteIdOptions, &sessionDetailsHandle);
+	if (eosResult != EOS_EResult::EOS_Success)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Error copying session handle by invite.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		return false;
+	}
+
+	// The info is allocated by EOS
+	EOS_SessionDetails_Info* eosSessionInfo = nullptr;
+	EOS_SessionDetails_CopyInfoOptions copyInfoOptions = {
+		EOS_SESSIONDETAILS_COPYINFO_API_LATEST
+	};
+	eosResult = EOS_SessionDetails_CopyInfo(sessionDetailsHandle, &copyInfoOptions, &eosSessionInfo);
+	if (eosResult != EOS_EResult::EOS_Success)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Error copying session details.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		EOS_SessionDetails_Release(sessionDetailsHandle);
+		return false;
+	}
+
+	// Ping is set to -1, as we have no way of retrieving it for now
+	OutSearchResult.PingInMs = -1;
+	this->SetSessionDetails(&OutSearchResult.Session, eosSessionInfo, sessionDetailsHandle);
+
+	// Keep the handle, so the session can be joined without searching for it
+	this->CacheSessionDetails(sessionDetailsHandle, eosSessionInfo, bPin);
+
+	EOS_SessionDetails_Info_Release(eosSessionInfo);
+	return true;
+}
+
+void FOnlineSessionEpic::LookupSessionById(FUniqueNetId const& SearchingUserId, FString const& SessionId, FOnSessionSearchCompleteEpic&& OnComplete)
+{
+	FString error;
+
+	// A search for a single session id returns at most one result
+	EOS_Sessions_CreateSessionSearchOptions sessionSearchOpts = {
+		EOS_SESSIONS_CREATESESSIONSEARCH_API_LATEST,
+		1
+	};
+	EOS_HSessionSearch sessionSearchHandle = nullptr;
+	EOS_EResult eosResult = EOS_Sessions_CreateSessionSearch(this->sessionsHandle, &sessionSearchOpts, &sessionSearchHandle);
+	if (eosResult == EOS_EResult::EOS_Success)
+	{
+		FTCHARToUTF8 sessionIdUtf8(*SessionId);
+		EOS_SessionSearch_SetSessionIdOptions setSessionIdOptions = {
+			EOS_SESSIONSEARCH_SETSESSIONID_API_LATEST,
+			sessionIdUtf8.Get()
+		};
+		eosResult = EOS_SessionSearch_SetSessionId(sessionSearchHandle, &setSessionIdOptions);
+		if (eosResult == EOS_EResult::EOS_Success)
 		{
-			goto handleError;
+			EOS_SessionSearch_FindOptions findOptions = {
+				EOS_SESSIONSEARCH_FIND_API_LATEST,
+				((FUniqueNetIdEpic)SearchingUserId).ToProductUserId()
+			};
+			void* clientData = SessionLookupContexts.Add(this, FSessionLookupAdditionalData{
+				this,
+				sessionSearchHandle,
+				MoveTemp(OnComplete)
+			});
+			EOS_SessionSearch_Find(sessionSearchHandle, &findOptions, clientData, &FOnlineSessionEpic::OnEOSSessionLookupComplete);
+			return;
 		}
+
+		error = FString::Printf(TEXT("[EOS SDK] Couldn't set session id %s. Error: %s"), *SessionId, UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		EOS_SessionSearch_Release(sessionSearchHandle);
 	}
+	else
+	{
+		error = FString::Printf(TEXT("[EOS SDK] Couldn't create sessionsearch. Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+	}
+
+	UE_LOG_ONLINE_SESSION(Warning, TEXT("%s"), *error);
+	OnComplete(false);
+}
+
+// ---------------------------------------------
+// Matchmaking
+// ---------------------------------------------
 
-	// bUsesStats
+/** Returns true if a search parameter selects the bucket and therefore is never relaxed */
+static bool IsBucketSearchParam(FName const& Key)
+{
+	static FName const bucketIdKey(TEXT("BucketId"));
+	return Key == bucketIdKey || Key == EosBucketIdKey;
+}
+
+void FOnlineSessionEpic::OnMatchmakingPassComplete(FName SessionName, uint64 TicketId)
+{
+	FMatchmakingTicketEpic* ticket = this->MatchmakingTickets.Find(SessionName);
+	if (!ticket || ticket->TicketId != TicketId || ticket->State != EMatchmakingStateEpic::Searching)
 	{
-		setting = TEXT("bUsesStats");
-		data.SetValue(NewSessionSettings.bUsesStats);
+		// Cancelled, or a candidate was already picked
+		return;
+	}
 
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
+	// Candidates are scored by their ping, which is still unknown right after the search.
+	// Wait for the queued pings to land, at most for the ping timeout. The deadline still applies
+	if (this->PingClient && this->PingClient->GetNumOutstanding() > 0)
+	{
+		if (ticket->PingWaitEndTime == 0.0)
 		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
+			ticket->PingWaitEndTime = FPlatformTime::Seconds() + this->PingClient->GetTimeout();
+		}
+		return;
+	}
 
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-			if (eosResult != EOS_EResult::EOS_Success)
+	ticket->PingWaitEndTime = 0.0;
+	this->EvaluateMatchmaking(SessionName, false);
+}
+
+void FOnlineSessionEpic::TickMatchmakingPingWaits()
+{
+	bool const bPingsOutstanding = this->PingClient && this->PingClient->GetNumOutstanding() > 0;
+	double const now = FPlatformTime::Seconds();
+
+	TArray<FName> sessionNames;
+	for (TPair<FName, FMatchmakingTicketEpic> const& ticket : this->MatchmakingTickets)
+	{
+		if (ticket.Value.State == EMatchmakingStateEpic::Searching && ticket.Value.PingWaitEndTime > 0.0
+			&& (!bPingsOutstanding || now >= ticket.Value.PingWaitEndTime))
+		{
+			sessionNames.Add(ticket.Key);
+		}
+	}
+
+	// Evaluating can complete and remove requests, so they're looked up again
+	for (FName const& sessionName : sessionNames)
+	{
+		FMatchmakingTicketEpic* ticket = this->MatchmakingTickets.Find(sessionName);
+		if (ticket && ticket->State == EMatchmakingStateEpic::Searching && ticket->PingWaitEndTime > 0.0)
+		{
+			UE_CLOG_ONLINE_SESSION(bPingsOutstanding, Log, TEXT("Matchmaking for session \"%s\" stopped waiting for pings."), *sessionName.ToString());
+			ticket->PingWaitEndTime = 0.0;
+			this->EvaluateMatchmaking(sessionName, false);
+		}
+	}
+}
+
+void FOnlineSessionEpic::OnMatchmakingDeadline(FName SessionName, uint64 TicketId)
+{
+	FMatchmakingTicketEpic* ticket = this->MatchmakingTickets.Find(SessionName);
+	if (!ticket || ticket->TicketId != TicketId || ticket->State != EMatchmakingStateEpic::Searching)
+	{
+		return;
+	}
+
+	ticket->DeadlineTimer = 0;
+	ticket->PingWaitEndTime = 0.0;
+	UE_LOG_ONLINE_SESSION(Log, TEXT("Matchmaking for session \"%s\" reached its deadline, settling for the best candidate found."), *SessionName.ToString());
+	this->EvaluateMatchmaking(SessionName, true);
+}
+
+bool FOnlineSessionEpic::EvaluateMatchmaking(FName SessionName, bool bAllowIncompletePasses)
+{
+	FMatchmakingTicketEpic& ticket = this->MatchmakingTickets.FindChecked(SessionName);
+
+	// Collect the candidates of all completed passes.
+	// A session returned by multiple passes is scored for the strictest of them.
+	TMap<FString, TPair<float, FOnlineSessionSearchResult const*>> candidates;
+	bool allPassesComplete = true;
+	for (int32 passIdx = 0; passIdx < ticket.Passes.Num(); ++passIdx)
+	{
+		FOnlineSessionSearch const& pass = *ticket.Passes[passIdx];
+		if (pass.SearchState != EOnlineAsyncTaskState::Done && pass.SearchState != EOnlineAsyncTaskState::Failed)
+		{
+			allPassesComplete = false;
+			if (!bAllowIncompletePasses)
+			{
+				// Stricter passes take precedence, wait for them before picking a candidate
+				break;
+			}
+			continue;
+		}
+
+		for (FOnlineSessionSearchResult const& searchResult : pass.SearchResults)
+		{
+			FString const sessionId = searchResult.GetSessionIdStr();
+			if (candidates.Contains(sessionId))
+			{
+				continue;
+			}
+
+			float const score = ScoreMatchmakingCandidate(searchResult, passIdx, ticket.NumLocalPlayers);
+			if (score >= 0.0f)
 			{
-				goto handleError;
+				candidates.Add(sessionId, TPair<float, FOnlineSessionSearchResult const*>(score, &searchResult));
 			}
 		}
+	}
+
+	if (candidates.Num() == 0 && !allPassesComplete && !bAllowIncompletePasses)
+	{
+		// Relaxed passes might still find something
+		return false;
+	}
+
+	TArray<TPair<float, FOnlineSessionSearchResult const*>> sortedCandidates;
+	candidates.GenerateValueArray(sortedCandidates);
+	sortedCandidates.Sort([](TPair<float, FOnlineSessionSearchResult const*> const& A, TPair<float, FOnlineSessionSearchResult const*> const& B)
+		{
+			return A.Key > B.Key;
+		});
+
+	ticket.Candidates.Reset(sortedCandidates.Num());
+	for (TPair<float, FOnlineSessionSearchResult const*> const& candidate : sortedCandidates)
+	{
+		ticket.Candidates.Add(*candidate.Value);
+	}
+
+	// The caller's search receives all candidates, best first
+	ticket.SearchSettings->SearchResults = ticket.Candidates;
+	ticket.SearchSettings->SearchState = EOnlineAsyncTaskState::Done;
+
+	this->SearchTimers.Cancel(ticket.DeadlineTimer);
+	ticket.DeadlineTimer = 0;
+	ticket.State = EMatchmakingStateEpic::Joining;
+
+	UE_LOG_ONLINE_SESSION(Log, TEXT("Matchmaking for session \"%s\" found %d candidate(s)."), *SessionName.ToString(), ticket.Candidates.Num());
+	this->JoinNextMatchmakingCandidate(SessionName);
+	return true;
+}
+
+void FOnlineSessionEpic::JoinNextMatchmakingCandidate(FName SessionName)
+{
+	FMatchmakingTicketEpic& ticket = this->MatchmakingTickets.FindChecked(SessionName);
+	TSharedRef<FUniqueNetId const> searchingPlayerId = ticket.SearchingPlayerId;
+
+	// While the player's tokens are refreshed, the next attempt is made once the refresh completed
+	uint64 const ticketId = ticket.TicketId;
+	bool const bDeferred = this->Subsystem->IdentityInterface->DeferWhileRefreshingToken(*searchingPlayerId, [this, SessionName, ticketId](FUniqueNetId const& RefreshedPlayerId)
+	{
+		FMatchmakingTicketEpic const* deferredTicket = this->MatchmakingTickets.Find(SessionName);
+		if (deferredTicket && deferredTicket->TicketId == ticketId)
+		{
+			this->JoinNextMatchmakingCandidate(SessionName);
+		}
+	});
+	if (bDeferred)
+	{
+		return;
+	}
+
+	if (ticket.Candidates.Num() > 0)
+	{
+		FOnlineSessionSearchResult const candidate = ticket.Candidates[0];
+		ticket.Candidates.RemoveAt(0);
+
+		// Completion is handled in OnMatchmakingJoinSessionComplete
+		this->StartJoinSession(*searchingPlayerId, SessionName, candidate, true);
+	}
+	else
+	{
+		// Nothing suitable, host a session for others to find
+		ticket.State = EMatchmakingStateEpic::Creating;
+		FOnlineSessionSettings const newSessionSettings = ticket.NewSessionSettings;
+
+		UE_LOG_ONLINE_SESSION(Log, TEXT("Matchmaking for session \"%s\" found no suitable session, creating one."), *SessionName.ToString());
+
+		// Completion is handled in OnMatchmakingCreateSessionComplete
+		this->StartCreateSession(*searchingPlayerId, SessionName, newSessionSettings, true);
+	}
+}
+
+void FOnlineSessionEpic::OnMatchmakingJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
+{
+	FMatchmakingTicketEpic const* ticket = this->MatchmakingTickets.Find(SessionName);
+	if (!ticket || ticket->State != EMatchmakingStateEpic::Joining)
+	{
+		return;
+	}
+
+	if (Result == EOnJoinSessionCompleteResult::Success)
+	{
+		this->FinishMatchmaking(SessionName, true);
+	}
+	else
+	{
+		// The session might have filled up in the meantime, try the next one
+		UE_LOG_ONLINE_SESSION(Log, TEXT("Matchmaking couldn't join candidate for session \"%s\", trying next."), *SessionName.ToString());
+		this->JoinNextMatchmakingCandidate(SessionName);
+	}
+}
+
+void FOnlineSessionEpic::OnMatchmakingCreateSessionComplete(FName SessionName, bool bWasSuccessful)
+{
+	FMatchmakingTicketEpic const* ticket = this->MatchmakingTickets.Find(SessionName);
+	if (!ticket || ticket->State != EMatchmakingStateEpic::Creating)
+	{
+		return;
+	}
+
+	this->FinishMatchmaking(SessionName, bWasSuccessful);
+}
+
+void FOnlineSessionEpic::CompleteJoinSession(FName SessionName, EOnJoinSessionCompleteResult::Type Result, bool bForMatchmaking)
+{
+	if (bForMatchmaking)
+	{
+		this->OnMatchmakingJoinSessionComplete(SessionName, Result);
+	}
+	else
+	{
+		this->TriggerOnJoinSessionCompleteDelegates(SessionName, Result);
+	}
+}
+
+void FOnlineSessionEpic::CompleteCreateSession(FName SessionName, bool bWasSuccessful, bool bForMatchmaking)
+{
+	if (bForMatchmaking)
+	{
+		this->OnMatchmakingCreateSessionComplete(SessionName, bWasSuccessful);
+	}
+	else
+	{
+		this->TriggerOnCreateSessionCompleteDelegates(SessionName, bWasSuccessful);
+	}
+}
+
+void FOnlineSessionEpic::FinishMatchmaking(FName SessionName, bool bWasSuccessful)
+{
+	FMatchmakingTicketEpic ticket = this->MatchmakingTickets.FindAndRemoveChecked(SessionName);
+	this->SearchTimers.Cancel(ticket.DeadlineTimer);
+
+	if (bWasSuccessful)
+	{
+		double const timeToMatch = FPlatformTime::Seconds() - ticket.StartTime;
+		this->MatchmakingStats.LastTimeToMatch = timeToMatch;
+		this->MatchmakingStats.TotalTimeToMatch += timeToMatch;
+		if (ticket.State == EMatchmakingStateEpic::Creating)
+		{
+			++this->MatchmakingStats.NumCreated;
+		}
 		else
 		{
-			goto handleError;
+			++this->MatchmakingStats.NumJoined;
 		}
+
+		UE_LOG_ONLINE_SESSION(Display, TEXT("Matchmaking for session \"%s\" %s a session after %.2f seconds."),
+			*SessionName.ToString(), ticket.State == EMatchmakingStateEpic::Creating ? TEXT("created") : TEXT("joined"), timeToMatch);
+	}
+	else
+	{
+		++this->MatchmakingStats.NumFailed;
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Matchmaking for session \"%s\" failed."), *SessionName.ToString());
+	}
+
+	this->TriggerOnMatchmakingCompleteDelegates(SessionName, bWasSuccessful);
+}
+
+float FOnlineSessionEpic::ScoreMatchmakingCandidate(FOnlineSessionSearchResult const& SearchResult, int32 PassIndex, int32 NumLocalPlayers)
+{
+	FOnlineSession const& session = SearchResult.Session;
+	if (session.NumOpenPublicConnections < NumLocalPlayers)
+	{
+		return -1.0f;
+	}
+
+	// Fuller sessions start sooner, prefer them
+	int32 const maxPlayers = session.SessionSettings.NumPublicConnections;
+	float const fillLevel = maxPlayers > 0 ? float(maxPlayers - session.NumOpenPublicConnections) / maxPlayers : 0.0f;
+
+	// Latency up to a quarter second is weighted linearly. Unknown ping counts as average
+	float const pingPenalty = SearchResult.PingInMs >= 0 ? FMath::Min(SearchResult.PingInMs / 250.0f, 1.0f) : 0.5f;
+
+	// Every relaxed search parameter makes a candidate less desirable
+	float const relaxationPenalty = 0.25f * PassIndex;
+
+	return FMath::Max(0.0f, 1.0f + fillLevel - pingPenalty - relaxationPenalty);
+}
+
+// ---------------------------------------------
+// Roster updates
+// ---------------------------------------------
+
+/** Converts net ids to EOS product user ids */
+static TArray<EOS_ProductUserId> ToProductUserIds(TArray<TSharedRef<const FUniqueNetId>> const& Players)
+{
+	TArray<EOS_ProductUserId> productUserIds;
+	productUserIds.Reserve(Players.Num());
+	for (TSharedRef<const FUniqueNetId> const& playerId : Players)
+	{
+		productUserIds.Add(StaticCastSharedRef<FUniqueNetIdEpic const>(playerId)->ToProductUserId());
+	}
+	return productUserIds;
+}
+
+void FOnlineSessionEpic::FlushRosterUpdates(FName SessionName)
+{
+	FPendingRosterEpic pendingRoster;
+	if (!this->PendingRosterUpdates.RemoveAndCopyValue(SessionName, pendingRoster))
+	{
+		return;
+	}
+
+	TSharedRef<FRosterBatchEpic> batch = MakeShared<FRosterBatchEpic>();
+	batch->Requests = MoveTemp(pendingRoster.Requests);
+
+	if (!this->GetNamedSession(SessionName))
+	{
+		// The session was destroyed before the changes could be sent
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Session destroyed before its roster changes were sent.\r\n    Session Name: %s"), *SessionName.ToString());
+		batch->bRegisterSucceeded = false;
+		batch->bUnregisterSucceeded = false;
+		this->CompleteRosterBatch(SessionName, *batch);
+		return;
+	}
+
+	// Count the requests up front, so the batch can't complete before all of them were sent
+	batch->NumOutstandingCalls = (pendingRoster.PlayersToRegister.Num() > 0 ? 1 : 0) + (pendingRoster.PlayersToUnregister.Num() > 0 ? 1 : 0);
+	if (batch->NumOutstandingCalls == 0)
+	{
+		// Nothing to send, e.g. all players left again during the same tick
+		this->CompleteRosterBatch(SessionName, *batch);
+		return;
+	}
+
+	FTCHARToUTF8 sessionNameUtf8(*SessionName.ToString());
+
+	if (pendingRoster.PlayersToRegister.Num() > 0)
+	{
+		TArray<EOS_ProductUserId> productUserIds = ToProductUserIds(pendingRoster.PlayersToRegister);
+
+		EOS_Sessions_RegisterPlayersOptions registerPlayerOpts = {};
+		registerPlayerOpts.ApiVersion = EOS_SESSIONS_REGISTERPLAYERS_API_LATEST;
+		registerPlayerOpts.SessionName = sessionNameUtf8.Get();
+		registerPlayerOpts.PlayersToRegister = productUserIds.GetData();
+		registerPlayerOpts.PlayersToRegisterCount = static_cast<uint32_t>(productUserIds.Num());
+
+		void* clientData = RosterCallContexts.Add(this, FRosterCallAdditionalData{
+			this,
+			SessionName,
+			MoveTemp(pendingRoster.PlayersToRegister),
+			batch
+		});
+		EOS_Sessions_RegisterPlayers(this->sessionsHandle, &registerPlayerOpts, clientData, &FOnlineSessionEpic::OnEOSRegisterPlayersComplete);
+	}
+
+	if (pendingRoster.PlayersToUnregister.Num() > 0)
+	{
+		TArray<EOS_ProductUserId> productUserIds = ToProductUserIds(pendingRoster.PlayersToUnregister);
+
+		EOS_Sessions_UnregisterPlayersOptions unregisterPlayerOpts = {};
+		unregisterPlayerOpts.ApiVersion = EOS_SESSIONS_UNREGISTERPLAYERS_API_LATEST;
+		unregisterPlayerOpts.SessionName = sessionNameUtf8.Get();
+		unregisterPlayerOpts.PlayersToUnregister = productUserIds.GetData();
+		unregisterPlayerOpts.PlayersToUnregisterCount = static_cast<uint32_t>(productUserIds.Num());
+
+		void* clientData = RosterCallContexts.Add(this, FRosterCallAdditionalData{
+			this,
+			SessionName,
+			MoveTemp(pendingRoster.PlayersToUnregister),
+			batch
+		});
+		EOS_Sessions_UnregisterPlayers(this->sessionsHandle, &unregisterPlayerOpts, clientData, &FOnlineSessionEpic::OnEOSUnRegisterPlayersComplete);
+	}
+}
+
+void FOnlineSessionEpic::OnRosterCallComplete(FName SessionName, TArray<TSharedRef<const FUniqueNetId>> const& Players, TSharedRef<FRosterBatchEpic> const& Batch, bool bRegister, EOS_EResult ResultCode)
+{
+	bool success = ResultCode == EOS_EResult::EOS_Success;
+
+	FNamedOnlineSession* session = this->GetNamedSession(SessionName);
+	if (!session)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("%s callback called, but session not found.\r\n    %s"), bRegister ? TEXT("RegisterPlayers") : TEXT("UnregisterPlayers"), *SessionName.ToString());
+		success = false;
 	}
-
-	// bAllowInvites
+	else if (!success)
 	{
-		setting = TEXT("bAllowInvites");
-		data.SetValue(NewSessionSettings.bAllowInvites);
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't %s players.\r\n    Error: %s"), bRegister ? TEXT("register") : TEXT("unregister"), UTF8_TO_TCHAR(EOS_EResult_ToString(ResultCode)));
 
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
+		// Revert the local roster to what the backend knows.
+		// Slots go back to the pool they were taken from
+		for (TSharedRef<const FUniqueNetId> const& playerId : Players)
 		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
-
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-			if (eosResult != EOS_EResult::EOS_Success)
+			FUniqueNetIdMatcher PlayerMatch(*playerId);
+			int32 const playerIdx = session->RegisteredPlayers.IndexOfByPredicate(PlayerMatch);
+			if (bRegister && playerIdx != INDEX_NONE)
 			{
-				goto handleError;
+				session->RegisteredPlayers.RemoveAtSwap(playerIdx);
+				this->ReleaseSlot(*session, playerId->ToString());
+			}
+			else if (!bRegister && playerIdx == INDEX_NONE)
+			{
+				// The backend still counts the player, so the player gets a slot even if the session filled up in the meantime
+				session->RegisteredPlayers.Add(playerId);
+				this->TakeSlot(*session, *playerId, false, true);
+				this->ConfirmSlot(SessionName, *playerId);
 			}
-		}
-		else
-		{
-			goto handleError;
 		}
 	}
 
-	// bShouldAdvertise || bAllowJoinViaPresence || bAllowJoinViaPresenceFriendsOnly
-	// More restrictive from left to right. More restrictive takes precedence.
+	if (bRegister)
 	{
-		EOS_EOnlineSessionPermissionLevel permissionLevel = EOS_EOnlineSessionPermissionLevel::EOS_OSPF_InviteOnly;
-		if (NewSessionSettings.bShouldAdvertise)
-		{
-			if (NewSessionSettings.bAllowJoinViaPresence)
-			{
-				permissionLevel = EOS_EOnlineSessionPermissionLevel::EOS_OSPF_PublicAdvertised;
-			}
-			if (NewSessionSettings.bAllowJoinViaPresenceFriendsOnly)
-			{
-				permissionLevel = permissionLevel = EOS_EOnlineSessionPermissionLevel::EOS_OSPF_JoinViaPresence;
-			}
-		}
-		EOS_SessionModification_SetPermissionLevelOptions permissionOpts{
-			EOS_SESSIONMODIFICATION_SETPERMISSIONLEVEL_API_LATEST,
-			permissionLevel
-		};
-		eosResult = EOS_SessionModification_SetPermissionLevel(ModificationHandle, &permissionOpts);
-		if (eosResult != EOS_EResult::EOS_Success)
-		{
-			setting = TEXT("bShouldAdvertise || bAllowJoinViaPresence || bAllowJoinViaPresenceFriendsOnly");
-			goto handleError;
-		}
+		Batch->bRegisterSucceeded = success;
+	}
+	else
+	{
+		Batch->bUnregisterSucceeded = success;
 	}
 
-	// bAntiCheatProtected
+	if (--Batch->NumOutstandingCalls == 0)
 	{
-		setting = TEXT("bAntiCheatProtected");
-		data.SetValue(NewSessionSettings.bAntiCheatProtected);
+		this->CompleteRosterBatch(SessionName, *Batch);
+	}
+}
 
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
+void FOnlineSessionEpic::CompleteRosterBatch(FName SessionName, FRosterBatchEpic const& Batch)
+{
+	for (FRosterRequestEpic const& request : Batch.Requests)
+	{
+		if (request.bRegister)
 		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
-
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-			if (eosResult != EOS_EResult::EOS_Success)
-			{
-				goto handleError;
-			}
+			// Rejected players are part of the call's result, which fails because of them
+			TArray<TSharedRef<const FUniqueNetId>> players = request.Players;
+			players.Append(request.RejectedPlayers);
+			TriggerOnRegisterPlayersCompleteDelegates(SessionName, players, Batch.bRegisterSucceeded && request.RejectedPlayers.Num() == 0);
 		}
 		else
 		{
-			goto handleError;
+			TriggerOnUnregisterPlayersCompleteDelegates(SessionName, request.Players, Batch.bUnregisterSucceeded);
 		}
 	}
+}
 
-	// BuildUniqueId
-	{
-		setting = TEXT("BuildUniqueId");
-		data.SetValue(NewSessionSettings.BuildUniqueId);
+// ---------------------------------------------
+// Slot reservations
+// ---------------------------------------------
 
-		EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, data, Error);
-		if (Error.IsEmpty())
-		{
-			EOS_SessionModification_AddAttributeOptions attrOpts = {
-			   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-			   &attrData,
-			   EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise
-			};
+bool FOnlineSessionEpic::TakeSlot(FNamedOnlineSession& Session, FUniqueNetId const& PlayerId, bool bWasInvited, bool bForce)
+{
+	TMap<FString, FSlotReservationEpic>& reservations = this->SlotReservations.FindOrAdd(Session.SessionName);
+	FString const playerKey = PlayerId.ToString();
+	if (reservations.Contains(playerKey))
+	{
+		return true;
+	}
 
-			eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-			if (eosResult != EOS_EResult::EOS_Success)
-			{
-				goto handleError;
-			}
-		}
-		else
-		{
-			goto handleError;
-		}
+	// Private connections are meant for invited players. Everyone else only falls back to them
+	ESessionSlotEpic slot = ESessionSlotEpic::None;
+	if (bWasInvited && Session.NumOpenPrivateConnections > 0)
+	{
+		slot = ESessionSlotEpic::Private;
+	}
+	else if (Session.NumOpenPublicConnections > 0)
+	{
+		slot = ESessionSlotEpic::Public;
+	}
+	else if (Session.NumOpenPrivateConnections > 0)
+	{
+		slot = ESessionSlotEpic::Private;
+	}
+	else if (!bForce)
+	{
+		return false;
 	}
 
-	// FSessionSettings[]
+	if (slot == ESessionSlotEpic::Public)
 	{
-		for (auto s : NewSessionSettings.Settings)
-		{
-			setting = s.Key.ToString();
-			EOS_ESessionAttributeAdvertisementType advertisementType;
-			if (s.Value.AdvertisementType == EOnlineDataAdvertisementType::DontAdvertise)
-			{
-				advertisementType = EOS_ESessionAttributeAdvertisementType::EOS_SAAT_DontAdvertise;
-			}
-			else
-			{
-				advertisementType = EOS_ESessionAttributeAdvertisementType::EOS_SAAT_Advertise;
-			}
+		--Session.NumOpenPublicConnections;
+	}
+	else if (slot == ESessionSlotEpic::Private)
+	{
+		--Session.NumOpenPrivateConnections;
+	}
 
-			EOS_Sessions_AttributeData attrData = CreateEOSAttributeData(setting, s.Value.Data, Error);
-			if (Error.IsEmpty())
-			{
-				EOS_SessionModification_AddAttributeOptions attrOpts = {
-				   EOS_SESSIONMODIFICATION_ADDATTRIBUTE_API_LATEST,
-				   &attrData,
-				   advertisementType
-				};
+	reservations.Add(playerKey).Slot = slot;
+	return true;
+}
 
-				eosResult = EOS_SessionModification_AddAttribute(ModificationHandle, &attrOpts);
-				if (eosResult != EOS_EResult::EOS_Success)
-				{
-					goto handleError;
-				}
-			}
-			else
-			{
-				goto handleError;
-			}
-		}
+void FOnlineSessionEpic::ReleaseSlot(FNamedOnlineSession& Session, FString const& PlayerKey)
+{
+	TMap<FString, FSlotReservationEpic>* reservations = this->SlotReservations.Find(Session.SessionName);
+	FSlotReservationEpic reservation;
+	if (!reservations || !reservations->RemoveAndCopyValue(PlayerKey, reservation))
+	{
+		return;
 	}
 
-	// Set the total players, which are (public + private) connections
+	this->SearchTimers.Cancel(reservation.ExpiryTimer);
+	if (reservation.Slot == ESessionSlotEpic::Public)
 	{
-		EOS_SessionModification_SetMaxPlayersOptions playerOpts = {};
-		playerOpts.ApiVersion = EOS_SESSIONMODIFICATION_SETMAXPLAYERS_API_LATEST;
-		playerOpts.MaxPlayers = NewSessionSettings.NumPrivateConnections + NewSessionSettings.NumPublicConnections;
+		Session.NumOpenPublicConnections = FMath::Min(Session.NumOpenPublicConnections + 1, Session.SessionSettings.NumPublicConnections);
+	}
+	else if (reservation.Slot == ESessionSlotEpic::Private)
+	{
+		Session.NumOpenPrivateConnections = FMath::Min(Session.NumOpenPrivateConnections + 1, Session.SessionSettings.NumPrivateConnections);
+	}
+}
 
-		eosResult = EOS_SessionModification_SetMaxPlayers(ModificationHandle, &playerOpts);
-		if (eosResult != EOS_EResult::EOS_Success)
-		{
-			setting = TEXT("MaxPlayers");
-			goto handleError;
-		}
+void FOnlineSessionEpic::ConfirmSlot(FName SessionName, FUniqueNetId const& PlayerId)
+{
+	TMap<FString, FSlotReservationEpic>* reservations = this->SlotReservations.Find(SessionName);
+	FSlotReservationEpic* reservation = reservations ? reservations->Find(PlayerId.ToString()) : nullptr;
+	if (reservation)
+	{
+		reservation->bConfirmed = true;
+		this->SearchTimers.Cancel(reservation->ExpiryTimer);
+		reservation->ExpiryTimer = 0;
+	}
+}
+
+void FOnlineSessionEpic::OnSlotReservationExpired(FName SessionName, FString const& PlayerKey)
+{
+	// Confirming or releasing a reservation cancels its timer, so a reservation found here is still unconfirmed
+	FNamedOnlineSession* session = this->GetNamedSession(SessionName);
+	TMap<FString, FSlotReservationEpic>* reservations = this->SlotReservations.Find(SessionName);
+	FSlotReservationEpic* reservation = reservations ? reservations->Find(PlayerKey) : nullptr;
+	if (!session || !reservation)
+	{
+		return;
 	}
-	return;
 
-handleError:
-	// If there's an error, assign it to Error and default the ModificationHandle
-	Error = FString::Printf(TEXT("Cannot update setting: %s - Error Code: %s"), *setting, UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
-	ModificationHandle = EOS_HSessionModification();
+	UE_LOG_ONLINE_SESSION(Log, TEXT("Slot reservation of player %s in session \"%s\" expired."), *PlayerKey, *SessionName.ToString());
+	reservation->ExpiryTimer = 0;
+	this->ReleaseSlot(*session, PlayerKey);
 }
 
 // ---------------------------------------------
@@ -727,14 +2573,19 @@ void FOnlineSessionEpic::OnEOSCreateSessionComplete(const EOS_Sessions_UpdateSes
 	/** Result code for the operation. EOS_Success is returned for a successful operation, otherwise one of the error codes is returned. See eos_common.h */
 	EOS_EResult ResultCode = Data->ResultCode;
 	/** Context that was passed into EOS_Sessions_UpdateSession */
-	FCreateSessionAdditionalData* additionalData = static_cast<FCreateSessionAdditionalData*>(Data->ClientData);
+	TOptional<FCreateSessionAdditionalData> additionalData = CreateSessionContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
 	FOnlineSessionEpic* thisPtr = additionalData->OnlineSessionPtr;
 
 	if (ResultCode != EOS_EResult::EOS_Success)
 	{
 		UE_LOG_ONLINE_SESSION(Warning, TEXT("Update Session failed. Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(ResultCode)));
 		thisPtr->RemoveNamedSession(sessionName);
-		thisPtr->TriggerOnCreateSessionCompleteDelegates(sessionName, false);
+		thisPtr->CompleteCreateSession(sessionName, false, additionalData->bForMatchmaking);
 		return;
 	}
 
@@ -742,10 +2593,13 @@ void FOnlineSessionEpic::OnEOSCreateSessionComplete(const EOS_Sessions_UpdateSes
 	if (!session)
 	{
 		UE_LOG_ONLINE_SESSION(Fatal, TEXT("CreateSession complete callback called, but session \"%s\" not found."), *sessionName.ToString());
-		thisPtr->TriggerOnCreateSessionCompleteDelegates(sessionName, false);
+		thisPtr->CompleteCreateSession(sessionName, false, additionalData->bForMatchmaking);
 		return;
 	}
 
+	// Remember what the backend knows, so updates only need to send the differences
+	thisPtr->PushedSessionSettings.Add(sessionName, additionalData->PushedSessionSettings);
+
 	// --------------------------
 	// Create a new session info class, that includes the session id and host address
 	// --------------------------
@@ -767,7 +2621,7 @@ void FOnlineSessionEpic::OnEOSCreateSessionComplete(const EOS_Sessions_UpdateSes
 	EOS_Sessions_CopyActiveSessionHandle(thisPtr->sessionsHandle, &copyActiveSessionHandleOptions, &activeSessionHandle);
 
 	// Get information about the active session
-	EOS_ActiveSession_Info* activeSessionInfo = new EOS_ActiveSession_Info();
+	EOS_ActiveSession_Info* activeSessionInfo = nullptr;
 	EOS_ActiveSession_CopyInfoOptions activeSessionCopyInfoOptions = {
 		EOS_ACTIVESESSION_COPYINFO_API_LATEST
 	};
@@ -782,21 +2636,21 @@ void FOnlineSessionEpic::OnEOSCreateSessionComplete(const EOS_Sessions_UpdateSes
 	// Release the active session handle memory
 	EOS_ActiveSession_Release(activeSessionHandle);
 
-	// Release the additional data struct
-	delete additionalData;
-
 	UE_LOG_ONLINE_SESSION(Display, TEXT("Created session: %s"), *sessionName.ToString());
-	thisPtr->TriggerOnCreateSessionCompleteDelegates(sessionName, true);
+	thisPtr->CompleteCreateSession(sessionName, true, additionalData->bForMatchmaking);
 }
 
 void FOnlineSessionEpic::OnEOSStartSessionComplete(const EOS_Sessions_StartSessionCallbackInfo* Data)
 {
-	// Context that was passed into EOS_Sessions_UpdateSession
-	// Copy the session ptr and session name, then free
-	FSessionStateChangeAdditionalData* context = (FSessionStateChangeAdditionalData*)Data->ClientData;
+	// Context that was passed into the state change call
+	TOptional<FSessionStateChangeAdditionalData> context = SessionStateChangeContexts.Remove(Data->ClientData);
+	if (!context)
+	{
+		return;
+	}
+
 	FOnlineSessionEpic* thisPtr = context->OnlineSessionPtr;
 	FName sessionName = context->SessionName;
-	delete(context);
 
 	/** Result code for the operation. EOS_Success is returned for a successful operation, otherwise one of the error codes is returned. See eos_common.h */
 	EOS_EResult result = Data->ResultCode;
@@ -820,42 +2674,75 @@ void FOnlineSessionEpic::OnEOSStartSessionComplete(const EOS_Sessions_StartSessi
 
 void FOnlineSessionEpic::OnEOSUpdateSessionComplete(const EOS_Sessions_UpdateSessionCallbackInfo* Data)
 {
-	FName sessionName = FName(Data->SessionName);
-
 	/** Result code for the operation. EOS_Success is returned for a successful operation, otherwise one of the error codes is returned. See eos_common.h */
 	EOS_EResult ResultCode = Data->ResultCode;
 	/** Context that was passed into EOS_Sessions_UpdateSession */
-	FUpdateSessionAdditionalData* context = (FUpdateSessionAdditionalData*)Data->ClientData;
+	TOptional<FUpdateSessionAdditionalData> context = UpdateSessionContexts.Remove(Data->ClientData);
+	if (!context)
+	{
+		return;
+	}
+
 	FOnlineSessionEpic* thisPtr = context->OnlineSessionPtr;
-	FOnlineSessionSettings oldSettings = context->OldSessionSettings;
+	FName sessionName = context->SessionName;
+
+	// A late or duplicate answer has nothing left to complete
+	FSessionAdvertisementEpic* advertisement = thisPtr->SessionAdvertisements.Find(sessionName);
+	if (!advertisement || !advertisement->bInFlight)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("%s called, but no update in flight for session \"%s\""), *FString(__FUNCTION__), *sessionName.ToString());
+		return;
+	}
+
+	int32 const numCalls = advertisement->NumInFlightCalls;
+	advertisement->bInFlight = false;
+	advertisement->NumInFlightCalls = 0;
 
+	bool const sessionExists = thisPtr->GetNamedSession(sessionName) != nullptr;
 	if (ResultCode != EOS_EResult::EOS_Success)
 	{
-		FNamedOnlineSession* session = thisPtr->GetNamedSession(sessionName);
-		if (session)
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Failed to update session - Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(ResultCode)));
+
+		// When rate limited, the local settings stay as they are and are sent again with the next update.
+		// Otherwise they're reverted to what the backend knows, unless a newer update is already queued
+		if (thisPtr->SessionUpdateInterval > 0.0 && sessionExists)
 		{
-			// Revert local only changes
-			session->SessionSettings = oldSettings;
+			advertisement->bDirty = true;
 		}
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Failed to update session - Error Code: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(ResultCode)));
-		thisPtr->TriggerOnCreateSessionCompleteDelegates(sessionName, false);
-		return;
+		else if (sessionExists && !advertisement->bDirty)
+		{
+			if (FOnlineSessionSettings const* pushedSettings = thisPtr->PushedSessionSettings.Find(sessionName))
+			{
+				thisPtr->GetNamedSession(sessionName)->SessionSettings = *pushedSettings;
+			}
+		}
+	}
+	else if (sessionExists)
+	{
+		// The backend now knows about the new settings
+		thisPtr->PushedSessionSettings.Add(sessionName, MoveTemp(advertisement->InFlightSettings));
+		UE_LOG_ONLINE_SESSION(Display, TEXT("Updated session: %s"), *sessionName.ToString());
 	}
 
-	UE_LOG_ONLINE_SESSION(Display, TEXT("Updated session: %s"), *sessionName.ToString());
+	if (!sessionExists)
+	{
+		thisPtr->SessionAdvertisements.Remove(sessionName);
+	}
 
-	// Cleanup the additional resources.
-	delete(context);
+	thisPtr->CompleteSessionUpdateCalls(sessionName, numCalls, ResultCode == EOS_EResult::EOS_Success && sessionExists);
 }
 
 void FOnlineSessionEpic::OnEOSEndSessionComplete(const EOS_Sessions_EndSessionCallbackInfo* Data)
 {
-	// Context that was passed into EOS_Sessions_UpdateSession
-	// Copy the session ptr and session name, then free
-	FSessionStateChangeAdditionalData* context = (FSessionStateChangeAdditionalData*)Data->ClientData;
+	// Context that was passed into the state change call
+	TOptional<FSessionStateChangeAdditionalData> context = SessionStateChangeContexts.Remove(Data->ClientData);
+	if (!context)
+	{
+		return;
+	}
+
 	FOnlineSessionEpic* thisPtr = context->OnlineSessionPtr;
 	FName sessionName = context->SessionName;
-	delete(context);
 
 	/** Result code for the operation. EOS_Success is returned for a successful operation, otherwise one of the error codes is returned. See eos_common.h */
 	EOS_EResult result = Data->ResultCode;
@@ -880,12 +2767,15 @@ void FOnlineSessionEpic::OnEOSEndSessionComplete(const EOS_Sessions_EndSessionCa
 
 void FOnlineSessionEpic::OnEOSDestroySessionComplete(const EOS_Sessions_DestroySessionCallbackInfo* Data)
 {
-	// Context that was passed into EOS_Sessions_UpdateSession
-	// Copy the session ptr and session name, then free
-	FSessionStateChangeAdditionalData* context = (FSessionStateChangeAdditionalData*)Data->ClientData;
+	// Context that was passed into the state change call
+	TOptional<FSessionStateChangeAdditionalData> context = SessionStateChangeContexts.Remove(Data->ClientData);
+	if (!context)
+	{
+		return;
+	}
+
 	FOnlineSessionEpic* thisPtr = context->OnlineSessionPtr;
 	FName sessionName = context->SessionName;
-	delete(context);
 
 	/** Result code for the operation. EOS_Success is returned for a successful operation, otherwise one of the error codes is returned. See eos_common.h */
 	EOS_EResult result = Data->ResultCode;
@@ -909,342 +2799,176 @@ void FOnlineSessionEpic::OnEOSDestroySessionComplete(const EOS_Sessions_DestroyS
 
 void FOnlineSessionEpic::OnEOSFindSessionComplete(const EOS_SessionSearch_FindCallbackInfo* Data)
 {
-	// Context that was passed into EOS_Sessions_UpdateSession
-	// Copy the session ptr and start time, then free
-	FFindSessionsAdditionalData* context = (FFindSessionsAdditionalData*)Data->ClientData;
-	FOnlineSessionEpic* thisPtr = context->OnlineSessionPtr;
-	double searchStartTime = context->SearchStartTime;
-	delete(context);
-
-	FString error;
-
-	TTuple<EOS_HSessionSearch, TSharedRef<FOnlineSessionSearch>>* currentSearch = thisPtr->SessionSearches.Find(searchStartTime);
-	if (currentSearch)
-	{
-		EOS_EResult eosResult = Data->ResultCode;
-		if (eosResult == EOS_EResult::EOS_Success)
-		{
-			TSharedRef<FOnlineSessionSearch> searchRef = currentSearch->Value;
-			EOS_HSessionSearch searchHandle = currentSearch->Key;
-			checkf(searchHandle, TEXT("%s called, but the EOS session search handle is invalid"), *FString(__FUNCTION__));
-
-			// Get how many results we got
-			EOS_SessionSearch_GetSearchResultCountOptions searchResultCountOptions = {
-				EOS_SESSIONSEARCH_GETSEARCHRESULTCOUNT_API_LATEST
-			};
-			uint32 resultCount = EOS_SessionSearch_GetSearchResultCount(searchHandle, &searchResultCountOptions);
-
-			if (resultCount > 0)
-			{
-				for (uint32 i = 0; i < resultCount; ++i)
-				{
-					EOS_SessionSearch_CopySearchResultByIndexOptions copySearchResultsByIndex = {
-						EOS_SESSIONSEARCH_COPYSEARCHRESULTBYINDEX_API_LATEST,
-						i
-					};
-					EOS_HSessionDetails sessionDetailsHandle;
-					eosResult = EOS_SessionSearch_CopySearchResultByIndex(searchHandle, &copySearchResultsByIndex, &sessionDetailsHandle);
-					if (eosResult == EOS_EResult::EOS_Success)
-					{
-						// Allocate space for the session infos
-						EOS_SessionDetails_Info* eosSessionInfo = new EOS_SessionDetails_Info();
-
-						// Copy the session details
-						EOS_SessionDetails_CopyInfoOptions copyInfoOptions = {
-							EOS_SESSIONDETAILS_COPYINFO_API_LATEST
-						};
-						eosResult = EOS_SessionDetails_CopyInfo(sessionDetailsHandle, &copyInfoOptions, &eosSessionInfo);
-						if (eosResult == EOS_EResult::EOS_Success)
-						{
-							// Create a new search result.
-							// Ping is set to -1, as we have no way of retrieving it for now
-							FOnlineSessionSearchResult searchResult;
-							searchResult.PingInMs = -1;
-
-							// Take the session from the search results and update its details
-							thisPtr->SetSessionDetails(&searchResult.Session, eosSessionInfo);
-
-							// Add the session to the list of search results.
-							searchRef->SearchResults.Add(searchResult);
-						}
-						else
-						{
-							error = FString::Printf(TEXT("[EOS SDK] Couldn't copy session info.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-						}
-
-						// Release the prevously allocated memory for the session info;
-						EOS_SessionDetails_Info_Release(eosSessionInfo);
-					}
-					else
-					{
-						error = FString::Printf(TEXT("[EOS SDK] Couldn't get session details handle.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-					}
-				}
-			}
-			else
-			{
-				UE_LOG_ONLINE_SESSION(Display, TEXT("No sessions found"));
-			}
-
-			EOS_SessionSearch_Release(searchHandle);
-			searchRef->SearchState = EOnlineAsyncTaskState::Done;
-		}
-		else
-		{
-			error = FString::Printf(TEXT("[EOS SDK] Couldn't find session. Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-		}
-	}
-	else
-	{
-		error = TEXT("Session search completed, but session not in session search list!");
-	}
-
-	UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("Error in %s\r\n    Message: %s"), *FString(__FUNCTION__), *error);
-	UE_CLOG_ONLINE_SESSION(error.IsEmpty(), Display, TEXT("Finished session search with start time %f"), searchStartTime);
-	thisPtr->TriggerOnFindSessionsCompleteDelegates(error.IsEmpty());
-}
-
-void FOnlineSessionEpic::OnEOSJoinSessionComplete(const EOS_Sessions_JoinSessionCallbackInfo* Data)
-{
-	FJoinSessionAdditionalData* additionalData = (FJoinSessionAdditionalData*)Data->ClientData;
-	checkf(additionalData, TEXT("OnEOSJoinSessionComplete delegate called, but no client data available"));
-
-	FOnlineSessionEpic* thisPtr = additionalData->OnlineSessionPtr;
-	checkf(thisPtr, TEXT("OnEOSJoinSessionComplete: additional data \"this\" missing"));
-
-	FName sessionName = additionalData->SessionName;
-
-	delete(additionalData);
-
-	if (Data->ResultCode != EOS_EResult::EOS_Success)
+	// Context that was passed into EOS_SessionSearch_Find
+	TOptional<FFindSessionsAdditionalData> context = FindSessionsContexts.Remove(Data->ClientData);
+	if (!context)
 	{
-		thisPtr->RemoveNamedSession(sessionName);
-
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't find session.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-		thisPtr->TriggerOnJoinSessionCompleteDelegates(sessionName, EOnJoinSessionCompleteResult::UnknownError);
 		return;
 	}
 
-	FNamedOnlineSession* session = thisPtr->GetNamedSession(sessionName);
-	if (!session)
+	FOnlineSessionEpic* thisPtr = context->OnlineSessionPtr;
+	uint64 searchId = context->SearchId;
+
+	// Searches that timed out or were cancelled already completed locally. Their handle was left for this callback to release
+	FSessionSearchEntryEpic* currentSearch = thisPtr->SessionSearches.Find(searchId);
+	if (!currentSearch || currentSearch->SearchHandle != context->SearchHandle)
 	{
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("Tried joining session \"%s\", but session wasn't found."), *sessionName.ToString());
-		thisPtr->TriggerOnJoinSessionCompleteDelegates(sessionName, EOnJoinSessionCompleteResult::SessionDoesNotExist);
+		UE_LOG_ONLINE_SESSION(Verbose, TEXT("Ignoring result of cancelled or timed out session search with id %llu"), searchId);
+		EOS_SessionSearch_Release(context->SearchHandle);
 		return;
 	}
+	currentSearch->bFindPending = false;
 
-	thisPtr->TriggerOnJoinSessionCompleteDelegates(sessionName, EOnJoinSessionCompleteResult::Success);
-}
-
-void FOnlineSessionEpic::OnEOSFindFriendSessionComplete(const EOS_SessionSearch_FindCallbackInfo* Data)
-{
-	FFindFriendSessionAdditionalData* additionalData = (FFindFriendSessionAdditionalData*)Data->ClientData;
-	checkf(additionalData, TEXT("%s called, but no ClientData recieved."), *FString(__FUNCTION__));
-
-	FOnlineSessionEpic* thisPtr = additionalData->OnlineSessionPtr;
-	checkf(thisPtr, TEXT("%s called, but \"this\" missing from ClientData"), *FString(__FUNCTION__));
-
-	double searchCreationTime = additionalData->SearchCreationTime;
-
-	FUniqueNetId const& searchingUserId = additionalData->SearchingUserId;
-
-	// Free the previously allocated memory
-	delete(additionalData);
-
-	FString error;
-	TArray<FOnlineSessionSearchResult> searchResults;
-
-	EOS_EResult eosResult = Data->ResultCode;
-	if (eosResult == EOS_EResult::EOS_Success)
-	{
-		// Retrieve the EOS session search handle and the local session search, into which we're going to write the results.
-		EOS_HSessionSearch sessionSearchHandle = thisPtr->SessionSearches.Find(searchCreationTime)->Key;
-		checkf(sessionSearchHandle, TEXT("%s called, but the EOS session search handle is invalid"), *FString(__FUNCTION__));
-
-		TSharedRef<FOnlineSessionSearch> localSessionSearch = thisPtr->SessionSearches.Find(searchCreationTime)->Value;
-
-		// Get how many results we got
-		EOS_SessionSearch_GetSearchResultCountOptions searchResultCountOptions = {
-			EOS_SESSIONSEARCH_GETSEARCHRESULTCOUNT_API_LATEST
-		};
-		uint32 resultCount = EOS_SessionSearch_GetSearchResultCount(sessionSearchHandle, &searchResultCountOptions);
-		if (resultCount > 0)
-		{
-			for (uint32 i = 0; i < resultCount; ++i)
-			{
-				EOS_SessionSearch_CopySearchResultByIndexOptions copySearchResultsByIndex = {
-					EOS_SESSIONSEARCH_COPYSEARCHRESULTBYINDEX_API_LATEST,
-					i
-				};
-				EOS_HSessionDetails sessionDetailsHandle;
-				eosResult = EOS_SessionSearch_CopySearchResultByIndex(sessionSearchHandle, &copySearchResultsByIndex, &sessionDetailsHandle);
-				if (eosResult == EOS_EResult::EOS_Success)
-				{
-					// Allocate space for the session infos
-					EOS_SessionDetails_Info* eosSessionInfo = (EOS_SessionDetails_Info*)malloc(sizeof(EOS_SessionDetails_Info));
-
-					// Copy the session details
-					EOS_SessionDetails_CopyInfoOptions copyInfoOptions = {
-						EOS_SESSIONDETAILS_COPYINFO_API_LATEST
-					};
-					eosResult = EOS_SessionDetails_CopyInfo(sessionDetailsHandle, &copyInfoOptions, &eosSessionInfo);
-					if (eosResult == EOS_EResult::EOS_Success)
-					{
-						// Create a new search result.
-						// Ping is set to -1, as we have no way of retrieving it for now
-						FOnlineSessionSearchResult searchResult;
-						searchResult.PingInMs = -1;
-
-						// Take the session from the search results and update its details
-						thisPtr->SetSessionDetails(&searchResult.Session, eosSessionInfo);
-
-						// Add the session to the list of search results.
-						searchResults.Add(searchResult);
-					}
-					else
-					{
-						error = FString::Printf(TEXT("[EOS SDK] Couldn't copy session info.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-					}
-
-					// Release the prevously allocated memory for the session info;
-					EOS_SessionDetails_Info_Release(eosSessionInfo);
-				}
-				else
-				{
-					error = FString::Printf(TEXT("[EOS SDK] Couldn't get session details handle.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-				}
-			}
+	EOS_HSessionSearch searchHandle = currentSearch->SearchHandle;
 
-			localSessionSearch->SearchResults = searchResults;
-		}
-		else
-		{
-			UE_LOG_ONLINE_SESSION(Display, TEXT("No friend sessions found.\r\n    LocalPlayerId: %s"), *searchingUserId.ToString());
-		}
-	}
-	else
+	if (Data->ResultCode != EOS_EResult::EOS_Success)
 	{
-		error = FString::Printf(TEXT("[EOS SDK] Couldn't find session.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Error in %s\r\n    Message: [EOS SDK] Couldn't find session. Error: %s"), *FString(__FUNCTION__), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
+		thisPtr->FinishSessionSearch(searchId, false);
+		return;
 	}
 
-	// Report an error if there was any
-	UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("%s"), *error);
-
-	// Get the local index of the user that started the search
-	IOnlineIdentityPtr identityPtr = thisPtr->Subsystem->GetIdentityInterface();
-	FPlatformUserId userIdx = identityPtr->GetPlatformUserIdFromUniqueNetId(searchingUserId);
-
-	// Trigger delegates
-	thisPtr->TriggerOnFindFriendSessionCompleteDelegates(userIdx, error.IsEmpty(), searchResults);
-}
-
-void FOnlineSessionEpic::OnEOSSendSessionInviteToFriendsComplete(const EOS_Sessions_SendInviteCallbackInfo* Data)
-{
-	FOnlineSessionEpic* thisPtr = (FOnlineSessionEpic*)Data->ClientData;
-	check(thisPtr);
+	// Get how many results we got
+	EOS_SessionSearch_GetSearchResultCountOptions searchResultCountOptions = {
+		EOS_SESSIONSEARCH_GETSEARCHRESULTCOUNT_API_LATEST
+	};
+	currentSearch->NumResults = EOS_SessionSearch_GetSearchResultCount(searchHandle, &searchResultCountOptions);
+	currentSearch->NextResultIndex = 0;
+	UE_CLOG_ONLINE_SESSION(currentSearch->NumResults == 0, Display, TEXT("No sessions found"));
 
-	if (Data->ResultCode != EOS_EResult::EOS_Success)
-	{
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Session invite(s) couldn't be sent to remote.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-	}
-	else
+	// When streaming, the results are converted in batches during Tick.
+	// Otherwise convert everything right away.
+	if (thisPtr->SearchResultsPerTick <= 0)
 	{
-		UE_LOG_ONLINE_SESSION(Display, TEXT("[EOS SDK] Session invite(s) sent to remote."));
+		thisPtr->ConvertSearchResults(searchId, MAX_int32);
+		thisPtr->FinishSessionSearch(searchId, true);
 	}
 }
 
-void FOnlineSessionEpic::OnEOSRegisterPlayersComplete(const EOS_Sessions_RegisterPlayersCallbackInfo* Data)
+void FOnlineSessionEpic::OnEOSJoinSessionComplete(const EOS_Sessions_JoinSessionCallbackInfo* Data)
 {
-	FRegisterPlayersAdditionalData* additionalData = (FRegisterPlayersAdditionalData*)Data->ClientData;
-	checkf(additionalData, TEXT("OnEOSJoinSessionComplete delegate called, but no client data available"));
+	TOptional<FJoinSessionAdditionalData> additionalData = JoinSessionContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
 
 	FOnlineSessionEpic* thisPtr = additionalData->OnlineSessionPtr;
 	checkf(thisPtr, TEXT("OnEOSJoinSessionComplete: additional data \"this\" missing"));
 
 	FName sessionName = additionalData->SessionName;
 
-	TArray<TSharedRef<const FUniqueNetId>> const registeredPlayers = additionalData->RegisteredPlayers;
+	if (Data->ResultCode != EOS_EResult::EOS_Success)
+	{
+		thisPtr->RemoveNamedSession(sessionName);
 
-	delete(additionalData);
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't find session.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
+		thisPtr->CompleteJoinSession(sessionName, EOnJoinSessionCompleteResult::UnknownError, additionalData->bForMatchmaking);
+		return;
+	}
 
 	FNamedOnlineSession* session = thisPtr->GetNamedSession(sessionName);
 	if (!session)
 	{
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("RegisterPlayers callback called, but session not found.\r\n    %s"), *sessionName.ToString());
-		thisPtr->TriggerOnRegisterPlayersCompleteDelegates(sessionName, TArray<TSharedRef<const FUniqueNetId>>(), false);
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Tried joining session \"%s\", but session wasn't found."), *sessionName.ToString());
+		thisPtr->CompleteJoinSession(sessionName, EOnJoinSessionCompleteResult::SessionDoesNotExist, additionalData->bForMatchmaking);
 		return;
 	}
 
-	if (Data->ResultCode != EOS_EResult::EOS_Success)
+	thisPtr->CompleteJoinSession(sessionName, EOnJoinSessionCompleteResult::Success, additionalData->bForMatchmaking);
+}
+
+void FOnlineSessionEpic::OnEOSSessionLookupComplete(const EOS_SessionSearch_FindCallbackInfo* Data)
+{
+	TOptional<FSessionLookupAdditionalData> additionalData = SessionLookupContexts.Remove(Data->ClientData);
+	if (!additionalData)
 	{
-		for (int32 i = 0; i < registeredPlayers.Num(); ++i)
-		{
-			session->RegisteredPlayers.RemoveAtSwap(i);
+		return;
+	}
 
-			// update number of open connections
-			if (session->NumOpenPublicConnections < session->SessionSettings.NumPublicConnections)
+	FOnlineSessionEpic* thisPtr = additionalData->OnlineSessionPtr;
+	EOS_HSessionSearch sessionSearchHandle = additionalData->SearchHandle;
+	FOnSessionSearchCompleteEpic onComplete = MoveTemp(additionalData->OnComplete);
+
+	bool bFound = false;
+	if (Data->ResultCode == EOS_EResult::EOS_Success)
+	{
+		EOS_SessionSearch_CopySearchResultByIndexOptions copySearchResultsByIndex = {
+			EOS_SESSIONSEARCH_COPYSEARCHRESULTBYINDEX_API_LATEST,
+			0
+		};
+		EOS_HSessionDetails sessionDetailsHandle = nullptr;
+		if (EOS_SessionSearch_CopySearchResultByIndex(sessionSearchHandle, &copySearchResultsByIndex, &sessionDetailsHandle) == EOS_EResult::EOS_Success)
+		{
+			EOS_SessionDetails_Info* eosSessionInfo = nullptr;
+			EOS_SessionDetails_CopyInfoOptions copyInfoOptions = {
+				EOS_SESSIONDETAILS_COPYINFO_API_LATEST
+			};
+			if (EOS_SessionDetails_CopyInfo(sessionDetailsHandle, &copyInfoOptions, &eosSessionInfo) == EOS_EResult::EOS_Success)
 			{
-				session->NumOpenPublicConnections += 1;
+				thisPtr->CacheSessionDetails(sessionDetailsHandle, eosSessionInfo);
+				EOS_SessionDetails_Info_Release(eosSessionInfo);
+				bFound = true;
 			}
-			else if (session->NumOpenPrivateConnections < session->SessionSettings.NumPrivateConnections)
+			else
 			{
-				session->NumOpenPrivateConnections += 1;
+				EOS_SessionDetails_Release(sessionDetailsHandle);
 			}
 		}
-
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't find session.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-		thisPtr->TriggerOnRegisterPlayersCompleteDelegates(sessionName, TArray<TSharedRef<const FUniqueNetId>>(), false);
-		return;
+	}
+	else
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't look up session.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
 	}
 
-	thisPtr->TriggerOnRegisterPlayersCompleteDelegates(sessionName, registeredPlayers, true);
+	EOS_SessionSearch_Release(sessionSearchHandle);
+	onComplete(bFound);
 }
 
-void FOnlineSessionEpic::OnEOSUnRegisterPlayersComplete(const EOS_Sessions_UnregisterPlayersCallbackInfo* Data)
+void FOnlineSessionEpic::OnEOSSendSessionInviteToFriendsComplete(const EOS_Sessions_SendInviteCallbackInfo* Data)
 {
-	FRegisterPlayersAdditionalData* additionalData = (FRegisterPlayersAdditionalData*)Data->ClientData;
-	checkf(additionalData, TEXT("OnEOSJoinSessionComplete delegate called, but no client data available"));
-
-	FOnlineSessionEpic* thisPtr = additionalData->OnlineSessionPtr;
-	checkf(thisPtr, TEXT("OnEOSJoinSessionComplete: additional data \"this\" missing"));
-
-	FName sessionName = additionalData->SessionName;
-
-	TArray<TSharedRef<const FUniqueNetId>> const players = additionalData->RegisteredPlayers;
-
-	delete(additionalData);
-
-	FNamedOnlineSession* session = thisPtr->GetNamedSession(sessionName);
-	if (!session)
+	TOptional<FSendInviteAdditionalData> additionalData = SendInviteContexts.Remove(Data->ClientData);
+	if (!additionalData)
 	{
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("RegisterPlayers callback called, but session not found.\r\n    %s"), *sessionName.ToString());
-		thisPtr->TriggerOnRegisterPlayersCompleteDelegates(sessionName, TArray<TSharedRef<const FUniqueNetId>>(), false);
 		return;
 	}
 
 	if (Data->ResultCode != EOS_EResult::EOS_Success)
 	{
-		for (int32 i = 0; i < players.Num(); ++i)
-		{
-			session->RegisteredPlayers.Add(players[i]);
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Session invite(s) couldn't be sent to remote.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
+	}
+	else
+	{
+		UE_LOG_ONLINE_SESSION(Display, TEXT("[EOS SDK] Session invite(s) sent to remote."));
+	}
+}
 
-			// update number of open connections
-			if (session->NumOpenPublicConnections > 0)
-			{
-				session->NumOpenPublicConnections -= 1;
-			}
-			else if (session->NumOpenPrivateConnections > 0)
-			{
-				session->NumOpenPrivateConnections -= 1;
-			}
-		}
+void FOnlineSessionEpic::OnEOSRegisterPlayersComplete(const EOS_Sessions_RegisterPlayersCallbackInfo* Data)
+{
+	TOptional<FRosterCallAdditionalData> additionalData = RosterCallContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
 
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Couldn't find session.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(Data->ResultCode)));
-		thisPtr->TriggerOnUnregisterPlayersCompleteDelegates(sessionName, TArray<TSharedRef<const FUniqueNetId>>(), false);
+	FOnlineSessionEpic* thisPtr = additionalData->OnlineSessionPtr;
+	checkf(thisPtr, TEXT("OnEOSRegisterPlayersComplete: additional data \"this\" missing"));
+
+	thisPtr->OnRosterCallComplete(additionalData->SessionName, additionalData->Players, additionalData->Batch, true, Data->ResultCode);
+}
+
+void FOnlineSessionEpic::OnEOSUnRegisterPlayersComplete(const EOS_Sessions_UnregisterPlayersCallbackInfo* Data)
+{
+	TOptional<FRosterCallAdditionalData> additionalData = RosterCallContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
 		return;
 	}
 
-	thisPtr->TriggerOnUnregisterPlayersCompleteDelegates(sessionName, players, true);
+	FOnlineSessionEpic* thisPtr = additionalData->OnlineSessionPtr;
+	checkf(thisPtr, TEXT("OnEOSUnRegisterPlayersComplete: additional data \"this\" missing"));
+
+	thisPtr->OnRosterCallComplete(additionalData->SessionName, additionalData->Players, additionalData->Batch, false, Data->ResultCode);
 }
 
 void FOnlineSessionEpic::OnEOSSessionInviteReceived(const EOS_Sessions_SessionInviteReceivedCallbackInfo* Data)
@@ -1258,48 +2982,11 @@ void FOnlineSessionEpic::OnEOSSessionInviteReceived(const EOS_Sessions_SessionIn
 	// User that sent the invite
 	TSharedRef<FUniqueNetId const> fromUserId = MakeShared<FUniqueNetIdEpic>(FUniqueNetIdEpic::ProductUserIDFromString(UTF8_TO_TCHAR(Data->TargetUserId)));
 
-	EOS_Sessions_CopySessionHandleByInviteIdOptions copySessionHandleByInviteIdOptions = {
-		EOS_SESSIONS_COPYSESSIONHANDLEBYINVITEID_API_LATEST,
-		Data->InviteId
-	};
-
-	EOS_HSessionDetails sessionDetailsHandle = {};
-	EOS_EResult eosResult = EOS_Sessions_CopySessionHandleByInviteId(thisPtr->sessionsHandle, &copySessionHandleByInviteIdOptions, &sessionDetailsHandle);
-	if (eosResult == EOS_EResult::EOS_Success)
-	{
-		// Allocate space for the session infos
-		EOS_SessionDetails_Info* eosSessionInfo = (EOS_SessionDetails_Info*)malloc(sizeof(EOS_SessionDetails_Info));
-
-		// Copy the session details
-		EOS_SessionDetails_CopyInfoOptions copyInfoOptions = {
-			EOS_SESSIONDETAILS_COPYINFO_API_LATEST
-		};
-		eosResult = EOS_SessionDetails_CopyInfo(sessionDetailsHandle, &copyInfoOptions, &eosSessionInfo);
-		if (eosResult == EOS_EResult::EOS_Success)
-		{
-			// Create a new search result.
-			// Ping is set to -1, as we have no way of retrieving it for now
-			FOnlineSessionSearchResult searchResult;
-			searchResult.PingInMs = -1;
-
-			// Take the session from the search results and update its details
-			thisPtr->SetSessionDetails(&searchResult.Session, eosSessionInfo);
-
-			thisPtr->TriggerOnSessionInviteReceivedDelegates(*localUserId, *fromUserId, FString(), searchResult);
-		}
-		else
-		{
-			UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Error copying session details"));
-		}
-
-		EOS_SessionDetails_Info_Release(eosSessionInfo);
-	}
-	else
+	FOnlineSessionSearchResult searchResult;
+	if (thisPtr->CacheInviteSession(Data->InviteId, false, searchResult))
 	{
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Error copying session handle by invite.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		thisPtr->TriggerOnSessionInviteReceivedDelegates(*localUserId, *fromUserId, FString(), searchResult);
 	}
-
-	EOS_SessionDetails_Release(sessionDetailsHandle);
 }
 
 void FOnlineSessionEpic::OnEOSSessionInviteAccepted(const EOS_Sessions_SessionInviteAcceptedCallbackInfo* Data)
@@ -1310,58 +2997,21 @@ void FOnlineSessionEpic::OnEOSSessionInviteAccepted(const EOS_Sessions_SessionIn
 	// User that received the invite
 	TSharedRef<FUniqueNetId const> localUserId = MakeShared<FUniqueNetIdEpic>(FUniqueNetIdEpic::ProductUserIDFromString(UTF8_TO_TCHAR(Data->LocalUserId)));
 
-	// User that sent the invite
-	TSharedRef<FUniqueNetId const> fromUserId = MakeShared<FUniqueNetIdEpic>(FUniqueNetIdEpic::ProductUserIDFromString(UTF8_TO_TCHAR(Data->TargetUserId)));
-
-
-	EOS_HSessionDetails sessionDetailsHandle = {};
-	EOS_Sessions_CopySessionHandleByInviteIdOptions copySessionHandleByInviteIdOptions = {
-		EOS_SESSIONS_COPYSESSIONHANDLEBYINVITEID_API_LATEST,
-		Data->InviteId
-	};
-	EOS_EResult eosResult = EOS_Sessions_CopySessionHandleByInviteId(thisPtr->sessionsHandle, &copySessionHandleByInviteIdOptions, &sessionDetailsHandle);
-	if (eosResult == EOS_EResult::EOS_Success)
+	// The handle is pinned, so JoinSession joins with it directly, even if searches filled the cache in the meantime
+	FOnlineSessionSearchResult searchResult;
+	if (thisPtr->CacheInviteSession(Data->InviteId, true, searchResult))
 	{
-		// Allocate space for the session infos
-		EOS_SessionDetails_Info* eosSessionInfo = (EOS_SessionDetails_Info*)malloc(sizeof(EOS_SessionDetails_Info));
-
-		// Copy the session details
-		EOS_SessionDetails_CopyInfoOptions copyInfoOptions = {
-			EOS_SESSIONDETAILS_COPYINFO_API_LATEST
-		};
-		eosResult = EOS_SessionDetails_CopyInfo(sessionDetailsHandle, &copyInfoOptions, &eosSessionInfo);
-		if (eosResult == EOS_EResult::EOS_Success)
-		{
-			// Create a new search result.
-			// Ping is set to -1, as we have no way of retrieving it for now
-			FOnlineSessionSearchResult searchResult;
-			searchResult.PingInMs = -1;
-
-			// Take the session from the search results and update its details
-			thisPtr->SetSessionDetails(&searchResult.Session, eosSessionInfo);
-
-			// Get the controller index for this given user
-			IOnlineIdentityPtr identityPtr = thisPtr->Subsystem->GetIdentityInterface();
-			FPlatformUserId userIdx = identityPtr->GetPlatformUserIdFromUniqueNetId(*localUserId);
-
-			thisPtr->TriggerOnSessionUserInviteAcceptedDelegates(true, userIdx, localUserId, searchResult);
-		}
-		else
-		{
-			UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Error copying session details"));
-		}
+		// Get the controller index for this given user
+		IOnlineIdentityPtr identityPtr = thisPtr->Subsystem->GetIdentityInterface();
+		FPlatformUserId userIdx = identityPtr->GetPlatformUserIdFromUniqueNetId(*localUserId);
 
-		EOS_SessionDetails_Info_Release(eosSessionInfo);
+		thisPtr->TriggerOnSessionUserInviteAcceptedDelegates(true, userIdx, localUserId, searchResult);
 	}
 	else
 	{
-		UE_LOG_ONLINE_SESSION(Warning, TEXT("[EOS SDK] Error copying session handle by invite.\r\n    Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+		// ToDo: Get the actual controller number
+		thisPtr->TriggerOnSessionUserInviteAcceptedDelegates(false, 0, localUserId, FOnlineSessionSearchResult());
 	}
-
-	EOS_SessionDetails_Release(sessionDetailsHandle);
-
-	// ToDo: Get the actual controller number
-	thisPtr->TriggerOnSessionUserInviteAcceptedDelegates(false, 0, localUserId, FOnlineSessionSearchResult());
 }
 
 
@@ -1371,6 +3021,26 @@ void FOnlineSessionEpic::OnEOSSessionInviteAccepted(const EOS_Sessions_SessionIn
 
 FOnlineSessionEpic::FOnlineSessionEpic(FOnlineSubsystemEpic* InSubsystem)
 	: Subsystem(InSubsystem)
+	, SessionUpdateInterval(0.0)
+	, SessionSlotUpdateInterval(1.0)
+	, NextSessionSearchId(1)
+	, SearchCacheTTL(0.0)
+	, SearchResultsPerTick(0)
+	, SearchRetention(60.0)
+	, SessionDetailsCacheSize(64)
+	, NextBucketSearchId(1)
+	, NextFriendSessionSearchId(1)
+	, FriendSessionSearchWindow(16)
+	, FriendSessionSearchMaxResults(8)
+	, NextMatchmakingTicketId(1)
+	, MatchmakingPasses(3)
+	, MatchmakingTimeout(10.0)
+	, PingPort(7787)
+	, bPingSearchResults(false)
+	, bBatchRosterUpdates(false)
+	, SlotReservationTimeout(30.0)
+	, bCompactSessionFlags(false)
+	, NextPreparedSearchId(1)
 {
 	// Get the sessions handle
 	EOS_HPlatform hPlatform = this->Subsystem->PlatformHandle;
@@ -1379,6 +3049,67 @@ FOnlineSessionEpic::FOnlineSessionEpic(FOnlineSubsystemEpic* InSubsystem)
 	check(hSessions);
 	this->sessionsHandle = hSessions;
 
+	// Session updates are rate limited per session. Changes to the slots go out sooner than cosmetic ones
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("SessionUpdateInterval"), this->SessionUpdateInterval, GEngineIni);
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("SessionSlotUpdateInterval"), this->SessionSlotUpdateInterval, GEngineIni);
+	this->SessionSlotUpdateInterval = FMath::Min(this->SessionSlotUpdateInterval, this->SessionUpdateInterval);
+
+	// Searches within this time frame with the same query are answered from the cache
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("SessionSearchCacheTTL"), this->SearchCacheTTL, GEngineIni);
+
+	// When set, search results are converted in batches of this size per tick
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("SessionSearchResultsPerTick"), this->SearchResultsPerTick, GEngineIni);
+
+	// Completed searches stay joinable while the game holds on to them, and for this long after it let go
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("SessionSearchRetention"), this->SearchRetention, GEngineIni);
+
+	// Session details of recently seen sessions are kept for lookups by id and joins
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("SessionDetailsCacheSize"), this->SessionDetailsCacheSize, GEngineIni);
+	this->SessionDetailsCacheSize = FMath::Max(1, this->SessionDetailsCacheSize);
+
+	// Parsed host addresses and session infos of this many sessions are shared between search results
+	int32 sessionInfoCacheSize = 256;
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("SessionInfoCacheSize"), sessionInfoCacheSize, GEngineIni);
+	this->HostAddressCache.Empty(FMath::Max(1, sessionInfoCacheSize));
+	this->SessionInfoCache.Empty(FMath::Max(1, sessionInfoCacheSize));
+
+	// FindFriendSession searches this many friends at the same time
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("FriendSessionSearchWindow"), this->FriendSessionSearchWindow, GEngineIni);
+	this->FriendSessionSearchWindow = FMath::Max(1, this->FriendSessionSearchWindow);
+
+	// FindFriendSession finds at most this many sessions per friend
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("FriendSessionSearchMaxResults"), this->FriendSessionSearchMaxResults, GEngineIni);
+	this->FriendSessionSearchMaxResults = FMath::Max(1, this->FriendSessionSearchMaxResults);
+
+	// Matchmaking runs this many searches in parallel and settles for the best candidate after the timeout
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("MatchmakingPasses"), this->MatchmakingPasses, GEngineIni);
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("MatchmakingTimeout"), this->MatchmakingTimeout, GEngineIni);
+	this->MatchmakingPasses = FMath::Max(1, this->MatchmakingPasses);
+
+	// Session pings. Hosts answer on their own port, which needs to be the same for hosts and clients
+	GConfig->GetInt(TEXT("OnlineSubsystemEpic"), TEXT("PingPort"), this->PingPort, GEngineIni);
+	GConfig->GetBool(TEXT("OnlineSubsystemEpic"), TEXT("PingSearchResults"), this->bPingSearchResults, GEngineIni);
+
+	// When set, roster changes are sent once per tick and session
+	GConfig->GetBool(TEXT("OnlineSubsystemEpic"), TEXT("BatchRosterUpdates"), this->bBatchRosterUpdates, GEngineIni);
+
+	// Time after which slots reserved for joining players are released, if the players weren't registered
+	GConfig->GetDouble(TEXT("OnlineSubsystemEpic"), TEXT("SlotReservationTimeout"), this->SlotReservationTimeout, GEngineIni);
+
+	// Packs the boolean session settings into one attribute. Hosts and clients need the same value
+	GConfig->GetBool(TEXT("OnlineSubsystemEpic"), TEXT("CompactSessionFlags"), this->bCompactSessionFlags, GEngineIni);
+
+	bool enablePingResponder = false;
+	GConfig->GetBool(TEXT("OnlineSubsystemEpic"), TEXT("EnablePingResponder"), enablePingResponder, GEngineIni);
+	if (enablePingResponder)
+	{
+		this->PingResponder = MakeUnique<FOnlineSessionPingResponderEpic>();
+		if (!this->PingResponder->Init(this->PingPort))
+		{
+			this->PingResponder.Reset();
+		}
+	}
+
 	// Register the callback for a session invite received
 	EOS_Sessions_AddNotifySessionInviteReceivedOptions notifySessionInviteReceivedOptions = {
 		EOS_SESSIONS_ADDNOTIFYSESSIONINVITERECEIVED_API_LATEST
@@ -1396,54 +3127,84 @@ FOnlineSessionEpic::~FOnlineSessionEpic()
 {
 	EOS_Sessions_RemoveNotifySessionInviteReceived(this->sessionsHandle, this->sessionInviteRecivedCallbackHandle);
 	EOS_Sessions_RemoveNotifySessionInviteAccepted(this->sessionsHandle, this->sessionInviteAcceptedCallbackHandle);
+
+	// Release the handles of all searches that are still running.
+	// Handles of pending finds are released with their contexts below
+	for (auto& search : this->SessionSearches)
+	{
+		ReleaseSearchHandle(search.Value);
+	}
+	this->SessionSearches.Empty();
+	this->SearchResultsBySessionId.Empty();
+
+	for (auto const& cachedDetails : this->SessionDetailsCache)
+	{
+		EOS_SessionDetails_Release(cachedDetails.Value.DetailsHandle);
+	}
+	this->SessionDetailsCache.Empty();
+
+	// Calls still running can't reach this instance anymore
+	FOperationContextPoolEpic::ReleaseAll(this);
 }
 
-FNamedOnlineSession* FOnlineSessionEpic::GetNamedSession(FName SessionName)
+FNamedOnlineSession* FOnlineSessionEpic::AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings)
 {
-	FScopeLock ScopeLock(&SessionLock);
-	for (int32 SearchIndex = 0; SearchIndex < Sessions.Num(); SearchIndex++)
+	FWriteScopeLock ScopeLock(SessionLock);
+	if (Sessions.Contains(SessionName))
 	{
-		if (Sessions[SearchIndex].SessionName == SessionName)
-		{
-			return &Sessions[SearchIndex];
-		}
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Can't add session \"%s\", a session with that name already exists."), *SessionName.ToString());
+		return nullptr;
 	}
-	return nullptr;
+	return Sessions.Add(SessionName, MakeUnique<FNamedOnlineSession>(SessionName, SessionSettings)).Get();
 }
 
-void FOnlineSessionEpic::RemoveNamedSession(FName SessionName)
+FNamedOnlineSession* FOnlineSessionEpic::AddNamedSession(FName SessionName, const FOnlineSession& Session)
 {
-	FScopeLock ScopeLock(&SessionLock);
-	for (int32 SearchIndex = 0; SearchIndex < Sessions.Num(); SearchIndex++)
+	FWriteScopeLock ScopeLock(SessionLock);
+	if (Sessions.Contains(SessionName))
 	{
-		if (Sessions[SearchIndex].SessionName == SessionName)
-		{
-			Sessions.RemoveAtSwap(SearchIndex);
-			return;
-		}
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Can't add session \"%s\", a session with that name already exists."), *SessionName.ToString());
+		return nullptr;
 	}
+	return Sessions.Add(SessionName, MakeUnique<FNamedOnlineSession>(SessionName, Session)).Get();
 }
 
-EOnlineSessionState::Type FOnlineSessionEpic::GetSessionState(FName SessionName) const
+FNamedOnlineSession* FOnlineSessionEpic::GetNamedSession(FName SessionName)
+{
+	FReadScopeLock ScopeLock(SessionLock);
+	TUniquePtr<FNamedOnlineSession> const* session = Sessions.Find(SessionName);
+	return session ? session->Get() : nullptr;
+}
+
+void FOnlineSessionEpic::RemoveNamedSession(FName SessionName)
 {
-	FScopeLock ScopeLock(&SessionLock);
-	for (int32 SearchIndex = 0; SearchIndex < Sessions.Num(); SearchIndex++)
+	FWriteScopeLock ScopeLock(SessionLock);
+	PushedSessionSettings.Remove(SessionName);
+	Sessions.Remove(SessionName);
+
+	TMap<FString, FSlotReservationEpic> reservations;
+	if (SlotReservations.RemoveAndCopyValue(SessionName, reservations))
 	{
-		if (Sessions[SearchIndex].SessionName == SessionName)
+		for (TPair<FString, FSlotReservationEpic> const& reservation : reservations)
 		{
-			return Sessions[SearchIndex].SessionState;
+			SearchTimers.Cancel(reservation.Value.ExpiryTimer);
 		}
 	}
+}
 
-	return EOnlineSessionState::NoSession;
+EOnlineSessionState::Type FOnlineSessionEpic::GetSessionState(FName SessionName) const
+{
+	FReadScopeLock ScopeLock(SessionLock);
+	TUniquePtr<FNamedOnlineSession> const* session = Sessions.Find(SessionName);
+	return session ? (*session)->SessionState : EOnlineSessionState::NoSession;
 }
 
 bool FOnlineSessionEpic::HasPresenceSession()
 {
-	FScopeLock ScopeLock(&SessionLock);
-	for (int32 SearchIndex = 0; SearchIndex < Sessions.Num(); SearchIndex++)
+	FReadScopeLock ScopeLock(SessionLock);
+	for (auto const& session : Sessions)
 	{
-		if (Sessions[SearchIndex].SessionSettings.bUsesPresence)
+		if (session.Value->SessionSettings.bUsesPresence)
 		{
 			return true;
 		}
@@ -1454,7 +3215,97 @@ bool FOnlineSessionEpic::HasPresenceSession()
 
 void FOnlineSessionEpic::Tick(float DeltaTime)
 {
-	// ToDo: Iterate through all session searches and cancel them if timeout has been reached
+	// Time out running searches and drop completed searches nobody uses anymore
+	this->SearchTimers.Tick(DeltaTime);
+
+	// Convert the results of streaming searches, limited to a fixed number of results per tick
+	if (this->SearchResultsPerTick > 0)
+	{
+		TArray<uint64> streamingSearches;
+		for (auto const& search : this->SessionSearches)
+		{
+			if (search.Value.SearchHandle && search.Value.NumResults != INDEX_NONE)
+			{
+				streamingSearches.Add(search.Key);
+			}
+		}
+
+		int32 budget = this->SearchResultsPerTick;
+		for (uint64 searchId : streamingSearches)
+		{
+			if (budget <= 0)
+			{
+				break;
+			}
+
+			budget -= this->ConvertSearchResults(searchId, budget);
+
+			FSessionSearchEntryEpic const* search = this->SessionSearches.Find(searchId);
+			if (search && search->NextResultIndex >= search->NumResults)
+			{
+				this->FinishSessionSearch(searchId, true);
+			}
+		}
+	}
+
+	// Push session updates whose interval passed. There's only ever one update in flight per session
+	if (this->SessionAdvertisements.Num() > 0)
+	{
+		double const now = FPlatformTime::Seconds();
+		TArray<FName> dueSessions;
+		for (auto const& advertisement : this->SessionAdvertisements)
+		{
+			double const interval = advertisement.Value.bSlotsDirty ? this->SessionSlotUpdateInterval : this->SessionUpdateInterval;
+			if (advertisement.Value.bDirty && !advertisement.Value.bInFlight && now - advertisement.Value.LastPushTime >= interval)
+			{
+				dueSessions.Add(advertisement.Key);
+			}
+		}
+		for (FName const& sessionName : dueSessions)
+		{
+			this->PushSessionUpdate(sessionName);
+		}
+	}
+
+	// Send the roster changes collected during the last tick
+	if (this->PendingRosterUpdates.Num() > 0)
+	{
+		TArray<FName> sessionNames;
+		this->PendingRosterUpdates.GetKeys(sessionNames);
+		for (FName const& sessionName : sessionNames)
+		{
+			this->FlushRosterUpdates(sessionName);
+		}
+	}
+
+	// Service session pings
+	if (this->PingClient)
+	{
+		this->PingClient->Tick();
+	}
+	if (this->PingResponder)
+	{
+		this->PingResponder->Tick();
+	}
+
+	// Matchmaking requests continue once the pings of their candidates landed
+	if (this->MatchmakingTickets.Num() > 0)
+	{
+		this->TickMatchmakingPingWaits();
+	}
+
+	// Drop cached search results that outlived their TTL
+	if (this->SearchResultCache.Num() > 0)
+	{
+		double const now = FPlatformTime::Seconds();
+		for (auto it = this->SearchResultCache.CreateIterator(); it; ++it)
+		{
+			if (now - it->Value.CompletionTime > this->SearchCacheTTL)
+			{
+				it.RemoveCurrent();
+			}
+		}
+	}
 }
 
 TSharedPtr<const FUniqueNetId> FOnlineSessionEpic::CreateSessionIdFromString(const FString& SessionIdStr)
@@ -1472,6 +3323,21 @@ bool FOnlineSessionEpic::CreateSession(int32 HostingPlayerNum, FName SessionName
 	return this->CreateSession(*netId, SessionName, NewSessionSettings);
 }
 bool FOnlineSessionEpic::CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	// While the host's tokens are refreshed, the session is created once the refresh completed
+	bool const bDeferred = this->Subsystem->IdentityInterface->DeferWhileRefreshingToken(HostingPlayerId, [this, SessionName, NewSessionSettings](FUniqueNetId const& RefreshedPlayerId)
+	{
+		this->CreateSession(RefreshedPlayerId, SessionName, NewSessionSettings);
+	});
+	if (bDeferred)
+	{
+		return true;
+	}
+
+	return this->StartCreateSession(HostingPlayerId, SessionName, NewSessionSettings, false);
+}
+
+bool FOnlineSessionEpic::StartCreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, bool bForMatchmaking)
 {
 	FString err;
 	uint32 result = ONLINE_FAIL;
@@ -1535,7 +3401,7 @@ bool FOnlineSessionEpic::CreateSession(const FUniqueNetId& HostingPlayerId, FNam
 			EOS_EResult eosResult = EOS_Sessions_CreateSessionModification(this->sessionsHandle, &createSessionOptions, &modificationHandle);
 			if (eosResult == EOS_EResult::EOS_Success)
 			{
-				this->CreateSessionModificationHandle(NewSessionSettings, modificationHandle, err);
+				this->CreateSessionModificationHandle(session->SessionSettings, nullptr, modificationHandle, err);
 				if (err.IsEmpty())
 				{
 					// Update the remote session
@@ -1543,11 +3409,13 @@ bool FOnlineSessionEpic::CreateSession(const FUniqueNetId& HostingPlayerId, FNam
 						EOS_SESSIONS_UPDATESESSION_API_LATEST,
 						modificationHandle
 					};
-					FCreateSessionAdditionalData* addionalData = new FCreateSessionAdditionalData {
+					void* clientData = CreateSessionContexts.Add(this, FCreateSessionAdditionalData{
 						this,
-						HostingPlayerId.AsShared()
-					};
-					EOS_Sessions_UpdateSession(this->sessionsHandle, &updateSessionOptions, addionalData, &FOnlineSessionEpic::OnEOSCreateSessionComplete);
+						HostingPlayerId.AsShared(),
+						session->SessionSettings,
+						bForMatchmaking
+					});
+					EOS_Sessions_UpdateSession(this->sessionsHandle, &updateSessionOptions, clientData, &FOnlineSessionEpic::OnEOSCreateSessionComplete);
 
 					// Mark the creation operation as pending
 					result = ONLINE_IO_PENDING;
@@ -1578,7 +3446,7 @@ bool FOnlineSessionEpic::CreateSession(const FUniqueNetId& HostingPlayerId, FNam
 		{
 			UE_LOG_ONLINE_SESSION(Warning, TEXT("%s"), *err);
 		}
-		TriggerOnCreateSessionCompleteDelegates(SessionName, (result == ONLINE_SUCCESS) ? true : false);
+		this->CompleteCreateSession(SessionName, result == ONLINE_SUCCESS, bForMatchmaking);
 	}
 
 	return result == ONLINE_IO_PENDING || result == ONLINE_SUCCESS;
@@ -1600,13 +3468,13 @@ bool FOnlineSessionEpic::StartSession(FName SessionName)
 				TCHAR_TO_UTF8(*SessionName.ToString())
 			};
 
-			// Allocate struct for additional information, 
-			//as the callback doesn't expose the session that was started
-			FSessionStateChangeAdditionalData* additionalInfo = new FSessionStateChangeAdditionalData{
+			// Store additional information,
+			// as the callback doesn't expose the session that was started
+			void* clientData = SessionStateChangeContexts.Add(this, FSessionStateChangeAdditionalData{
 				this,
 				SessionName
-			};
-			EOS_Sessions_StartSession(this->sessionsHandle, &startSessionOpts, additionalInfo, &FOnlineSessionEpic::OnEOSStartSessionComplete);
+			});
+			EOS_Sessions_StartSession(this->sessionsHandle, &startSessionOpts, clientData, &FOnlineSessionEpic::OnEOSStartSessionComplete);
 			resultCode = ONLINE_IO_PENDING;
 		}
 		else
@@ -1637,54 +3505,32 @@ bool FOnlineSessionEpic::UpdateSession(FName SessionName, FOnlineSessionSettings
 	uint32 result = ONLINE_FAIL;
 
 	if (FNamedOnlineSession* session = this->GetNamedSession(SessionName))
-	{
-		// Make a copy of the old settings
-		FOnlineSessionSettings oldSettings = FOnlineSessionSettings();
-
-		// Update the local session with the new settings 
-		session->SessionSettings = UpdatedSessionSettings;
-
-		// Only do work if the online data should be refreshed
-		if (bShouldRefreshOnlineData)
-		{
-			EOS_HSessionModification sessionModificationHandle = {};
-			this->CreateSessionModificationHandle(UpdatedSessionSettings, sessionModificationHandle, err);
-			if (err.IsEmpty())
-			{
-				// Modify the local session with the modified session options
-				EOS_Sessions_UpdateSessionModificationOptions sessionModificationOptions =
-				{
-					EOS_SESSIONS_UPDATESESSIONMODIFICATION_API_LATEST,
-					TCHAR_TO_UTF8(*SessionName.ToString())
-				};
-				EOS_EResult eosResult = EOS_Sessions_UpdateSessionModification(this->sessionsHandle, &sessionModificationOptions, &sessionModificationHandle);
-				if (eosResult == EOS_EResult::EOS_Success)
-				{
-					// Update the remote session
-					EOS_Sessions_UpdateSessionOptions updateSessionOptions = {};
-					updateSessionOptions.ApiVersion = EOS_SESSIONS_UPDATESESSION_API_LATEST;
-					updateSessionOptions.SessionModificationHandle = sessionModificationHandle;
-
-					FUpdateSessionAdditionalData* additionalInfo = new FUpdateSessionAdditionalData{
-						this,
-						oldSettings
-					};
-
-					EOS_Sessions_UpdateSession(this->sessionsHandle, &updateSessionOptions, additionalInfo, &FOnlineSessionEpic::OnEOSCreateSessionComplete);
-					result = ONLINE_IO_PENDING;
-
-					EOS_SessionModification_Release(sessionModificationHandle);
-				}
-				else
-				{
-					char const* resultStr = EOS_EResult_ToString(eosResult);
-					err = FString::Printf(TEXT("[EOS SDK] Error modifying session options - Error Code: %s"), resultStr);
-				}
+	{
+		// Update the local session with the new settings. The last update wins
+		session->SessionSettings = UpdatedSessionSettings;
+
+		// Only do work if the online data should be refreshed
+		if (bShouldRefreshOnlineData)
+		{
+			FSessionAdvertisementEpic& advertisement = this->SessionAdvertisements.FindOrAdd(SessionName);
+			advertisement.bDirty = true;
+			advertisement.NumQueuedCalls++;
+
+			// Slot changes matter to players looking for a session, so they're pushed with priority
+			FOnlineSessionSettings const* pushedSettings = this->PushedSessionSettings.Find(SessionName);
+			if (!pushedSettings
+				|| pushedSettings->NumPublicConnections != UpdatedSessionSettings.NumPublicConnections
+				|| pushedSettings->NumPrivateConnections != UpdatedSessionSettings.NumPrivateConnections)
+			{
+				advertisement.bSlotsDirty = true;
 			}
-			else
+
+			// Without rate limiting the update is sent right away, unless another one is still in flight
+			if (this->SessionUpdateInterval <= 0.0 && !advertisement.bInFlight)
 			{
-				err = FString::Printf(TEXT("[EOS SDK] Error creating session modification - Error Code: %s"), *err);
+				this->PushSessionUpdate(SessionName);
 			}
+			result = ONLINE_IO_PENDING;
 		}
 		else
 		{
@@ -1698,14 +3544,8 @@ bool FOnlineSessionEpic::UpdateSession(FName SessionName, FOnlineSessionSettings
 
 	if (result != ONLINE_IO_PENDING)
 	{
-		if (!err.IsEmpty())
-		{
-			if (!err.IsEmpty())
-			{
-				UE_LOG_ONLINE_SESSION(Warning, TEXT("%s"), *err);
-			}
-		}
-		TriggerOnCreateSessionCompleteDelegates(SessionName, (result == ONLINE_SUCCESS) ? true : false);
+		UE_CLOG_ONLINE_SESSION(!err.IsEmpty(), Warning, TEXT("%s"), *err);
+		TriggerOnUpdateSessionCompleteDelegates(SessionName, (result == ONLINE_SUCCESS) ? true : false);
 	}
 	return result == ONLINE_IO_PENDING || result == ONLINE_SUCCESS;
 }
@@ -1726,11 +3566,11 @@ bool FOnlineSessionEpic::EndSession(FName SessionName)
 				EOS_SESSIONS_ENDSESSION_API_LATEST,
 				TCHAR_TO_UTF8(*SessionName.ToString())
 			};
-			FSessionStateChangeAdditionalData* additionalInfo = new FSessionStateChangeAdditionalData{
+			void* clientData = SessionStateChangeContexts.Add(this, FSessionStateChangeAdditionalData{
 				this,
 				SessionName
-			};
-			EOS_Sessions_EndSession(this->sessionsHandle, &endSessionOptions, additionalInfo, &FOnlineSessionEpic::OnEOSEndSessionComplete);
+			});
+			EOS_Sessions_EndSession(this->sessionsHandle, &endSessionOptions, clientData, &FOnlineSessionEpic::OnEOSEndSessionComplete);
 
 			resultCode = ONLINE_IO_PENDING;
 		}
@@ -1770,15 +3610,15 @@ bool FOnlineSessionEpic::DestroySession(FName SessionName, const FOnDestroySessi
 		{
 			session->SessionState = EOnlineSessionState::Destroying;
 
-			FSessionStateChangeAdditionalData* additionalInfo = new FSessionStateChangeAdditionalData{
+			void* clientData = SessionStateChangeContexts.Add(this, FSessionStateChangeAdditionalData{
 				this,
 				SessionName
-			};
+			});
 			EOS_Sessions_DestroySessionOptions destroySessionOpts = {
 				EOS_SESSIONS_DESTROYSESSION_API_LATEST,
 				TCHAR_TO_UTF8(*SessionName.ToString())
 			};
-			EOS_Sessions_DestroySession(this->sessionsHandle, &destroySessionOpts, additionalInfo, &FOnlineSessionEpic::OnEOSDestroySessionComplete);
+			EOS_Sessions_DestroySession(this->sessionsHandle, &destroySessionOpts, clientData, &FOnlineSessionEpic::OnEOSDestroySessionComplete);
 
 			resultCode = ONLINE_IO_PENDING;
 		}
@@ -1811,202 +3651,631 @@ bool FOnlineSessionEpic::IsPlayerInSession(FName SessionName, const FUniqueNetId
 	// Improvement: Maybe call SDK backend?
 	if (FNamedOnlineSession* session = this->GetNamedSession(SessionName))
 	{
-		return session->RegisteredPlayers.ContainsByPredicate([&UniqueId](TSharedRef<const FUniqueNetId> id) {
-			return *id == UniqueId;
-			});
+		return session->RegisteredPlayers.ContainsByPredicate([&UniqueId](TSharedRef<const FUniqueNetId> id) {
+			return *id == UniqueId;
+			});
+	}
+
+	UE_LOG_ONLINE_SESSION(Warning, TEXT("No session with name \"%s\" found"), *SessionName.ToString());
+	return false;
+}
+
+bool FOnlineSessionEpic::StartMatchmaking(const TArray< TSharedRef<const FUniqueNetId> >& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	// While the searching player's tokens are refreshed, matchmaking starts once the refresh completed
+	if (LocalPlayers.Num() > 0)
+	{
+		bool const bDeferred = this->Subsystem->IdentityInterface->DeferWhileRefreshingToken(*LocalPlayers[0], [this, LocalPlayers, SessionName, NewSessionSettings, SearchSettings](FUniqueNetId const& RefreshedPlayerId)
+		{
+			TSharedRef<FOnlineSessionSearch> searchSettings = SearchSettings;
+			this->StartMatchmaking(LocalPlayers, SessionName, NewSessionSettings, searchSettings);
+		});
+		if (bDeferred)
+		{
+			return true;
+		}
+	}
+
+	FString error;
+	uint32 result = ONLINE_FAIL;
+
+	if (LocalPlayers.Num() == 0)
+	{
+		error = TEXT("No local players to matchmake for.");
+	}
+	else if (this->MatchmakingTickets.Contains(SessionName))
+	{
+		error = FString::Printf(TEXT("Already matchmaking for session \"%s\"."), *SessionName.ToString());
+	}
+	else if (this->GetNamedSession(SessionName))
+	{
+		error = FString::Printf(TEXT("Session \"%s\" already exists."), *SessionName.ToString());
+	}
+	else
+	{
+		uint64 const ticketId = this->NextMatchmakingTicketId++;
+		FMatchmakingTicketEpic& ticket = this->MatchmakingTickets.Add(SessionName, FMatchmakingTicketEpic(ticketId, LocalPlayers[0], SearchSettings));
+		ticket.NumLocalPlayers = LocalPlayers.Num();
+		ticket.NewSessionSettings = NewSessionSettings;
+		ticket.StartTime = FPlatformTime::Seconds();
+
+		// Unregister earlier runs while their results can still be dropped from the index
+		this->SupersedeSessionSearches(SearchSettings);
+		SearchSettings->SearchResults.Empty();
+		SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+
+		// Parameters added last are relaxed first. The bucket is never relaxed
+		TArray<FName> relaxableParams;
+		for (auto const& param : SearchSettings->QuerySettings.SearchParams)
+		{
+			if (!IsBucketSearchParam(param.Key))
+			{
+				relaxableParams.Add(param.Key);
+			}
+		}
+
+		int32 const numPasses = FMath::Min(this->MatchmakingPasses, relaxableParams.Num() + 1);
+		for (int32 passIdx = 0; passIdx < numPasses; ++passIdx)
+		{
+			TSharedRef<FOnlineSessionSearch> pass = MakeShared<FOnlineSessionSearch>(*SearchSettings);
+			for (int32 relaxedIdx = 0; relaxedIdx < passIdx; ++relaxedIdx)
+			{
+				pass->QuerySettings.SearchParams.Remove(relaxableParams[relaxableParams.Num() - 1 - relaxedIdx]);
+			}
+			ticket.Passes.Add(pass);
+		}
+
+		ticket.DeadlineTimer = this->SearchTimers.Schedule(this->MatchmakingTimeout, [this, SessionName, ticketId]()
+			{
+				this->OnMatchmakingDeadline(SessionName, ticketId);
+			});
+
+		// Passes might complete right away when answered from the cache, so don't hold on to the ticket
+		TArray<TSharedRef<FOnlineSessionSearch>> const passes = ticket.Passes;
+		TSharedRef<FUniqueNetId const> const searchingPlayerId = ticket.SearchingPlayerId;
+		for (TSharedRef<FOnlineSessionSearch> const& pass : passes)
+		{
+			this->StartInternalSessionSearch(*searchingPlayerId, pass, [this, SessionName, ticketId](bool bWasSuccessful)
+				{
+					this->OnMatchmakingPassComplete(SessionName, ticketId);
+				});
+		}
+
+		UE_LOG_ONLINE_SESSION(Log, TEXT("Started matchmaking for session \"%s\" with %d search pass(es)."), *SessionName.ToString(), numPasses);
+		result = ONLINE_IO_PENDING;
+	}
+
+	if (result != ONLINE_IO_PENDING)
+	{
+		UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("%s"), *error);
+		TriggerOnMatchmakingCompleteDelegates(SessionName, result == ONLINE_SUCCESS);
+	}
+
+	return result == ONLINE_IO_PENDING || result == ONLINE_SUCCESS;
+}
+
+bool FOnlineSessionEpic::CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName)
+{
+	IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
+	check(identityPtr);
+
+	TSharedPtr<const FUniqueNetId> netId = identityPtr->GetUniquePlayerId(SearchingPlayerNum);
+	if (!netId)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Can't cancel matchmaking for session \"%s\". No user logged in as local user %d."), *SessionName.ToString(), SearchingPlayerNum);
+		TriggerOnCancelMatchmakingCompleteDelegates(SessionName, false);
+		return false;
+	}
+	return this->CancelMatchmaking(*netId, SessionName);
+}
+bool FOnlineSessionEpic::CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName)
+{
+	FString error;
+	uint32 result = ONLINE_FAIL;
+
+	FMatchmakingTicketEpic const* ticket = this->MatchmakingTickets.Find(SessionName);
+	if (!ticket)
+	{
+		error = FString::Printf(TEXT("Not matchmaking for session \"%s\"."), *SessionName.ToString());
+	}
+	else if (ticket->State != EMatchmakingStateEpic::Searching)
+	{
+		error = FString::Printf(TEXT("Matchmaking for session \"%s\" is already joining or creating a session."), *SessionName.ToString());
+	}
+	else
+	{
+		// The searches of the request run to completion, their results are ignored
+		FMatchmakingTicketEpic const cancelledTicket = this->MatchmakingTickets.FindAndRemoveChecked(SessionName);
+		this->SearchTimers.Cancel(cancelledTicket.DeadlineTimer);
+		cancelledTicket.SearchSettings->SearchState = EOnlineAsyncTaskState::Failed;
+		++this->MatchmakingStats.NumFailed;
+
+		UE_LOG_ONLINE_SESSION(Log, TEXT("Cancelled matchmaking for session \"%s\"."), *SessionName.ToString());
+		result = ONLINE_SUCCESS;
+	}
+
+	UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("%s"), *error);
+	TriggerOnCancelMatchmakingCompleteDelegates(SessionName, result == ONLINE_SUCCESS);
+
+	return result == ONLINE_SUCCESS;
+}
+
+bool FOnlineSessionEpic::FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
+	check(identityPtr);
+
+	TSharedPtr<const FUniqueNetId> netId = identityPtr->GetUniquePlayerId(SearchingPlayerNum);
+	return this->FindSessions(*netId, SearchSettings);
+}
+bool FOnlineSessionEpic::FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	// While the searching player's tokens are refreshed, the search starts once the refresh completed
+	bool const bDeferred = this->Subsystem->IdentityInterface->DeferWhileRefreshingToken(SearchingPlayerId, [this, SearchSettings](FUniqueNetId const& RefreshedPlayerId)
+	{
+		this->RunSessionSearch(RefreshedPlayerId, SearchSettings, nullptr);
+	});
+	if (bDeferred)
+	{
+		SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+		return true;
+	}
+
+	return this->RunSessionSearch(SearchingPlayerId, SearchSettings, nullptr);
+}
+
+bool FOnlineSessionEpic::RunSessionSearch(FUniqueNetId const& SearchingPlayerId, TSharedRef<FOnlineSessionSearch> const& SearchSettings, FPreparedSessionSearchEpic const* PreparedSearch)
+{
+	FString error;
+	uint32 result = ONLINE_FAIL;
+	SearchSettings->SearchState = EOnlineAsyncTaskState::NotStarted;
+
+	FUniqueNetIdEpic const epicNetId = static_cast<FUniqueNetIdEpic>(SearchingPlayerId);
+	if (epicNetId.IsEpicAccountIdValid())
+	{
+		// Searches that weren't prepared are converted for this run only
+		FPreparedSessionSearchEpic oneShotSearch;
+		if (SearchSettings->bIsLanQuery)
+		{
+			error = TEXT("LAN searches are not supported.");
+		}
+		else if (!PreparedSearch && !this->PrepareSearchParameters(SearchingPlayerId, *SearchSettings, oneShotSearch, error))
+		{
+			error = FString::Printf(TEXT("Invalid search parameters. Error: %s"), *error);
+		}
+		else
+		{
+			FPreparedSessionSearchEpic const& preparedSearch = PreparedSearch ? *PreparedSearch : oneShotSearch;
+
+			// Drop results of previous runs of this search. They're unregistered first, so the index doesn't keep them
+			this->SupersedeSessionSearches(SearchSettings);
+			SearchSettings->SearchResults.Empty();
+
+			FString const& fingerprint = preparedSearch.Fingerprint;
+			FSessionSearchCacheEntryEpic const* cachedSearch = this->SearchResultCache.Find(fingerprint);
+			uint64 const* inFlightSearchId = this->InFlightSearches.Find(fingerprint);
+			if (cachedSearch && FPlatformTime::Seconds() - cachedSearch->CompletionTime <= this->SearchCacheTTL)
+			{
+				// An identical query completed recently, answer it from the cache
+				SearchSettings->SearchResults = cachedSearch->SearchResults;
+				SearchSettings->SearchState = EOnlineAsyncTaskState::Done;
+
+				uint64 searchId = this->AddSessionSearch(nullptr, SearchSettings);
+				for (int32 resultIndex = 0; resultIndex < SearchSettings->SearchResults.Num(); ++resultIndex)
+				{
+					this->IndexSearchResult(searchId, resultIndex);
+				}
+
+				UE_LOG_ONLINE_SESSION(Verbose, TEXT("Answered session search from cache.\r\n    Fingerprint: %s"), *fingerprint);
+				result = ONLINE_SUCCESS;
+			}
+			else if (inFlightSearchId)
+			{
+				// An identical query is already running, wait for its results instead of issuing a new request
+				FSessionSearchEntryEpic& inFlightSearch = this->SessionSearches.FindChecked(*inFlightSearchId);
+				if (inFlightSearch.SessionSearch != SearchSettings)
+				{
+					// Streaming searches might already have delivered some of their results
+					SearchSettings->SearchResults = inFlightSearch.SessionSearch->SearchResults;
+					inFlightSearch.SharedSearches.AddUnique(SearchSettings);
+				}
+				SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+
+				result = ONLINE_IO_PENDING;
+			}
+			else
+			{
+				EOS_Sessions_CreateSessionSearchOptions sessionSearchOpts = {
+					EOS_SESSIONS_CREATESESSIONSEARCH_API_LATEST,
+					static_cast<uint32_t>(preparedSearch.MaxSearchResults)
+				};
+
+				// Handle where the session search is stored
+				EOS_HSessionSearch sessionSearchHandle = nullptr;
+				EOS_EResult eosResult = EOS_Sessions_CreateSessionSearch(this->sessionsHandle, &sessionSearchOpts, &sessionSearchHandle);
+				if (eosResult == EOS_EResult::EOS_Success)
+				{
+					// The parameters were converted and validated when the search was prepared
+					ApplySearchParameters(preparedSearch, sessionSearchHandle);
+
+					// Mark the search as in progress
+					SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+
+					// Store the EOS session search handle and the caller's session search object,
+					// so the results can be written into it later
+					uint64 searchId = this->AddSessionSearch(sessionSearchHandle, SearchSettings);
+					FSessionSearchEntryEpic& search = this->SessionSearches[searchId];
+					search.Fingerprint = fingerprint;
+					search.FlagsMask = preparedSearch.FlagsMask;
+					search.FlagsValue = preparedSearch.FlagsValue;
+					this->InFlightSearches.Add(fingerprint, searchId);
+
+					// Give up on the search, if the backend doesn't answer in time
+					if (SearchSettings->TimeoutInSeconds > 0.0f)
+					{
+						search.TimerHandle = this->SearchTimers.Schedule(SearchSettings->TimeoutInSeconds, [this, searchId]()
+							{
+								this->OnSessionSearchTimeout(searchId);
+							});
+					}
+
+					EOS_SessionSearch_FindOptions findOptions = {
+						EOS_SESSIONSEARCH_FIND_API_LATEST,
+						epicNetId.ToProductUserId()
+					};
+					void* clientData = FindSessionsContexts.Add(this, FFindSessionsAdditionalData{
+						this,
+						searchId,
+						sessionSearchHandle
+					});
+					this->SessionSearches.FindChecked(searchId).bFindPending = true;
+					EOS_SessionSearch_Find(sessionSearchHandle, &findOptions, clientData, &FOnlineSessionEpic::OnEOSFindSessionComplete);
+
+					// Mark the operation as pending
+					result = ONLINE_IO_PENDING;
+				}
+				else
+				{
+					error = FString::Printf(TEXT("[EOS SDK] Couldn't create sessionsearch. Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
+				}
+			}
+		}
+	}
+	else
+	{
+		error = TEXT("SearchingPlayerId is not a valid EpicAccountId");
+	}
+
+	if (result != ONLINE_IO_PENDING)
+	{
+		UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("%s"), *error);
+		if (result != ONLINE_SUCCESS)
+		{
+			SearchSettings->SearchState = EOnlineAsyncTaskState::Failed;
+		}
+		this->CompleteSessionSearch(SearchSettings, result == ONLINE_SUCCESS);
+	}
+
+	return result == ONLINE_IO_PENDING || result == ONLINE_SUCCESS;
+}
+
+bool FOnlineSessionEpic::FindSessionsInBuckets(FUniqueNetId const& SearchingPlayerId, TArray<FString> const& BucketIds, TSharedRef<FOnlineSessionSearch> const& SearchSettings)
+{
+	// While the player's tokens are refreshed, the buckets are searched once the refresh completed
+	bool const bDeferred = this->Subsystem->IdentityInterface->DeferWhileRefreshingToken(SearchingPlayerId, [this, BucketIds, SearchSettings](FUniqueNetId const& RefreshedPlayerId)
+	{
+		this->FindSessionsInBuckets(RefreshedPlayerId, BucketIds, SearchSettings);
+	});
+	if (bDeferred)
+	{
+		return true;
+	}
+
+	FString error;
+	uint32 result = ONLINE_FAIL;
+
+	// Searching the same bucket twice only yields duplicates
+	TArray<FString> uniqueBucketIds;
+	for (FString const& bucketId : BucketIds)
+	{
+		uniqueBucketIds.AddUnique(bucketId);
+	}
+
+	if (uniqueBucketIds.Num() == 0)
+	{
+		error = TEXT("No buckets to search.");
+	}
+	else if (SearchSettings->bIsLanQuery)
+	{
+		error = TEXT("LAN searches are not supported.");
+	}
+	else
+	{
+		uint64 const bucketSearchId = this->NextBucketSearchId++;
+		FBucketSearchEpic& bucketSearch = this->BucketSearches.Add(bucketSearchId, FBucketSearchEpic(SearchSettings));
+		bucketSearch.NumPendingBuckets = uniqueBucketIds.Num();
+		bucketSearch.NumMergedResults.SetNumZeroed(uniqueBucketIds.Num());
+
+		// Unregister earlier runs while their results can still be dropped from the index
+		this->SupersedeSessionSearches(SearchSettings);
+		SearchSettings->SearchResults.Empty();
+		SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+
+		// Every bucket gets its own copy of the query, with only the bucket id replaced
+		for (FString const& bucketId : uniqueBucketIds)
+		{
+			TSharedRef<FOnlineSessionSearch> bucketQuery = MakeShared<FOnlineSessionSearch>(*SearchSettings);
+			TArray<FName> bucketParams;
+			for (auto const& param : bucketQuery->QuerySettings.SearchParams)
+			{
+				if (IsBucketSearchParam(param.Key))
+				{
+					bucketParams.Add(param.Key);
+				}
+			}
+			for (FName const& bucketParam : bucketParams)
+			{
+				bucketQuery->QuerySettings.SearchParams.Remove(bucketParam);
+			}
+			bucketQuery->QuerySettings.Set(EosBucketIdKey, bucketId, EOnlineComparisonOp::Equals);
+			bucketSearch.BucketSearches.Add(bucketQuery);
+		}
+
+		if (SearchSettings->TimeoutInSeconds > 0.0f)
+		{
+			bucketSearch.DeadlineTimer = this->SearchTimers.Schedule(SearchSettings->TimeoutInSeconds, [this, bucketSearchId]()
+				{
+					if (FBucketSearchEpic* expiredSearch = this->BucketSearches.Find(bucketSearchId))
+					{
+						expiredSearch->DeadlineTimer = 0;
+						this->FinishBucketSearch(bucketSearchId);
+					}
+				});
+		}
+
+		// Bucket searches might complete right away when answered from the cache, so don't hold on to the bucket search
+		TArray<TSharedRef<FOnlineSessionSearch>> const bucketQueries = bucketSearch.BucketSearches;
+		for (int32 bucketIdx = 0; bucketIdx < bucketQueries.Num(); ++bucketIdx)
+		{
+			this->StartInternalSessionSearch(SearchingPlayerId, bucketQueries[bucketIdx],
+				[this, bucketSearchId, bucketIdx](bool bWasSuccessful)
+				{
+					this->OnBucketSearchComplete(bucketSearchId, bucketIdx, bWasSuccessful);
+				},
+				[this, bucketSearchId, bucketIdx](int32 NumNewResults)
+				{
+					this->MergeBucketSearchResults(bucketSearchId, bucketIdx);
+				});
+		}
+
+		UE_LOG_ONLINE_SESSION(Log, TEXT("Started session search across %d bucket(s)."), uniqueBucketIds.Num());
+		result = ONLINE_IO_PENDING;
+	}
+
+	if (result != ONLINE_IO_PENDING)
+	{
+		UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("%s"), *error);
+		SearchSettings->SearchState = EOnlineAsyncTaskState::Failed;
+		TriggerOnFindSessionsCompleteDelegates(false);
+	}
+
+	return result == ONLINE_IO_PENDING || result == ONLINE_SUCCESS;
+}
+
+uint64 FOnlineSessionEpic::PrepareSessionSearch(FUniqueNetId const& SearchingPlayerId, TSharedRef<FOnlineSessionSearch> const& SearchSettings, float RefreshInterval, bool bDifferential)
+{
+	FPreparedSessionSearchEpic preparedSearch;
+	FString error;
+	if (!this->PrepareSearchParameters(SearchingPlayerId, *SearchSettings, preparedSearch, error))
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Couldn't prepare session search. Error: %s"), *error);
+		return 0;
+	}
+
+	preparedSearch.SessionSearch = SearchSettings;
+	preparedSearch.SearchingPlayerId = SearchingPlayerId.AsShared();
+	preparedSearch.RefreshInterval = FMath::Max(0.0f, RefreshInterval);
+	preparedSearch.bDifferential = bDifferential;
+
+	uint64 const preparedSearchId = this->NextPreparedSearchId++;
+	this->PreparedSearches.Add(preparedSearchId, MoveTemp(preparedSearch));
+	return preparedSearchId;
+}
+
+bool FOnlineSessionEpic::ExecutePreparedSessionSearch(uint64 PreparedSearchId)
+{
+	FPreparedSessionSearchEpic* preparedSearch = this->PreparedSearches.Find(PreparedSearchId);
+	if (!preparedSearch)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Prepared session search %llu doesn't exist."), PreparedSearchId);
+		return false;
+	}
+
+	// Running the search on request replaces the scheduled refresh
+	this->SearchTimers.Cancel(preparedSearch->RefreshTimer);
+	preparedSearch->RefreshTimer = 0;
+
+	// While the player's tokens are refreshed, the search runs once the refresh completed
+	bool const bDeferred = this->Subsystem->IdentityInterface->DeferWhileRefreshingToken(*preparedSearch->SearchingPlayerId, [this, PreparedSearchId](FUniqueNetId const& RefreshedPlayerId)
+	{
+		this->ExecutePreparedSessionSearch(PreparedSearchId);
+	});
+	if (bDeferred)
+	{
+		return true;
 	}
 
-	UE_LOG_ONLINE_SESSION(Warning, TEXT("No session with name \"%s\" found"), *SessionName.ToString());
-	return false;
+	TSharedRef<FOnlineSessionSearch> const sessionSearch = preparedSearch->SessionSearch.ToSharedRef();
+	this->SearchCompletionHooks.Add(&sessionSearch.Get(), [this, PreparedSearchId](bool bWasSuccessful)
+		{
+			this->OnPreparedSessionSearchComplete(PreparedSearchId, bWasSuccessful);
+		});
+	return this->RunSessionSearch(*preparedSearch->SearchingPlayerId, sessionSearch, preparedSearch);
 }
 
-bool FOnlineSessionEpic::StartMatchmaking(const TArray< TSharedRef<const FUniqueNetId> >& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings)
+void FOnlineSessionEpic::ReleasePreparedSessionSearch(uint64 PreparedSearchId)
 {
-	UE_LOG_ONLINE_SESSION(Warning, TEXT("StartMatchmaking not supported by EOS."));
-	return false;
+	FPreparedSessionSearchEpic preparedSearch;
+	if (this->PreparedSearches.RemoveAndCopyValue(PreparedSearchId, preparedSearch))
+	{
+		this->SearchTimers.Cancel(preparedSearch.RefreshTimer);
+	}
 }
 
-bool FOnlineSessionEpic::CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName)
-{
-	UE_LOG_ONLINE_SESSION(Warning, TEXT("CancelMatchmaking not supported by EOS."));
-	return false;
-}
-bool FOnlineSessionEpic::CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName)
+bool FOnlineSessionEpic::FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate)
 {
-	UE_LOG_ONLINE_SESSION(Warning, TEXT("CancelMatchmaking not supported by EOS."));
-	return false;
-}
+	FString error;
+	uint32 result = ONLINE_FAIL;
+	FOnlineSessionSearchResult searchResult;
 
-bool FOnlineSessionEpic::FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
-{
 	IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
 	check(identityPtr);
 
-	TSharedPtr<const FUniqueNetId> netId = identityPtr->GetUniquePlayerId(SearchingPlayerNum);
-	return this->FindSessions(*netId, SearchSettings);
-}
-bool FOnlineSessionEpic::FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
-{
-	FString error;
-	uint32 result = ONLINE_FAIL;
-	SearchSettings->SearchState = EOnlineAsyncTaskState::NotStarted;
+	// FPlatformUserId is a typedefed int32, which we use as local index
+	FPlatformUserId const localUserNum = identityPtr->GetPlatformUserIdFromUniqueNetId(SearchingUserId);
+	FString const sessionId = SessionId.ToString();
 
-	FUniqueNetIdEpic const epicNetId = static_cast<FUniqueNetIdEpic>(SearchingPlayerId);
-	if (epicNetId.IsEpicAccountIdValid())
+	if (FriendId.IsValid())
 	{
-		if (SearchSettings->bIsLanQuery)
+		error = TEXT("Searching for a session by friend id is not supported. Use FindFriendSession instead.");
+	}
+	else if (EOS_HSessionDetails cachedDetails = this->FindCachedSessionDetails(sessionId))
+	{
+		// Seen recently in a search, an invite or a lookup. No need to ask the backend
+		if (this->CreateSearchResultFromDetails(cachedDetails, searchResult))
 		{
-			error = TEXT("LAN searches are not supported.");
+			result = ONLINE_SUCCESS;
 		}
 		else
 		{
-			EOS_Sessions_CreateSessionSearchOptions sessionSearchOpts = {
-				EOS_SESSIONS_CREATESESSIONSEARCH_API_LATEST,
-				static_cast<uint32_t>(SearchSettings->MaxSearchResults)
-			};
-
-			// Handle where the session search is stored
-			EOS_HSessionSearch sessionSearchHandle = nullptr;
-			EOS_EResult eosResult = EOS_Sessions_CreateSessionSearch(this->sessionsHandle, &sessionSearchOpts, &sessionSearchHandle);
-			if (eosResult == EOS_EResult::EOS_Success)
-			{
-				UpdateSessionSearchParameters(SearchSettings, sessionSearchHandle, error);
-				if (error.IsEmpty()) // Only proceeded if there was no error
-				{
-					// Locally store the session search so it can be accessed later
-					double searchCreationTime = FDateTime::UtcNow().ToUnixTimestamp();
-
-					// Mark the search as in progress
-					SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
-
-					// Create pointer to a local, default session search object so the user can later access it
-					TSharedRef<FOnlineSessionSearch> sessionSearch = MakeShared<FOnlineSessionSearch>();
-
-					// Mark the session as in progress
-					sessionSearch->SearchState = EOnlineAsyncTaskState::InProgress;
-
-					// Store the EOS session search handle and the local session search object
-					TTuple<EOS_HSessionSearch, TSharedRef<FOnlineSessionSearch>> value(sessionSearchHandle, sessionSearch);
-					this->SessionSearches.Add(searchCreationTime, value);
-
-
-					EOS_SessionSearch_FindOptions findOptions = {
-						EOS_SESSIONSEARCH_FIND_API_LATEST,
-						epicNetId.ToProductUserId()
-					};
-					FFindSessionsAdditionalData* additionalData = new FFindSessionsAdditionalData{
-						this,
-						searchCreationTime
-					};
-					EOS_SessionSearch_Find(sessionSearchHandle, &findOptions, additionalData, &FOnlineSessionEpic::OnEOSFindSessionComplete);
-
-
-					// Mark the operation as pending
-					result = ONLINE_IO_PENDING;
-				}
-			}
-			else
-			{
-				error = FString::Printf(TEXT("[EOS SDK] Couldn't create sessionsearch. Error: %s"), UTF8_TO_TCHAR(EOS_EResult_ToString(eosResult)));
-			}
+			error = FString::Printf(TEXT("Couldn't read cached details of session %s"), *sessionId);
 		}
 	}
 	else
 	{
-		error = TEXT("SearchingPlayerId is not a valid EpicAccountId");
+		FOnSingleSessionResultCompleteDelegate const onComplete = CompletionDelegate;
+		auto lookup = [this, sessionId, localUserNum, onComplete](FUniqueNetId const& LookupUserId)
+		{
+			this->LookupSessionById(LookupUserId, sessionId, [this, sessionId, localUserNum, onComplete](bool bWasSuccessful)
+				{
+					FOnlineSessionSearchResult foundSession;
+					EOS_HSessionDetails details = bWasSuccessful ? this->FindCachedSessionDetails(sessionId) : nullptr;
+					bool const bFound = details && this->CreateSearchResultFromDetails(details, foundSession);
+
+					UE_CLOG_ONLINE_SESSION(!bFound, Warning, TEXT("No session by id found.\r\n    SessionId: %s"), *sessionId);
+					onComplete.ExecuteIfBound(localUserNum, bFound, foundSession);
+				});
+		};
+
+		// While the player's tokens are refreshed, the backend is asked once the refresh completed
+		if (!this->Subsystem->IdentityInterface->DeferWhileRefreshingToken(SearchingUserId, lookup))
+		{
+			lookup(SearchingUserId);
+		}
+		result = ONLINE_IO_PENDING;
 	}
 
 	if (result != ONLINE_IO_PENDING)
 	{
 		UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("%s"), *error);
-		SearchSettings->SearchState = EOnlineAsyncTaskState::Failed;
-		TriggerOnFindSessionsCompleteDelegates(false);
+		CompletionDelegate.ExecuteIfBound(localUserNum, result == ONLINE_SUCCESS, searchResult);
 	}
 
 	return result == ONLINE_IO_PENDING || result == ONLINE_SUCCESS;
 }
 
-bool FOnlineSessionEpic::FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate)
+bool FOnlineSessionEpic::CancelFindSessions()
 {
-	// Currently there is no way to get a named session (and therefore the joinability)
-	// of the current session searches or by using EOS_SessionSearch_SetSessionId.
-	// A way to make this work could be to assume that searched sessions are `GameSession`s only (bad)
-	// Or to only use the locally registered named sessions (also bad)
-	UE_LOG_ONLINE_SESSION(Warning, TEXT("FindSessionById not supported by the EOS SDK(yet)."));
-	return false;
-
-	//FString error;
-	//uint32 result = ONLINE_FAIL;
-	//FOnlineSessionSearchResult searchResult;
-
-	//IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
-	//check(identityPtr);
-
-	//// FPlatformUserId is a typedefed int32, which we use as local index
-	//FPlatformUserId localID = identityPtr->GetPlatformUserIdFromUniqueNetId(SearchingUserId);
-
-	//if (FriendId.IsValid())
-	//{
-	//	error = TEXT("[EOS SDK] Searching for friend id is not supported.");
-	//}
-	//else
-	//{
-	//	result = ONLINE_IO_PENDING;
-	//	for (auto session : this->CurrentSessionSearches)
-	//	{
-	//		if (session.Value->SearchState != EOnlineAsyncTaskState::Done)
-	//		{
-	//			// Only consider completed requests
-	//			continue;
-	//		}
+	// Searches across buckets are dropped first, so the cancellation of their bucket searches is ignored
+	for (auto const& bucketSearch : this->BucketSearches)
+	{
+		this->SearchTimers.Cancel(bucketSearch.Value.DeadlineTimer);
+		bucketSearch.Value.SessionSearch->SearchState = EOnlineAsyncTaskState::Failed;
+	}
+	this->BucketSearches.Empty();
 
-	//		TArray<FOnlineSessionSearchResult> searchResults = session.Value->SearchResults;
-	//		FOnlineSessionSearchResult* searchResultPtr = searchResults.FindByPredicate([&SessionId](FOnlineSessionSearchResult sr)
-	//			{
-	//				return FUniqueNetIdEpic(sr.GetSessionIdStr()) == SessionId;
-	//			});
+	// Friend session requests are dropped as well, so the cancellation of their searches doesn't start the next friends
+	TMap<uint64, FFriendSessionSearchEpic> const cancelledFriendSearches = MoveTemp(this->FriendSessionSearches);
+	this->FriendSessionSearches.Empty();
 
-	//		if (searchResultPtr)
-	//		{
-	//			result = ONLINE_SUCCESS;
-	//			break;
-	//		}
-	//	}
+	// Every search that still holds an EOS handle is running
+	TArray<uint64> runningSearches;
+	for (auto const& search : this->SessionSearches)
+	{
+		if (search.Value.SearchHandle)
+		{
+			runningSearches.Add(search.Key);
+		}
+	}
 
-	//	if (result != ONLINE_SUCCESS)
-	//	{
-	//		result = ONLINE_FAIL;
-	//		error = FString::Printf(TEXT("No session by id found.\r\n    SessionId: %s"), *SessionId.ToString());
-	//	}
-	//}
+	for (uint64 searchId : runningSearches)
+	{
+		FSessionSearchEntryEpic& search = this->SessionSearches[searchId];
+		TArray<TSharedRef<FOnlineSessionSearch>> cancelledSearches = MoveTemp(search.SharedSearches);
+		cancelledSearches.Add(search.SessionSearch);
+		this->InFlightSearches.Remove(search.Fingerprint);
 
-	//this->GetNamedSession(searchResult.Session.ses)
+		// Releases the EOS handle. The EOS callback of the search is ignored
+		this->RemoveSessionSearch(searchId);
 
-	//this->IsSessionJoinable()
+		// Searches of the session interface itself are told about the cancellation, the game isn't
+		for (TSharedRef<FOnlineSessionSearch> const& cancelledSearch : cancelledSearches)
+		{
+			cancelledSearch->SearchState = EOnlineAsyncTaskState::Failed;
+			this->SearchResultHooks.Remove(&cancelledSearch.Get());
 
+			FOnSessionSearchCompleteEpic onComplete;
+			if (this->SearchCompletionHooks.RemoveAndCopyValue(&cancelledSearch.Get(), onComplete))
+			{
+				onComplete(false);
+			}
+		}
+	}
 
-	//bool 
-	//if (result != ONLINE_IO_PENDING)
-	//{
-	//	UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("%s"), *error);
-	//	CompletionDelegate.ExecuteIfBound(localID, false, FOnlineSessionSearchResult());
-	//}
+	// Cancelled friend session requests complete with the sessions found so far
+	for (auto const& friendSearch : cancelledFriendSearches)
+	{
+		IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
+		FPlatformUserId userIdx = identityPtr->GetPlatformUserIdFromUniqueNetId(*friendSearch.Value.LocalUserId);
 
+		UE_LOG_ONLINE_SESSION(Display, TEXT("Cancelled searching the sessions of %d friend(s). Found %d session(s)."), friendSearch.Value.Friends.Num(), friendSearch.Value.SearchResults.Num());
+		this->TriggerOnFindFriendSessionCompleteDelegates(userIdx, false, friendSearch.Value.SearchResults);
+	}
 
-	//CompletionDelegate.ExecuteIfBound(localID, false, FOnlineSessionSearchResult());
-	//return result == ONLINE_IO_PENDING || result == ONLINE_SUCCESS;
-}
+	UE_CLOG_ONLINE_SESSION(runningSearches.Num() == 0, Warning, TEXT("No session search to cancel."));
+	UE_CLOG_ONLINE_SESSION(runningSearches.Num() > 0, Display, TEXT("Cancelled %d session search(es)."), runningSearches.Num());
 
-bool FOnlineSessionEpic::CancelFindSessions()
-{
-	UE_LOG_ONLINE_SESSION(Warning, TEXT("CancelFindSession not supported."));
-	return false;
+	TriggerOnCancelFindSessionsCompleteDelegates(runningSearches.Num() > 0);
+	return runningSearches.Num() > 0;
 }
 
 bool FOnlineSessionEpic::PingSearchResults(const FOnlineSessionSearchResult& SearchResult)
 {
-	UE_LOG_ONLINE_SESSION(Warning, TEXT("PingSearchResults not implemented."));
-	return false;
+	FString error;
+	uint32 result = ONLINE_FAIL;
+
+	// Only results we know about can be updated, so look up the search the result came from
+	FString const sessionId = SearchResult.GetSessionIdStr();
+	if (this->FindSearchResultBySessionId(sessionId))
+	{
+		FSessionSearchResultLocationEpic const location = this->SearchResultsBySessionId.FindChecked(sessionId);
+		TSharedRef<FOnlineSessionSearch> sessionSearch = this->SessionSearches.FindChecked(location.SearchId).SessionSearch;
+		if (this->PingSearchResult(sessionSearch, location.ResultIndex))
+		{
+			result = ONLINE_IO_PENDING;
+		}
+		else
+		{
+			error = FString::Printf(TEXT("Couldn't ping host of session %s"), *sessionId);
+		}
+	}
+	else
+	{
+		error = FString::Printf(TEXT("Session %s is not part of any search result"), *sessionId);
+	}
+
+	UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("%s"), *error);
+	return result == ONLINE_IO_PENDING || result == ONLINE_SUCCESS;
 }
 
 bool FOnlineSessionEpic::JoinSession(int32 PlayerNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
@@ -2018,6 +4287,21 @@ bool FOnlineSessionEpic::JoinSession(int32 PlayerNum, FName SessionName, const F
 	return this->JoinSession(*netId, SessionName, DesiredSession);
 }
 bool FOnlineSessionEpic::JoinSession(const FUniqueNetId& PlayerId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	// While the player's tokens are refreshed, the session is joined once the refresh completed
+	bool const bDeferred = this->Subsystem->IdentityInterface->DeferWhileRefreshingToken(PlayerId, [this, SessionName, DesiredSession](FUniqueNetId const& RefreshedPlayerId)
+	{
+		this->JoinSession(RefreshedPlayerId, SessionName, DesiredSession);
+	});
+	if (bDeferred)
+	{
+		return true;
+	}
+
+	return this->StartJoinSession(PlayerId, SessionName, DesiredSession, false);
+}
+
+bool FOnlineSessionEpic::StartJoinSession(const FUniqueNetId& PlayerId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession, bool bForMatchmaking)
 {
 	FString error;
 	uint32 result = ONLINE_FAIL;
@@ -2028,81 +4312,96 @@ bool FOnlineSessionEpic::JoinSession(const FUniqueNetId& PlayerId, FName Session
 	}
 	else
 	{
-		FNamedOnlineSession* namedSession = this->GetNamedSession(SessionName);
-		if (!namedSession) // This should be the norm
+		// EOS joins sessions by their details handle
+		FString const sessionId = DesiredSession.GetSessionIdStr();
+		EOS_HSessionDetails sessionDetailsHandle = this->FindCachedSessionDetails(sessionId);
+
+		// Get the session from the search results. Sessions found by id or through an invite aren't part of any search
+		FOnlineSessionSearchResult const* searchResultPtr = this->FindSearchResultBySessionId(sessionId);
+		if (!searchResultPtr && sessionDetailsHandle)
 		{
-			namedSession = this->AddNamedSession(SessionName, DesiredSession.Session);
+			searchResultPtr = &DesiredSession;
 		}
 
-		// Get the session form the search results
-		FOnlineSessionSearchResult* searchResultPtr = nullptr;
-		for (auto sessionT : this->SessionSearches)
+		if (searchResultPtr && !sessionDetailsHandle)
 		{
-			TSharedRef<FOnlineSessionSearch> session = sessionT.Value.Value;
-
-			// Only consider completed searches
-			if (session->SearchState == EOnlineAsyncTaskState::Done)
-			{
-				// Check if the desired session is in the search results
-				searchResultPtr = session->SearchResults.FindByPredicate([&DesiredSession](FOnlineSessionSearchResult sr)
-					{
-						return FUniqueNetIdString(sr.GetSessionIdStr()) == FUniqueNetIdString(DesiredSession.GetSessionIdStr());
-					});
-
-				if (searchResultPtr)
+			// The details were dropped from the cache since the session was found. Look the session up once more, then join
+			TSharedRef<FUniqueNetId const> const playerId = PlayerId.AsShared();
+			FOnlineSessionSearchResult const desiredSession = *searchResultPtr;
+			this->LookupSessionById(PlayerId, sessionId, [this, playerId, SessionName, desiredSession, sessionId, bForMatchmaking](bool bWasSuccessful)
 				{
-					// Remove the search result, as it is no longer needed
-					this->SessionSearches.Remove(sessionT.Key);
-					break;
-				}
+					if (bWasSuccessful && this->FindCachedSessionDetails(sessionId))
+					{
+						this->StartJoinSession(*playerId, SessionName, desiredSession, bForMatchmaking);
+					}
+					else
+					{
+						UE_LOG_ONLINE_SESSION(Warning, TEXT("Session %s to join doesn't exist anymore."), *sessionId);
+						this->CompleteJoinSession(SessionName, EOnJoinSessionCompleteResult::SessionDoesNotExist, bForMatchmaking);
+					}
+				});
+			result = ONLINE_IO_PENDING;
+		}
+		else if (searchResultPtr)
+		{
+			FNamedOnlineSession* namedSession = this->GetNamedSession(SessionName);
+			if (!namedSession) // This should be the norm
+			{
+				namedSession = this->AddNamedSession(SessionName, searchResultPtr->Session);
 			}
 
-			if (searchResultPtr)
-			{
-				// Joining players are the local owner but never the host
-				namedSession->HostingPlayerNum = INDEX_NONE; // HostingPlayernNum is going to be deprecated. Don't use it here
-				namedSession->LocalOwnerId = PlayerId.AsShared();
-				namedSession->bHosting = false;
+			// Joining players are the local owner but never the host
+			namedSession->HostingPlayerNum = INDEX_NONE; // HostingPlayernNum is going to be deprecated. Don't use it here
+			namedSession->LocalOwnerId = PlayerId.AsShared();
+			namedSession->bHosting = false;
 
-				IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
-				if (identityPtr.IsValid())
-				{
-					namedSession->OwningUserName = identityPtr->GetPlayerNickname(PlayerId);
-				}
-				else
-				{
-					namedSession->OwningUserName = FString(TEXT("EPIC User"));
-				}
+			IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
+			if (identityPtr.IsValid())
+			{
+				namedSession->OwningUserName = identityPtr->GetPlayerNickname(PlayerId);
+			}
+			else
+			{
+				namedSession->OwningUserName = FString(TEXT("EPIC User"));
+			}
 
-				namedSession->SessionSettings.BuildUniqueId = GetBuildUniqueId();
+			namedSession->SessionSettings.BuildUniqueId = GetBuildUniqueId();
 
-				// Register the current player as local player in the session. No need for a callback
-				this->RegisterLocalPlayer(PlayerId, SessionName, nullptr);
+			// Register the current player as local player in the session. No need for a callback
+			this->RegisterLocalPlayer(PlayerId, SessionName, nullptr);
 
-				// Push the join to backend
-				EOS_Sessions_JoinSessionOptions joinSessionOpts = {
-							EOS_SESSIONS_JOINSESSION_API_LATEST,
-							TCHAR_TO_UTF8(*SessionName.ToString())
-				};
-				FJoinSessionAdditionalData* additionalData = new FJoinSessionAdditionalData{
-					this,
-					SessionName
-				};
-				EOS_Sessions_JoinSession(this->sessionsHandle, &joinSessionOpts, additionalData, &FOnlineSessionEpic::OnEOSJoinSessionComplete);
+			// Push the join to backend
+			FTCHARToUTF8 sessionNameUtf8(*SessionName.ToString());
+			EOS_Sessions_JoinSessionOptions joinSessionOpts = {};
+			joinSessionOpts.ApiVersion = EOS_SESSIONS_JOINSESSION_API_LATEST;
+			joinSessionOpts.SessionName = sessionNameUtf8.Get();
+			joinSessionOpts.SessionHandle = sessionDetailsHandle;
+			joinSessionOpts.LocalUserId = ((FUniqueNetIdEpic)PlayerId).ToProductUserId();
+			void* clientData = JoinSessionContexts.Add(this, FJoinSessionAdditionalData{
+				this,
+				SessionName,
+				bForMatchmaking
+			});
+			EOS_Sessions_JoinSession(this->sessionsHandle, &joinSessionOpts, clientData, &FOnlineSessionEpic::OnEOSJoinSessionComplete);
 
-				result = ONLINE_IO_PENDING;
-			}
-			else
+			// The handle of an accepted invite was used, it can be evicted again
+			if (FSessionDetailsCacheEntryEpic* cachedDetails = this->SessionDetailsCache.Find(sessionId))
 			{
-				error = FString::Printf(TEXT("No sesssion to join found.\r\n Session: %s"), *SessionName.ToString());
+				cachedDetails->bPinned = false;
 			}
+
+			result = ONLINE_IO_PENDING;
+		}
+		else
+		{
+			error = FString::Printf(TEXT("No sesssion to join found.\r\n Session: %s"), *SessionName.ToString());
 		}
 	}
 
 	if (result != ONLINE_IO_PENDING)
 	{
-		UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("Error in %\r\n Message: %s"), *FString(__FUNCTION__), *error);
-		TriggerOnJoinSessionCompleteDelegates(SessionName, result == ONLINE_SUCCESS ? EOnJoinSessionCompleteResult::Success : EOnJoinSessionCompleteResult::UnknownError);
+		UE_CLOG_ONLINE_SESSION(!error.IsEmpty(), Warning, TEXT("Error in %s\r\n Message: %s"), *FString(__FUNCTION__), *error);
+		this->CompleteJoinSession(SessionName, result == ONLINE_SUCCESS ? EOnJoinSessionCompleteResult::Success : EOnJoinSessionCompleteResult::UnknownError, bForMatchmaking);
 	}
 
 	return result == ONLINE_SUCCESS || result == ONLINE_IO_PENDING;
@@ -2118,67 +4417,33 @@ bool FOnlineSessionEpic::FindFriendSession(int32 LocalUserNum, const FUniqueNetI
 }
 bool FOnlineSessionEpic::FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend)
 {
-	unimplemented();
-
+	TArray<TSharedRef<const FUniqueNetId>> friendList;
+	friendList.Add(Friend.AsShared());
+	return this->FindFriendSession(LocalUserId, friendList);
+}
+bool FOnlineSessionEpic::FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<TSharedRef<const FUniqueNetId>>& FriendList)
+{
 	FString error;
 	uint32 result = ONLINE_FAIL;
 
 	FUniqueNetIdEpic const epicNetId = (FUniqueNetIdEpic)LocalUserId;
-	if (epicNetId.IsEpicAccountIdValid())
+	if (!epicNetId.IsProductUserIdValid())
 	{
-		if (Friend.IsValid())
-		{
-			// Create session search handle
-			EOS_HSessionSearch sessionSearchHandle;
-			EOS_Sessions_CreateSessionSearchOptions sessionSearchOptions = {
-				EOS_SESSIONS_CREATESESSIONSEARCH_API_LATEST,
-				1
-			};
-			EOS_Sessions_CreateSessionSearch(this->sessionsHandle, &sessionSearchOptions, &sessionSearchHandle);
-
-			// To later access everything, the sessions creation time in UTC is used
-			double searchCreationTime = FDateTime::UtcNow().ToUnixTimestamp();
-
-			// Set the session search to only search for a user
-			EOS_SessionSearch_SetTargetUserIdOptions targetUserIdOptions = {
-				EOS_SESSIONSEARCH_SETTARGETUSERID_API_LATEST,
-				epicNetId.ToProductUserId()
-			};
-			EOS_SessionSearch_SetTargetUserId(sessionSearchHandle, &targetUserIdOptions);
-
-			// Create the session search itself and execute it
-			EOS_SessionSearch_FindOptions findOptions = {
-				EOS_SESSIONSEARCH_FIND_API_LATEST,
-				NULL
-			};
-			FFindFriendSessionAdditionalData additionalData = {
-				this,
-				searchCreationTime,
-				LocalUserId
-			};
-			EOS_SessionSearch_Find(sessionSearchHandle, &findOptions, &additionalData, &FOnlineSessionEpic::OnEOSFindFriendSessionComplete);
-
-			// Create pointer to a local, default session search object so the user can later access it
-			TSharedRef<FOnlineSessionSearch> sessionSearch = MakeShared<FOnlineSessionSearch>();
-
-			// Mark the session as in progress
-			sessionSearch->SearchState = EOnlineAsyncTaskState::InProgress;
-
-			// Store the EOS session search handle and the local session search object
-			TTuple<EOS_HSessionSearch, TSharedRef<FOnlineSessionSearch>> value(sessionSearchHandle, sessionSearch);
-			this->SessionSearches.Add(searchCreationTime, value);
-
-			// Mark the operation as pending
-			result = ONLINE_IO_PENDING;
-		}
-		else
-		{
-			error = FString::Printf(TEXT("Invalid friend id passed to %s"), *FString(__FUNCTION__));
-		}
+		error = FString::Printf(TEXT("Invalid user id passed to %s"), *FString(__FUNCTION__));
+	}
+	else if (FriendList.Num() == 0)
+	{
+		error = TEXT("No friends to search the sessions of.");
 	}
 	else
 	{
-		error = FString::Printf(TEXT("Invalid user id passed to %s"), *FString(__FUNCTION__));
+		// The friends are searched in parallel, through a window of a limited size
+		uint64 const friendSearchId = this->NextFriendSessionSearchId++;
+		FFriendSessionSearchEpic& friendSearch = this->FriendSessionSearches.Add(friendSearchId, FFriendSessionSearchEpic(LocalUserId.AsShared()));
+		friendSearch.Friends = FriendList;
+
+		this->StartFriendSessionSearches(friendSearchId);
+		result = ONLINE_IO_PENDING;
 	}
 
 	if (result != ONLINE_IO_PENDING)
@@ -2192,11 +4457,6 @@ bool FOnlineSessionEpic::FindFriendSession(const FUniqueNetId& LocalUserId, cons
 
 	return result == ONLINE_SUCCESS || result == ONLINE_IO_PENDING;
 }
-bool FOnlineSessionEpic::FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<TSharedRef<const FUniqueNetId>>& FriendList)
-{
-	UE_LOG_ONLINE_SESSION(Warning, TEXT("FindFriendSession with an array of friends is not supported. Repeatedly call the singular version instead."));
-	return false;
-}
 
 bool FOnlineSessionEpic::SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend)
 {
@@ -2234,6 +4494,11 @@ bool FOnlineSessionEpic::SendSessionInviteToFriends(const FUniqueNetId& LocalUse
 			for (int32 i = 0; i < Friends.Num(); ++i)
 			{
 				TSharedRef<FUniqueNetId const> friendNetId = Friends[i];
+				if (friendNetId->GetType() != EPIC_SUBSYSTEM)
+				{
+					UE_LOG_ONLINE_SESSION(Warning, TEXT("Can't invite friend %s. The id belongs to subsystem %s"), *friendNetId->ToString(), *friendNetId->GetType().ToString());
+					continue;
+				}
 				TSharedRef<FUniqueNetIdEpic const> friendEpicNetId = StaticCastSharedRef<FUniqueNetIdEpic const>(friendNetId);
 
 				EOS_Sessions_SendInviteOptions sendInviteOptions = {
@@ -2243,7 +4508,8 @@ bool FOnlineSessionEpic::SendSessionInviteToFriends(const FUniqueNetId& LocalUse
 					friendEpicNetId->ToProductUserId()
 				};
 
-				EOS_Sessions_SendInvite(this->sessionsHandle, &sendInviteOptions, this, &FOnlineSessionEpic::OnEOSSendSessionInviteToFriendsComplete);
+				void* clientData = SendInviteContexts.Add(this, FSendInviteAdditionalData{ this });
+				EOS_Sessions_SendInvite(this->sessionsHandle, &sendInviteOptions, clientData, &FOnlineSessionEpic::OnEOSSendSessionInviteToFriendsComplete);
 			}
 
 			result = ONLINE_IO_PENDING;
@@ -2337,7 +4603,7 @@ bool FOnlineSessionEpic::RegisterPlayer(FName SessionName, const FUniqueNetId& P
 {
 	TArray<TSharedRef<const FUniqueNetId>> players;
 	players.Add(MakeShared<FUniqueNetIdEpic>(PlayerId));
-	return RegisterPlayers(SessionName, players);
+	return RegisterPlayers(SessionName, players, bWasInvited);
 }
 bool FOnlineSessionEpic::RegisterPlayers(FName SessionName, const TArray< TSharedRef<const FUniqueNetId> >& Players, bool bWasInvited /*= false*/)
 {
@@ -2347,28 +4613,36 @@ bool FOnlineSessionEpic::RegisterPlayers(FName SessionName, const TArray< TShare
 	FNamedOnlineSession* Session = GetNamedSession(SessionName);
 	if (Session)
 	{
-		TArray<TSharedRef<const FUniqueNetId>> successfullyRegisteredPlayers;
-		EOS_ProductUserId* userIdArr = (EOS_ProductUserId*)malloc(Players.Num() * sizeof(EOS_ProductUserId));
-		for (int32 i = 0; i < Players.Num(); ++i)
+		FPendingRosterEpic& pendingRoster = this->PendingRosterUpdates.FindOrAdd(SessionName);
+		FRosterRequestEpic& request = pendingRoster.Requests[pendingRoster.Requests.AddDefaulted()];
+		request.bRegister = true;
+
+		for (TSharedRef<FUniqueNetId const> const& playerId : Players)
 		{
-			TSharedRef<FUniqueNetId const> playerId = Players[i];
 			FUniqueNetIdMatcher PlayerMatch(*playerId);
 			if (Session->RegisteredPlayers.IndexOfByPredicate(PlayerMatch) == INDEX_NONE)
 			{
-				Session->RegisteredPlayers.Add(playerId);
-				successfullyRegisteredPlayers.Add(playerId);
+				// Players admitted with ReserveSlot already hold a slot, everyone else needs a free one
+				if (!this->TakeSlot(*Session, *playerId, bWasInvited, false))
+				{
+					UE_LOG_ONLINE_SESSION(Warning, TEXT("No free slot for player.\r\n    Player: %s\r\n    Session: %s"), *playerId->ToDebugString(), *SessionName.ToString());
+					request.RejectedPlayers.Add(playerId);
+					continue;
+				}
+				this->ConfirmSlot(SessionName, *playerId);
 
-				TSharedRef<FUniqueNetIdEpic const> epicNetId = StaticCastSharedRef<FUniqueNetIdEpic const>(playerId);
-				userIdArr[i] = epicNetId->ToProductUserId();
+				Session->RegisteredPlayers.Add(playerId);
+				request.Players.Add(playerId);
 
-				// update number of open connections
-				if (Session->NumOpenPublicConnections > 0)
+				// A player that left during this tick is still registered with the backend
+				int32 const unregisterIdx = pendingRoster.PlayersToUnregister.IndexOfByPredicate(PlayerMatch);
+				if (unregisterIdx != INDEX_NONE)
 				{
-					Session->NumOpenPublicConnections--;
+					pendingRoster.PlayersToUnregister.RemoveAtSwap(unregisterIdx);
 				}
-				else if (Session->NumOpenPrivateConnections > 0)
+				else
 				{
-					Session->NumOpenPrivateConnections--;
+					pendingRoster.PlayersToRegister.Add(playerId);
 				}
 			}
 			else
@@ -2377,19 +4651,11 @@ bool FOnlineSessionEpic::RegisterPlayers(FName SessionName, const TArray< TShare
 			}
 		}
 
-		EOS_Sessions_RegisterPlayersOptions registerPlayerOpts = {
-			EOS_SESSIONS_REGISTERPLAYERS_API_LATEST,
-			TCHAR_TO_UTF8(*SessionName.ToString()),
-			userIdArr,
-			static_cast<uint32_t>(Players.Num())
-		};
-
-		FRegisterPlayersAdditionalData* additionalData = new FRegisterPlayersAdditionalData();
-		additionalData->OnlineSessionPtr = this;
-		additionalData->SessionName = SessionName;
-		additionalData->RegisteredPlayers = successfullyRegisteredPlayers;
-
-		EOS_Sessions_RegisterPlayers(this->sessionsHandle, &registerPlayerOpts, additionalData, &FOnlineSessionEpic::OnEOSRegisterPlayersComplete);
+		// Players that didn't fit into the session are reported together with the others, once the backend answered
+		if (!this->bBatchRosterUpdates)
+		{
+			this->FlushRosterUpdates(SessionName);
+		}
 
 		result = ONLINE_IO_PENDING;
 	}
@@ -2421,31 +4687,31 @@ bool FOnlineSessionEpic::UnregisterPlayers(FName SessionName, const TArray< TSha
 	FNamedOnlineSession* session = GetNamedSession(SessionName);
 	if (session)
 	{
-		TArray<TSharedRef<const FUniqueNetId>> successfullyRegisteredPlayers;
-		EOS_ProductUserId* productUserIdArr = (EOS_ProductUserId*)malloc(Players.Num() * sizeof(EOS_ProductUserId));
+		FPendingRosterEpic& pendingRoster = this->PendingRosterUpdates.FindOrAdd(SessionName);
+		FRosterRequestEpic& request = pendingRoster.Requests[pendingRoster.Requests.AddDefaulted()];
+		request.bRegister = false;
 
-		for (int32 i = 0; i < Players.Num(); ++i)
+		for (TSharedRef<FUniqueNetId const> const& playerId : Players)
 		{
-			TSharedRef<const FUniqueNetId> const playerId = Players[i];
-
 			FUniqueNetIdMatcher PlayerMatch(*playerId);
-			if (session->RegisteredPlayers.IndexOfByPredicate(PlayerMatch) != INDEX_NONE)
+			int32 const playerIdx = session->RegisteredPlayers.IndexOfByPredicate(PlayerMatch);
+			if (playerIdx != INDEX_NONE)
 			{
-				session->RegisteredPlayers.RemoveAtSwap(i);
-				successfullyRegisteredPlayers.Add(playerId);
+				session->RegisteredPlayers.RemoveAtSwap(playerIdx);
+				request.Players.Add(playerId);
 
-				// update number of open connections
-				if (session->NumOpenPublicConnections < session->SessionSettings.NumPublicConnections)
+				// A player that joined during this tick isn't registered with the backend yet
+				int32 const registerIdx = pendingRoster.PlayersToRegister.IndexOfByPredicate(PlayerMatch);
+				if (registerIdx != INDEX_NONE)
 				{
-					session->NumOpenPublicConnections += 1;
+					pendingRoster.PlayersToRegister.RemoveAtSwap(registerIdx);
 				}
-				else if (session->NumOpenPrivateConnections < session->SessionSettings.NumPrivateConnections)
+				else
 				{
-					session->NumOpenPrivateConnections += 1;
+					pendingRoster.PlayersToUnregister.Add(playerId);
 				}
 
-				TSharedRef<FUniqueNetIdEpic const> epicNetId = StaticCastSharedRef<FUniqueNetIdEpic const>(playerId);
-				productUserIdArr[i] = epicNetId->ToProductUserId();
+				this->ReleaseSlot(*session, playerId->ToString());
 			}
 			else
 			{
@@ -2453,19 +4719,11 @@ bool FOnlineSessionEpic::UnregisterPlayers(FName SessionName, const TArray< TSha
 			}
 		}
 
-		EOS_Sessions_RegisterPlayersOptions registerPlayerOpts = {
-			EOS_SESSIONS_REGISTERPLAYERS_API_LATEST,
-			TCHAR_TO_UTF8(*SessionName.ToString()),
-			productUserIdArr,
-			static_cast<uint32_t>(Players.Num())
-		};
-
-		FRegisterPlayersAdditionalData* additionalData = new FRegisterPlayersAdditionalData();
-		additionalData->OnlineSessionPtr = this;
-		additionalData->SessionName = SessionName;
-		additionalData->RegisteredPlayers = successfullyRegisteredPlayers;
+		if (!this->bBatchRosterUpdates)
+		{
+			this->FlushRosterUpdates(SessionName);
+		}
 
-		EOS_Sessions_RegisterPlayers(this->sessionsHandle, &registerPlayerOpts, additionalData, &FOnlineSessionEpic::OnEOSRegisterPlayersComplete);
 		result = ONLINE_IO_PENDING;
 	}
 	else
@@ -2482,6 +4740,48 @@ bool FOnlineSessionEpic::UnregisterPlayers(FName SessionName, const TArray< TSha
 	return result == ONLINE_SUCCESS || result == ONLINE_IO_PENDING;
 }
 
+bool FOnlineSessionEpic::ReserveSlot(FName SessionName, FUniqueNetId const& PlayerId, bool bWasInvited)
+{
+	FNamedOnlineSession* session = this->GetNamedSession(SessionName);
+	if (!session)
+	{
+		UE_LOG_ONLINE_SESSION(Warning, TEXT("Session not found.\r\n    Session Name: %s"), *SessionName.ToString());
+		return false;
+	}
+
+	FString const playerKey = PlayerId.ToString();
+	TMap<FString, FSlotReservationEpic> const* reservations = this->SlotReservations.Find(SessionName);
+	if (reservations && reservations->Contains(playerKey))
+	{
+		return true;
+	}
+
+	if (!this->TakeSlot(*session, PlayerId, bWasInvited, false))
+	{
+		UE_LOG_ONLINE_SESSION(Log, TEXT("Session is full, no slot reserved.\r\n    Player: %s\r\n    Session: %s"), *PlayerId.ToDebugString(), *SessionName.ToString());
+		return false;
+	}
+
+	this->SlotReservations[SessionName][playerKey].ExpiryTimer = this->SearchTimers.Schedule(this->SlotReservationTimeout, [this, SessionName, playerKey]()
+	{
+		this->OnSlotReservationExpired(SessionName, playerKey);
+	});
+	return true;
+}
+
+void FOnlineSessionEpic::CancelSlotReservation(FName SessionName, FUniqueNetId const& PlayerId)
+{
+	FNamedOnlineSession* session = this->GetNamedSession(SessionName);
+	TMap<FString, FSlotReservationEpic> const* reservations = this->SlotReservations.Find(SessionName);
+	FSlotReservationEpic const* reservation = reservations ? reservations->Find(PlayerId.ToString()) : nullptr;
+
+	// Confirmed slots belong to registered players and are released by UnregisterPlayers
+	if (session && reservation && !reservation->bConfirmed)
+	{
+		this->ReleaseSlot(*session, PlayerId.ToString());
+	}
+}
+
 void FOnlineSessionEpic::RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate)
 {
 	FNamedOnlineSession* session = this->GetNamedSession(SessionName);
@@ -2498,17 +4798,10 @@ void FOnlineSessionEpic::RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName
 		return;
 	}
 
+	// Local players are always admitted, the slot only keeps the number of open connections right
 	session->RegisteredPlayers.Add(PlayerId.AsShared());
-
-	// update number of open connections
-	if (session->NumOpenPublicConnections > 0)
-	{
-		session->NumOpenPublicConnections -= 1;
-	}
-	else if (session->NumOpenPrivateConnections > 0)
-	{
-		session->NumOpenPrivateConnections -= 1;
-	}
+	this->TakeSlot(*session, PlayerId, false, true);
+	this->ConfirmSlot(SessionName, PlayerId);
 	Delegate.ExecuteIfBound(PlayerId, EOnJoinSessionCompleteResult::Success);
 }
 void FOnlineSessionEpic::UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate)
@@ -2522,31 +4815,24 @@ void FOnlineSessionEpic::UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FNa
 	}
 
 	session->RegisteredPlayers.RemoveSingle(PlayerId.AsShared());
-
-	// update number of open connections
-	if (session->NumOpenPublicConnections < session->SessionSettings.NumPublicConnections)
-	{
-		session->NumOpenPublicConnections += 1;
-	}
-	else if (session->NumOpenPrivateConnections < session->SessionSettings.NumPrivateConnections)
-	{
-		session->NumOpenPrivateConnections += 1;
-	}
+	this->ReleaseSlot(*session, PlayerId.ToString());
 	Delegate.ExecuteIfBound(PlayerId, true);
 }
 
 int32 FOnlineSessionEpic::GetNumSessions()
 {
-	FScopeLock ScopeLock(&SessionLock);
+	FReadScopeLock ScopeLock(SessionLock);
 	return this->Sessions.Num();
 }
 
 void FOnlineSessionEpic::DumpSessionState()
 {
-	FScopeLock ScopeLock(&SessionLock);
+	FReadScopeLock ScopeLock(SessionLock);
 
-	for (int32 SessionIdx = 0; SessionIdx < Sessions.Num(); SessionIdx++)
+	for (auto const& session : Sessions)
 	{
-		DumpNamedSession(&Sessions[SessionIdx]);
+		DumpNamedSession(session.Value.Get());
 	}
+
+	UE_LOG_ONLINE_SESSION(Log, TEXT("Pending EOS operations: %d"), FOperationContextPoolEpic::NumOutstanding(this));
 }
@@ -3,14 +3,542 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/ScopeRWLock.h"
+#include "Containers/LruCache.h"
 #include "OnlineSubsystemEpicPackage.h"
 #include "Interfaces/OnlineSessionInterface.h"
 #include "OnlineSessionSettings.h"
 #include "UObject/CoreOnline.h"
 #include "eos_sdk.h"
+#include "OnlineSessionPingEpic.h"
+#include "TimerWheelEpic.h"
 
 class FOnlineSubsystemEpic;
 
+/**
+ * Delegate fired when a session search converted another batch of results
+ * @param SearchSettings - The search the results were appended to
+ * @param NumNewResults - The number of results appended to the end of the search results
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnFindSessionsResultsAvailable, TSharedRef<FOnlineSessionSearch> const&, int32);
+typedef FOnFindSessionsResultsAvailable::FDelegate FOnFindSessionsResultsAvailableDelegate;
+
+/**
+ * Delegate fired when the ping to the host of a search result was measured
+ * @param SearchResult - The search result with the updated ping. The ping is -1 if the host didn't answer
+ */
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnSearchResultPingComplete, FOnlineSessionSearchResult const&);
+typedef FOnSearchResultPingComplete::FDelegate FOnSearchResultPingCompleteDelegate;
+
+/**
+ * Delegate fired when FindFriendSession found the sessions of another friend, before the OnFindFriendSessionComplete delegates
+ * @param LocalUserNum - The local user searching
+ * @param NewResults - The sessions found since the delegate was last fired
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnFindFriendSessionResultsAvailable, int32, TArray<FOnlineSessionSearchResult> const&);
+typedef FOnFindFriendSessionResultsAvailable::FDelegate FOnFindFriendSessionResultsAvailableDelegate;
+
+/** The fields of a search result that changed between two runs of a differential search */
+enum class ESessionResultFieldsEpic : uint32
+{
+	None = 0,
+	/** NumOpenPublicConnections or NumOpenPrivateConnections */
+	OpenConnections = 1 << 0,
+	/** NumPublicConnections or NumPrivateConnections */
+	MaxConnections = 1 << 1,
+	/** PingInMs */
+	Ping = 1 << 2,
+	/** The address of the host */
+	HostAddress = 1 << 3,
+	/** The boolean session settings, e.g. bAllowInvites */
+	SessionFlags = 1 << 4,
+	/** The game specific session settings */
+	Settings = 1 << 5,
+	/** The id or name of the owning user */
+	Owner = 1 << 6
+};
+ENUM_CLASS_FLAGS(ESessionResultFieldsEpic);
+
+/** How a search result changed between two runs of a differential search */
+enum class ESessionResultChangeEpic : uint8
+{
+	/** The session wasn't part of the previous run */
+	Added,
+	/** The session isn't part of the current run anymore */
+	Removed,
+	/** The session is part of both runs, but some of its fields changed */
+	Changed
+};
+
+/** A single change of the results of a differential search */
+struct FSessionResultDeltaEpic
+{
+	/** How the result changed */
+	ESessionResultChangeEpic Change;
+
+	/** The id of the session */
+	FString SessionId;
+
+	/** The index of the result in the search results. INDEX_NONE for removed results */
+	int32 ResultIndex;
+
+	/** The fields that changed. Only set for changed results */
+	ESessionResultFieldsEpic ChangedFields;
+};
+
+/**
+ * Delegate fired when a run of a differential search completed and its results changed, before the OnFindSessionsComplete delegates.
+ * Pings usually arrive after the run completed. A changed ping is reported on its own once it arrived
+ * @param PreparedSearchId - The id of the prepared search
+ * @param Deltas - The results added, removed and changed since the last successful run
+ */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnSessionSearchResultsChanged, uint64, TArray<FSessionResultDeltaEpic> const&);
+typedef FOnSessionSearchResultsChanged::FDelegate FOnSessionSearchResultsChangedDelegate;
+
+/**
+ * A session search tracked by the session interface.
+ * Couples the EOS search handle with the search object the results are written into.
+ */
+struct FSessionSearchEntryEpic
+{
+	/** A handle to the EOS session search. If the search isn't running, the handle will be invalid */
+	EOS_HSessionSearch SearchHandle;
+
+	/** Whether EOS_SessionSearch_Find hasn't called back yet. Until then its context owns the handle */
+	bool bFindPending;
+
+	/** The local session search settings, into which the search results are written */
+	TSharedRef<FOnlineSessionSearch> SessionSearch;
+
+	/** Canonical fingerprint of the search's query. Used to share and cache identical queries */
+	FString Fingerprint;
+
+	/** Search objects that issued an identical query while this search was in flight */
+	TArray<TSharedRef<FOnlineSessionSearch>> SharedSearches;
+
+	/** The number of results EOS returned. INDEX_NONE until the search completed on the backend */
+	int32 NumResults;
+
+	/** The index of the next EOS result to convert */
+	int32 NextResultIndex;
+
+	/** The timer timing out the running search, or expiring the completed search. Zero if none is scheduled */
+	uint64 TimerHandle;
+
+	/** Filter on the compact session flags, applied while converting results. A result passes if (Flags & FlagsMask) == FlagsValue */
+	int64 FlagsMask;
+	int64 FlagsValue;
+
+	FSessionSearchEntryEpic(EOS_HSessionSearch InSearchHandle, TSharedRef<FOnlineSessionSearch> const& InSessionSearch)
+		: SearchHandle(InSearchHandle)
+		, bFindPending(false)
+		, SessionSearch(InSessionSearch)
+		, NumResults(INDEX_NONE)
+		, NextResultIndex(0)
+		, TimerHandle(0)
+		, FlagsMask(0)
+		, FlagsValue(0)
+	{
+	}
+};
+
+/** A single search parameter, converted to EOS */
+struct FPreparedSearchParamEpic
+{
+	/** The parameter. Key and string value are only set once the parameter is passed to EOS */
+	EOS_Sessions_AttributeData Data;
+
+	/** The comparison op of the parameter */
+	EOS_EOnlineComparisonOp ComparisonOp;
+
+	/** Offset of the UTF-8 key in the search's string storage */
+	int32 KeyOffset;
+
+	/** Offset of the UTF-8 value in the search's string storage. INDEX_NONE for non string values */
+	int32 ValueOffset;
+};
+
+/**
+ * The query of a session search, converted to EOS once.
+ * Running the query again only copies the converted parameters into a new EOS search.
+ */
+struct FPreparedSessionSearchEpic
+{
+	/** Canonical fingerprint of the query, see GetSearchFingerprint */
+	FString Fingerprint;
+
+	/** The maximum number of results */
+	int32 MaxSearchResults;
+
+	/** The converted search parameters */
+	TArray<FPreparedSearchParamEpic> Params;
+
+	/** The null terminated UTF-8 keys and string values of the parameters */
+	TArray<ANSICHAR> Strings;
+
+	/** Filter on the compact session flags, which aren't sent to EOS */
+	int64 FlagsMask;
+	int64 FlagsValue;
+
+	/** The search receiving the results of every run. Only set for searches prepared with PrepareSessionSearch */
+	TSharedPtr<FOnlineSessionSearch> SessionSearch;
+
+	/** The player running the search. Only set for searches prepared with PrepareSessionSearch */
+	TSharedPtr<FUniqueNetId const> SearchingPlayerId;
+
+	/** Time in seconds between the end of a run and the start of the next one. Zero if the search only runs on request */
+	double RefreshInterval;
+
+	/** The timer starting the next run. Zero if none is scheduled */
+	uint64 RefreshTimer;
+
+	/** Whether the changes between two runs are reported through the OnSessionSearchResultsChanged delegates */
+	bool bDifferential;
+
+	/** The results of the last successful run of a differential search, keyed by session id */
+	TMap<FString, FOnlineSessionSearchResult> PreviousResults;
+
+	FPreparedSessionSearchEpic()
+		: MaxSearchResults(0)
+		, FlagsMask(0)
+		, FlagsValue(0)
+		, RefreshInterval(0.0)
+		, RefreshTimer(0)
+		, bDifferential(false)
+	{
+	}
+};
+
+/**
+ * A value interned by a UTF-8 string.
+ * Interning caches are keyed by the hash of the string, the string itself resolves hash collisions.
+ */
+template <typename ValueType>
+struct TInternedValueEpic
+{
+	/** The null terminated UTF-8 string the value was created from */
+	TArray<ANSICHAR> Key;
+
+	/** The shared value. Never modified after it was interned */
+	ValueType Value;
+};
+
+/** A session details handle returned by EOS, kept to look up and join the session without another search */
+struct FSessionDetailsCacheEntryEpic
+{
+	/** The handle owned by the cache */
+	EOS_HSessionDetails DetailsHandle;
+
+	/** The time (in platform seconds) the handle was last cached or used. The least recently used handle is released first */
+	double LastUsedTime;
+
+	/** Set for the handles of accepted invites. They're only evicted after unpinned handles, until the session was joined */
+	bool bPinned;
+};
+
+/** The results of a completed session search, kept around to answer identical queries */
+struct FSessionSearchCacheEntryEpic
+{
+	/** The results returned by the search */
+	TArray<FOnlineSessionSearchResult> SearchResults;
+
+	/** The time (in platform seconds) the search completed */
+	double CompletionTime;
+};
+
+/** Locates a single search result inside the session search registry */
+struct FSessionSearchResultLocationEpic
+{
+	/** The id of the search that produced the result */
+	uint64 SearchId;
+
+	/** The index of the result inside the search's result array */
+	int32 ResultIndex;
+};
+
+/** A RegisterPlayers or UnregisterPlayers call waiting for the backend */
+struct FRosterRequestEpic
+{
+	/** Whether the call registered or unregistered players */
+	bool bRegister;
+
+	/** The players the call changed locally */
+	TArray<TSharedRef<const FUniqueNetId>> Players;
+
+	/** Players the call couldn't register, because no slot was free. They never reach the backend */
+	TArray<TSharedRef<const FUniqueNetId>> RejectedPlayers;
+};
+
+/** Roster changes of a session that haven't been sent to the backend yet */
+struct FPendingRosterEpic
+{
+	/** Players to register with the backend */
+	TArray<TSharedRef<const FUniqueNetId>> PlayersToRegister;
+
+	/** Players to unregister from the backend */
+	TArray<TSharedRef<const FUniqueNetId>> PlayersToUnregister;
+
+	/** The calls that produced the changes, in call order */
+	TArray<FRosterRequestEpic> Requests;
+};
+
+/** Roster changes sent to the backend together. Shared by the register and unregister request */
+struct FRosterBatchEpic
+{
+	/** The calls to complete once the backend answered */
+	TArray<FRosterRequestEpic> Requests;
+
+	/** The number of backend requests still waiting for an answer */
+	int32 NumOutstandingCalls;
+
+	/** Whether registering the players succeeded */
+	bool bRegisterSucceeded;
+
+	/** Whether unregistering the players succeeded */
+	bool bUnregisterSucceeded;
+
+	FRosterBatchEpic()
+		: NumOutstandingCalls(0)
+		, bRegisterSucceeded(true)
+		, bUnregisterSucceeded(true)
+	{
+	}
+};
+
+/** The kind of connection a player's slot was taken from */
+enum class ESessionSlotEpic : uint8
+{
+	/** One of the public connections */
+	Public,
+	/** One of the private connections */
+	Private,
+	/** No slot was free. Only happens for players the backend already knows about */
+	None
+};
+
+/** A slot held by a player of a session */
+struct FSlotReservationEpic
+{
+	/** The kind of connection the slot was taken from, so it's given back to the same pool */
+	ESessionSlotEpic Slot;
+
+	/** Whether the player was registered. Unconfirmed reservations expire */
+	bool bConfirmed;
+
+	/** The timer releasing the unconfirmed reservation. Zero once confirmed */
+	uint64 ExpiryTimer;
+
+	FSlotReservationEpic()
+		: Slot(ESessionSlotEpic::None)
+		, bConfirmed(false)
+		, ExpiryTimer(0)
+	{
+	}
+};
+
+/** Session setting changes of a named session waiting to be advertised to the backend */
+struct FSessionAdvertisementEpic
+{
+	/** Whether the local settings changed since they were last pushed */
+	bool bDirty;
+
+	/** Whether the pending changes include the number of slots. These are pushed with priority */
+	bool bSlotsDirty;
+
+	/** Whether an update is on its way to the backend */
+	bool bInFlight;
+
+	/** The time (in platform seconds) the last update was sent */
+	double LastPushTime;
+
+	/** The settings sent with the update in flight */
+	FOnlineSessionSettings InFlightSettings;
+
+	/** UpdateSession calls waiting for the next update */
+	int32 NumQueuedCalls;
+
+	/** UpdateSession calls covered by the update in flight */
+	int32 NumInFlightCalls;
+
+	FSessionAdvertisementEpic()
+		: bDirty(false)
+		, bSlotsDirty(false)
+		, bInFlight(false)
+		, LastPushTime(0.0)
+		, NumQueuedCalls(0)
+		, NumInFlightCalls(0)
+	{
+	}
+};
+
+/** Called when a session search started by the session interface itself completed, instead of the OnFindSessionsComplete delegates */
+typedef TFunction<void(bool bWasSuccessful)> FOnSessionSearchCompleteEpic;
+
+/** Called when a session search started by the session interface itself appended results, instead of the OnFindSessionsResultsAvailable delegates */
+typedef TFunction<void(int32 NumNewResults)> FOnSessionSearchResultsEpic;
+
+/** A session search fanned out across multiple buckets */
+struct FBucketSearchEpic
+{
+	/** The search passed by the game. Receives the merged results of all buckets */
+	TSharedRef<FOnlineSessionSearch> SessionSearch;
+
+	/** One search per bucket, all running in parallel */
+	TArray<TSharedRef<FOnlineSessionSearch>> BucketSearches;
+
+	/** The number of results of each bucket search that were already merged */
+	TArray<int32> NumMergedResults;
+
+	/** Ids of the merged sessions. Every session is only reported once */
+	TSet<FString> SessionIds;
+
+	/** The number of bucket searches still running */
+	int32 NumPendingBuckets;
+
+	/** Whether at least one bucket search succeeded */
+	bool bAnySucceeded;
+
+	/** The timer finishing the search with the results merged so far */
+	uint64 DeadlineTimer;
+
+	FBucketSearchEpic(TSharedRef<FOnlineSessionSearch> const& InSessionSearch)
+		: SessionSearch(InSessionSearch)
+		, NumPendingBuckets(0)
+		, bAnySucceeded(false)
+		, DeadlineTimer(0)
+	{
+	}
+};
+
+/** A FindFriendSession request for a list of friends */
+struct FFriendSessionSearchEpic
+{
+	/** The local user searching */
+	TSharedRef<FUniqueNetId const> LocalUserId;
+
+	/** The friends whose sessions are searched */
+	TArray<TSharedRef<FUniqueNetId const>> Friends;
+
+	/** The index of the next friend to search */
+	int32 NextFriendIndex;
+
+	/** The number of friend searches running */
+	int32 NumInFlight;
+
+	/** The sessions found so far */
+	TArray<FOnlineSessionSearchResult> SearchResults;
+
+	/** Ids of the sessions found so far. Friends playing together only report their session once */
+	TSet<FString> SessionIds;
+
+	/** Whether at least one friend search succeeded */
+	bool bAnySucceeded;
+
+	FFriendSessionSearchEpic(TSharedRef<FUniqueNetId const> const& InLocalUserId)
+		: LocalUserId(InLocalUserId)
+		, NextFriendIndex(0)
+		, NumInFlight(0)
+		, bAnySucceeded(false)
+	{
+	}
+};
+
+/** The stage a matchmaking request is in */
+enum class EMatchmakingStateEpic : uint8
+{
+	/** Waiting for the searches */
+	Searching,
+	/** Joining one of the candidates */
+	Joining,
+	/** Creating a new session, as no candidate was suitable */
+	Creating
+};
+
+/** A running StartMatchmaking request */
+struct FMatchmakingTicketEpic
+{
+	/** Unique id of the request. Keeps callbacks of a cancelled request from affecting a newer one for the same session name */
+	uint64 TicketId;
+
+	/** The player searching, joining or creating the session */
+	TSharedRef<FUniqueNetId const> SearchingPlayerId;
+
+	/** The number of local players that need a slot in the session */
+	int32 NumLocalPlayers;
+
+	/** The settings of the session created if no candidate was suitable */
+	FOnlineSessionSettings NewSessionSettings;
+
+	/** The search passed to StartMatchmaking. Receives the candidates ordered by their score */
+	TSharedRef<FOnlineSessionSearch> SearchSettings;
+
+	/** The searches running in parallel. Each pass has one more search parameter relaxed than the pass before */
+	TArray<TSharedRef<FOnlineSessionSearch>> Passes;
+
+	/** The candidates not yet tried, ordered by their score */
+	TArray<FOnlineSessionSearchResult> Candidates;
+
+	/** The stage the request is in */
+	EMatchmakingStateEpic State;
+
+	/** The time (in platform seconds) the request was started */
+	double StartTime;
+
+	/** The timer ending the search phase */
+	uint64 DeadlineTimer;
+
+	/** The time (in platform seconds) at which the request stops waiting for the pings of its candidates. 0 if it isn't waiting */
+	double PingWaitEndTime;
+
+	FMatchmakingTicketEpic(uint64 InTicketId, TSharedRef<FUniqueNetId const> const& InSearchingPlayerId, TSharedRef<FOnlineSessionSearch> const& InSearchSettings)
+		: TicketId(InTicketId)
+		, SearchingPlayerId(InSearchingPlayerId)
+		, NumLocalPlayers(1)
+		, SearchSettings(InSearchSettings)
+		, State(EMatchmakingStateEpic::Searching)
+		, StartTime(0.0)
+		, DeadlineTimer(0)
+		, PingWaitEndTime(0.0)
+	{
+	}
+};
+
+/** Measurements of completed matchmaking requests */
+struct FMatchmakingStatsEpic
+{
+	/** Requests that joined an existing session */
+	int32 NumJoined;
+
+	/** Requests that created a new session */
+	int32 NumCreated;
+
+	/** Requests that failed or were cancelled */
+	int32 NumFailed;
+
+	/** Time in seconds from StartMatchmaking until the last successful request completed */
+	double LastTimeToMatch;
+
+	/** Sum of the time to match of all successful requests */
+	double TotalTimeToMatch;
+
+	FMatchmakingStatsEpic()
+		: NumJoined(0)
+		, NumCreated(0)
+		, NumFailed(0)
+		, LastTimeToMatch(0.0)
+		, TotalTimeToMatch(0.0)
+	{
+	}
+
+	/** Returns the average time to match of all successful requests */
+	double GetAverageTimeToMatch() const
+	{
+		int32 const numMatched = this->NumJoined + this->NumCreated;
+		return numMatched > 0 ? this->TotalTimeToMatch / numMatched : 0.0;
+	}
+};
+
 /**
  * Interface definition for the online services session services
  * Session services are defined as anything related managing a session
@@ -24,6 +552,26 @@ private:
 	FOnlineSessionEpic()
 		: Subsystem(nullptr)
 		, sessionsHandle(nullptr)
+		, SessionUpdateInterval(0.0)
+		, SessionSlotUpdateInterval(0.0)
+		, NextSessionSearchId(1)
+		, SearchCacheTTL(0.0)
+		, SearchResultsPerTick(0)
+		, SearchRetention(0.0)
+		, SessionDetailsCacheSize(0)
+		, NextBucketSearchId(1)
+		, NextFriendSessionSearchId(1)
+		, FriendSessionSearchWindow(0)
+		, FriendSessionSearchMaxResults(0)
+		, NextMatchmakingTicketId(1)
+		, MatchmakingPasses(0)
+		, MatchmakingTimeout(0.0)
+		, PingPort(0)
+		, bPingSearchResults(false)
+		, bBatchRosterUpdates(false)
+		, SlotReservationTimeout(0.0)
+		, bCompactSessionFlags(false)
+		, NextPreparedSearchId(1)
 	{
 	}
 
@@ -55,7 +603,7 @@ private:
 	static void OnEOSJoinSessionComplete(const EOS_Sessions_JoinSessionCallbackInfo* Data);
 	static void OnEOSRegisterPlayersComplete(const EOS_Sessions_RegisterPlayersCallbackInfo* Data);
 	static void OnEOSUnRegisterPlayersComplete(const EOS_Sessions_UnregisterPlayersCallbackInfo* Data);
-	static void OnEOSFindFriendSessionComplete(const EOS_SessionSearch_FindCallbackInfo* Data);
+	static void OnEOSSessionLookupComplete(const EOS_SessionSearch_FindCallbackInfo* Data);
 	static void OnEOSSendSessionInviteToFriendsComplete(const EOS_Sessions_SendInviteCallbackInfo* Data);
 	static void OnEOSSessionInviteReceived(const EOS_Sessions_SessionInviteReceivedCallbackInfo* Data);
 	static void OnEOSSessionInviteAccepted(const EOS_Sessions_SessionInviteAcceptedCallbackInfo* Data);
@@ -64,46 +612,492 @@ private:
 	// --------
 	// Private Utility methods
 	// --------
-	void UpdateSessionSearchParameters(TSharedRef<FOnlineSessionSearch> const& sessionSearchPtr, EOS_HSessionSearch eosSessionSearch, FString& error);
+	/**
+	 * Converts the query of a session search to EOS search parameters.
+	 * @param SearchingPlayerId - The player running the search
+	 * @param SessionSearch - The search to convert
+	 * @param OutPreparedSearch - Receives the converted query
+	 * @param error - The error message if a parameter couldn't be converted
+	 * @returns - True if every parameter was converted
+	 */
+	bool PrepareSearchParameters(FUniqueNetId const& SearchingPlayerId, FOnlineSessionSearch const& SessionSearch, FPreparedSessionSearchEpic& OutPreparedSearch, FString& error);
+
+	/** Passes the converted search parameters to an EOS session search */
+	void ApplySearchParameters(FPreparedSessionSearchEpic const& PreparedSearch, EOS_HSessionSearch eosSessionSearch);
 
 	bool GetConnectStringFromSessionInfo(TSharedPtr<FOnlineSessionInfoEpic>& SessionInfo, FString& ConnectInfo, int32 PortOverride = 0);
 
 	/**
 	 * Creates EOS Attribute data from UE4s variant data
-	 * @param attributeName - The name for the data.
+	 * @param attributeKey - The UTF-8 encoded name for the data. Must outlive the returned data
 	 * @param variantData - The variable data itself
-	 * @outAttributeData - The EOS AttributeData populated with the variant data
+	 * @param scratch - Arena owning string values. Must not be popped before the returned data was passed to EOS
 	 * @error - The error message if the creation was unsuccessful
-	 * @returns - True if the creation was successful, false otherwise
+	 * @returns - The EOS AttributeData populated with the variant data
 	*/
-	EOS_Sessions_AttributeData CreateEOSAttributeData(FString const attributeName, FVariantData const variantData, FString& error);
+	EOS_Sessions_AttributeData CreateEOSAttributeData(char const* attributeKey, FVariantData const& variantData, class FMemStackBase& scratch, FString& error);
 	
-	/** Sets the session details from the EOS session details struct*/
-	void SetSessionDetails(FOnlineSession* session, EOS_SessionDetails_Info const* SessionDetails);
+	/**
+	 * Sets the session details from the EOS session details struct.
+	 * @param session - The session to update
+	 * @param SessionDetails - The info copied from the details handle
+	 * @param DetailsHandle - Optional. The handle the info was copied from. Used to decode the compact session flags
+	 * @returns - True if the session advertises compact session flags and they were decoded
+	 */
+	bool SetSessionDetails(FOnlineSession* session, EOS_SessionDetails_Info const* SessionDetails, EOS_HSessionDetails DetailsHandle = nullptr);
+
+	/**
+	 * Writes the session settings into a session modification handle.
+	 * @param NewSessionSettings - The settings to push to the backend
+	 * @param PushedSessionSettings - The settings last pushed to the backend. If set, only changes and removals are written
+	 * @param ModificationHandle - The handle to write the settings into
+	 * @param Error - The error message if writing a setting failed
+	 * @returns - The number of changes written to the handle
+	 */
+	int32 CreateSessionModificationHandle(FOnlineSessionSettings const& NewSessionSettings, FOnlineSessionSettings const* PushedSessionSettings, EOS_HSessionModification ModificationHandle, FString& Error);
+
+	// --------
+	// Session advertisement
+	// --------
+	/** Sends the changed settings of a session to the backend */
+	void PushSessionUpdate(FName SessionName);
 
-	/** Creates a pointer to an EOS session update struct from the passed session settings */
-	void CreateSessionModificationHandle(FOnlineSessionSettings const& NewSessionSettings, EOS_HSessionModification& ModificationHandle, FString& Error);
+	/** Triggers the update delegates once for every UpdateSession call covered by an update */
+	void CompleteSessionUpdateCalls(FName SessionName, int32 NumCalls, bool bWasSuccessful);
 
 	/// Convert a String to an Internet address.
 	TPair<bool, TSharedPtr<class FInternetAddr>> StringToInternetAddress(FString addressStr);
 
+	// --------
+	// Session search registry
+	// --------
+
+	/**
+	 * Registers a new session search.
+	 * @param SearchHandle - The EOS handle of the search
+	 * @param SessionSearch - The search object the results are written into
+	 * @returns - The id under which the search was registered
+	 */
+	uint64 AddSessionSearch(EOS_HSessionSearch SearchHandle, TSharedRef<FOnlineSessionSearch> const& SessionSearch);
+
+	/** Removes a session search, releases its EOS handle and drops its results from the index */
+	void RemoveSessionSearch(uint64 SearchId);
+
+	/**
+	 * Detaches the EOS handle from a search, so the search counts as no longer running.
+	 * The handle is released right away, unless EOS_SessionSearch_Find still uses it. Then its callback releases it
+	 */
+	static void ReleaseSearchHandle(FSessionSearchEntryEpic& Search);
+
+	/**
+	 * Removes the completed searches registered for a search object.
+	 * Needs to run before the object's results are cleared, otherwise their index entries can't be found anymore
+	 */
+	void SupersedeSessionSearches(TSharedRef<FOnlineSessionSearch> const& SessionSearch);
+
+	/** Called when a running search exceeded its timeout */
+	void OnSessionSearchTimeout(uint64 SearchId);
+
+	/** Removes a completed search once its retention expired and the search object isn't referenced by anyone else */
+	void ScheduleSearchRetention(uint64 SearchId);
+
+	/** Adds the result at the given index of a search to the session id index */
+	void IndexSearchResult(uint64 SearchId, int32 ResultIndex);
+
+	/**
+	 * Looks up a search result by the id of the session it describes.
+	 * @returns - The search result or nullptr if no search returned a session with that id
+	 */
+	FOnlineSessionSearchResult* FindSearchResultBySessionId(FString const& SessionId);
+
+	/**
+	 * Converts the EOS results of a search into search results
+	 * @param SearchId - The search whose results to convert
+	 * @param MaxResults - The maximum number of results to convert
+	 * @returns - The number of EOS results processed
+	 */
+	int32 ConvertSearchResults(uint64 SearchId, int32 MaxResults);
+
+	/**
+	 * Queues a ping to the host of a search result. The result's ping is updated once the host answered
+	 * @param SessionSearch - The search containing the result
+	 * @param ResultIndex - The index of the result in the search's results
+	 * @returns - True if the ping was queued, false if the host address is unknown or pinging isn't possible
+	 */
+	bool PingSearchResult(TSharedRef<FOnlineSessionSearch> const& SessionSearch, int32 ResultIndex);
+
+	/** Releases the EOS handle of a search, caches its results and fires the completion delegates */
+	void FinishSessionSearch(uint64 SearchId, bool bWasSuccessful);
+
+	/**
+	 * Creates a canonical fingerprint of a search's query.
+	 * Two searches with the same fingerprint return the same results.
+	 * The backend might answer differently depending on who is asking, so the searching player is part of it
+	 * @param SearchingPlayerId - The player running the search
+	 * @param SessionSearch - The search to create the fingerprint for
+	 * @returns - The fingerprint made up of the player, the kind of query, the sorted search parameters and the maximum result count
+	 */
+	static FString GetSearchFingerprint(FUniqueNetId const& SearchingPlayerId, FOnlineSessionSearch const& SessionSearch);
+
+	/**
+	 * Starts a session search on behalf of the session interface itself.
+	 * Completion is reported to the passed callback instead of the OnFindSessionsComplete delegates.
+	 * Runs through FindSessions, so it waits for a running refresh of the player's tokens like any other search.
+	 * @param SearchingPlayerId - The player searching
+	 * @param SessionSearch - The search to run
+	 * @param OnComplete - Called once the search completed. Might be called before this function returns
+	 * @param OnResultsAvailable - Optional. Called every time the search appended results while it's running
+	 * @returns - True if the search was started or answered from the cache
+	 */
+	bool StartInternalSessionSearch(FUniqueNetId const& SearchingPlayerId, TSharedRef<FOnlineSessionSearch> const& SessionSearch, FOnSessionSearchCompleteEpic&& OnComplete, FOnSessionSearchResultsEpic&& OnResultsAvailable = FOnSessionSearchResultsEpic());
+
+	/**
+	 * Runs a session search. Backs FindSessions and prepared searches.
+	 * @param SearchingPlayerId - The player searching
+	 * @param SearchSettings - The search receiving the results
+	 * @param PreparedSearch - Optional. The already converted query. If null, the query of SearchSettings is converted for this run
+	 * @returns - True if the search was started or answered from the cache
+	 */
+	bool RunSessionSearch(FUniqueNetId const& SearchingPlayerId, TSharedRef<FOnlineSessionSearch> const& SearchSettings, FPreparedSessionSearchEpic const* PreparedSearch);
+
+	/** Called when a run of a prepared search completed. Schedules the next run if the search refreshes automatically */
+	void OnPreparedSessionSearchComplete(uint64 PreparedSearchId, bool bWasSuccessful);
+
+	/** Reports the ping of a search result to the differential searches it belongs to, if it changed since their last run */
+	void OnPreparedSearchResultPinged(FOnlineSessionSearch const& SessionSearch, FString const& SessionId, int32 ResultIndex, int32 PingInMs);
+
+	/** Reports the completion of a search, either to its internal completion callback or the OnFindSessionsComplete delegates */
+	void CompleteSessionSearch(TSharedRef<FOnlineSessionSearch> const& SessionSearch, bool bWasSuccessful);
+
+	/** Reports new results of a search, either to its internal results callback or the OnFindSessionsResultsAvailable delegates */
+	void NotifySearchResultsAvailable(TSharedRef<FOnlineSessionSearch> const& SessionSearch, int32 NumNewResults);
+
+	// --------
+	// Bucket search
+	// --------
+	/** Appends the results of a bucket search not merged yet, skipping sessions already found in another bucket */
+	void MergeBucketSearchResults(uint64 BucketSearchId, int32 BucketIndex);
+
+	/** Called when the search of a single bucket completed */
+	void OnBucketSearchComplete(uint64 BucketSearchId, int32 BucketIndex, bool bWasSuccessful);
+
+	/** Removes a bucket search, makes the merged results joinable and fires OnFindSessionsComplete */
+	void FinishBucketSearch(uint64 BucketSearchId);
+
+	// --------
+	// Friend session search
+	// --------
+	/** Starts searches for the next friends of a request, until the window is full or every friend was searched */
+	void StartFriendSessionSearches(uint64 FriendSearchId);
+
+	/**
+	 * Starts the search for the sessions of a single friend
+	 * @param FriendSearchId - The request the friend belongs to
+	 * @param Friend - The friend to search
+	 * @returns - True if the search was started
+	 */
+	bool StartFriendSessionSearch(uint64 FriendSearchId, TSharedRef<FUniqueNetId const> const& Friend);
+
+	/** Called when the search for the sessions of a single friend completed */
+	void OnFriendSessionSearchComplete(uint64 FriendSearchId, TSharedRef<FOnlineSessionSearch> const& FriendSearch, bool bWasSuccessful);
+
+	// --------
+	// Session details cache
+	// --------
+	/**
+	 * Takes ownership of a session details handle, replacing the handle cached for the same session.
+	 * Releases the least recently used handle, if the cache is full.
+	 * @param DetailsHandle - The handle to cache
+	 * @param SessionInfo - The info copied from the handle
+	 * @param bPin - Keeps the handle until the session was joined
+	 */
+	void CacheSessionDetails(EOS_HSessionDetails DetailsHandle, EOS_SessionDetails_Info const* SessionInfo, bool bPin = false);
+
+	/**
+	 * Returns the cached session details handle of a session.
+	 * @param SessionId - The id of the session
+	 * @returns - The handle, still owned by the cache. Null if the session isn't cached
+	 */
+	EOS_HSessionDetails FindCachedSessionDetails(FString const& SessionId);
+
+	/**
+	 * Creates a search result from a session details handle
+	 * @param DetailsHandle - The handle to copy the session info from
+	 * @param OutSearchResult - Receives the session
+	 * @returns - True if the session info could be copied
+	 */
+	bool CreateSearchResultFromDetails(EOS_HSessionDetails DetailsHandle, FOnlineSessionSearchResult& OutSearchResult);
+
+	/**
+	 * Copies the session of an invite into a search result and caches its details handle,
+	 * so JoinSession can join the session straight away.
+	 * @param InviteId - The id of the invite
+	 * @param bPin - Keeps the handle until the session was joined. Set for accepted invites
+	 * @param OutSearchResult - Receives the session
+	 * @returns - True if the session could be copied
+	 */
+	bool CacheInviteSession(char const* InviteId, bool bPin, FOnlineSessionSearchResult& OutSearchResult);
+
+	/**
+	 * Looks up a single session by its id on the backend and caches its details.
+	 * @param SearchingUserId - The player looking up the session
+	 * @param SessionId - The id of the session
+	 * @param OnComplete - Called once the lookup completed. Successful if the session was found and cached
+	 */
+	void LookupSessionById(FUniqueNetId const& SearchingUserId, FString const& SessionId, FOnSessionSearchCompleteEpic&& OnComplete);
+
+	// --------
+	// Matchmaking
+	// --------
+	/** Called when one of the searches of a matchmaking request completed */
+	void OnMatchmakingPassComplete(FName SessionName, uint64 TicketId);
+
+	/** Called when the search phase of a matchmaking request ran out of time */
+	void OnMatchmakingDeadline(FName SessionName, uint64 TicketId);
+
+	/** Evaluates the matchmaking requests whose candidates' pings landed or that waited for them long enough */
+	void TickMatchmakingPingWaits();
+
+	/**
+	 * Collects and scores the candidates of the completed searches.
+	 * @param SessionName - The session name of the matchmaking request
+	 * @param bAllowIncompletePasses - If false, candidates are only picked once all stricter passes completed
+	 * @returns - True if the request moved on to joining or creating a session
+	 */
+	bool EvaluateMatchmaking(FName SessionName, bool bAllowIncompletePasses);
+
+	/** Joins the next candidate of a matchmaking request, or creates a new session if no candidate is left */
+	void JoinNextMatchmakingCandidate(FName SessionName);
+
+	/** Removes a matchmaking request, updates the stats and fires OnMatchmakingComplete */
+	void FinishMatchmaking(FName SessionName, bool bWasSuccessful);
+
+	/**
+	 * Scores a matchmaking candidate. Higher is better.
+	 * @param SearchResult - The candidate
+	 * @param PassIndex - The strictest pass that returned the candidate
+	 * @param NumLocalPlayers - The number of slots needed
+	 * @returns - The score, or a negative value if the candidate has no room for the players
+	 */
+	static float ScoreMatchmakingCandidate(FOnlineSessionSearchResult const& SearchResult, int32 PassIndex, int32 NumLocalPlayers);
+
+	/** Moves matchmaking requests past a finished join attempt */
+	void OnMatchmakingJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result);
+
+	/** Moves matchmaking requests past a finished session creation */
+	void OnMatchmakingCreateSessionComplete(FName SessionName, bool bWasSuccessful);
+
+	/**
+	 * Joins a session without waiting for token refreshes.
+	 * Joins started by matchmaking report to the matchmaker instead of OnJoinSessionComplete
+	 */
+	bool StartJoinSession(const FUniqueNetId& PlayerId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession, bool bForMatchmaking);
+
+	/**
+	 * Creates a session without waiting for token refreshes.
+	 * Sessions created by matchmaking report to the matchmaker instead of OnCreateSessionComplete
+	 */
+	bool StartCreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, bool bForMatchmaking);
+
+	/** Reports a finished join to either the matchmaker or the game */
+	void CompleteJoinSession(FName SessionName, EOnJoinSessionCompleteResult::Type Result, bool bForMatchmaking);
+
+	/** Reports a finished session creation to either the matchmaker or the game */
+	void CompleteCreateSession(FName SessionName, bool bWasSuccessful, bool bForMatchmaking);
+
+	// --------
+	// Roster updates
+	// --------
+	/** Sends the pending roster changes of a session to the backend */
+	void FlushRosterUpdates(FName SessionName);
+
+	/**
+	 * Handles the answer to a batched register or unregister request.
+	 * Reverts the local roster on failure and completes the batch once all its requests were answered.
+	 * @param SessionName - The session the players were (un)registered with
+	 * @param Players - The players sent with the request
+	 * @param Batch - The batch the request belongs to
+	 * @param bRegister - Whether the request registered or unregistered the players
+	 * @param ResultCode - The result of the request
+	 */
+	void OnRosterCallComplete(FName SessionName, TArray<TSharedRef<const FUniqueNetId>> const& Players, TSharedRef<FRosterBatchEpic> const& Batch, bool bRegister, EOS_EResult ResultCode);
+
+	/** Triggers the delegates of all calls in a batch, in call order */
+	void CompleteRosterBatch(FName SessionName, FRosterBatchEpic const& Batch);
+
+	// --------
+	// Slot reservations
+	// --------
+	/**
+	 * Takes a free slot of a session for a player. Invited players take private slots first, everyone else public ones.
+	 * @param Session - The session to take the slot from
+	 * @param PlayerId - The player to take the slot for
+	 * @param bWasInvited - Whether the player was invited
+	 * @param bForce - Tracks the player even if no slot is free. Used for players the backend already admitted
+	 * @returns - True if the player holds a slot now, or already held one
+	 */
+	bool TakeSlot(FNamedOnlineSession& Session, FUniqueNetId const& PlayerId, bool bWasInvited, bool bForce);
+
+	/**
+	 * Gives the slot of a player back to the pool it was taken from. Does nothing if the player holds no slot
+	 * @param Session - The session the slot belongs to
+	 * @param PlayerKey - The string representation of the player's id
+	 */
+	void ReleaseSlot(FNamedOnlineSession& Session, FString const& PlayerKey);
+
+	/** Marks the reservation of a player as confirmed, so it doesn't expire */
+	void ConfirmSlot(FName SessionName, FUniqueNetId const& PlayerId);
+
+	/** Releases an unconfirmed reservation once it expired */
+	void OnSlotReservationExpired(FName SessionName, FString const& PlayerKey);
+
 
 
 PACKAGE_SCOPE:
 
-	/** Critical sections for thread safe operation of session lists */
-	mutable FCriticalSection SessionLock;
+	/**
+	 * Guards the session map. Queries take a shared read lock, adding and removing sessions an exclusive one.
+	 * The lock isn't recursive. It's only held inside the session map accessors, none of which call
+	 * another accessor or a delegate while holding it
+	 */
+	mutable FRWLock SessionLock;
 
-	/** Array of sessions currently available on the local machine. Might not be in sync with remote */
-	TArray<FNamedOnlineSession> Sessions;
+	/**
+	 * Sessions currently available on the local machine. Might not be in sync with remote.
+	 * Sessions are heap allocated, so pointers handed out stay valid until the session is removed.
+	 */
+	TMap<FName, TUniquePtr<FNamedOnlineSession>> Sessions;
+
+	/** The settings last successfully pushed to the backend, keyed by the name of the session */
+	TMap<FName, FOnlineSessionSettings> PushedSessionSettings;
+
+	/** Settings changes waiting to be pushed to the backend, keyed by the name of the session */
+	TMap<FName, FSessionAdvertisementEpic> SessionAdvertisements;
+
+	/** Minimum time in seconds between two updates of a session. Zero pushes every update right away */
+	double SessionUpdateInterval;
+
+	/** Minimum time in seconds between two updates of a session, if the number of slots changed */
+	double SessionSlotUpdateInterval;
+
+	/** Monotonic counter used to hand out session search ids. Zero is never a valid id. */
+	uint64 NextSessionSearchId;
 
 	/**
-	 * Array of session searches.
-	 * @Key - The time in UTC the session search was created.
-	 * @Value1 - A handle to the EOS session search. If the search isn't running, the handle will be invalid
-	 * @Value2 - The local session search settings
+	 * Map of session searches.
+	 * @Key - The id the search was registered with.
+	 * @Value - The EOS session search handle and the local session search settings
 	 */
-	TMap<double, TTuple<EOS_HSessionSearch, TSharedRef<FOnlineSessionSearch>>> SessionSearches;
+	TMap<uint64, FSessionSearchEntryEpic> SessionSearches;
+
+	/**
+	 * Secondary index over all search results.
+	 * @Key - The id of the session a search result describes
+	 * @Value - The search and the index of the result inside it
+	 */
+	TMap<FString, FSessionSearchResultLocationEpic> SearchResultsBySessionId;
+
+	/** Time in seconds for which search results are served from the cache. Zero disables the cache */
+	double SearchCacheTTL;
+
+	/** Results of recently completed searches, keyed by the fingerprint of their query */
+	TMap<FString, FSessionSearchCacheEntryEpic> SearchResultCache;
+
+	/** Ids of the searches that are currently running, keyed by the fingerprint of their query */
+	TMap<FString, uint64> InFlightSearches;
+
+	/** The number of search results converted per tick. Zero converts all results at once */
+	int32 SearchResultsPerTick;
+
+	/** Time in seconds completed searches are kept joinable after they were last referenced by the game */
+	double SearchRetention;
+
+	/** Schedules search timeouts and the expiry of completed searches */
+	FTimerWheelEpic SearchTimers;
+
+	/** The maximum number of session details handles kept */
+	int32 SessionDetailsCacheSize;
+
+	/** Recently seen session details handles, keyed by the session id */
+	TMap<FString, FSessionDetailsCacheEntryEpic> SessionDetailsCache;
+
+	/** Parsed host addresses, keyed by the hash of the address string returned by EOS. Shared by all sessions with the same host */
+	TLruCache<uint32, TInternedValueEpic<TSharedPtr<FInternetAddr>>> HostAddressCache;
+
+	/** Session infos, keyed by the hash of the session id returned by EOS. Shared by all search results for the same session */
+	TLruCache<uint32, TInternedValueEpic<TSharedPtr<FOnlineSessionInfoEpic>>> SessionInfoCache;
+
+	/** Completion callbacks of searches started by the session interface itself, keyed by the search object */
+	TMap<FOnlineSessionSearch const*, FOnSessionSearchCompleteEpic> SearchCompletionHooks;
+
+	/** Results callbacks of searches started by the session interface itself, keyed by the search object */
+	TMap<FOnlineSessionSearch const*, FOnSessionSearchResultsEpic> SearchResultHooks;
+
+	/** Running searches across multiple buckets, keyed by their id */
+	TMap<uint64, FBucketSearchEpic> BucketSearches;
+
+	/** Id of the next search across multiple buckets */
+	uint64 NextBucketSearchId;
+
+	/** Running FindFriendSession requests, keyed by their id */
+	TMap<uint64, FFriendSessionSearchEpic> FriendSessionSearches;
+
+	/** Id of the next FindFriendSession request */
+	uint64 NextFriendSessionSearchId;
+
+	/** The maximum number of friends searched at the same time per request */
+	int32 FriendSessionSearchWindow;
+
+	/** The maximum number of sessions found per friend */
+	int32 FriendSessionSearchMaxResults;
+
+	/** Running matchmaking requests, keyed by the name of the session they join or create */
+	TMap<FName, FMatchmakingTicketEpic> MatchmakingTickets;
+
+	/** Id of the next matchmaking request */
+	uint64 NextMatchmakingTicketId;
+
+	/** The maximum number of searches per matchmaking request */
+	int32 MatchmakingPasses;
+
+	/** Time in seconds after which matchmaking settles for the best candidate found, or creates a session */
+	double MatchmakingTimeout;
+
+	/** Time to match and outcomes of completed matchmaking requests */
+	FMatchmakingStatsEpic MatchmakingStats;
+
+	/** Measures the latency to session hosts. Created when the first ping is sent */
+	TUniquePtr<FOnlineSessionPingEpic> PingClient;
+
+	/** Answers pings from clients. Only created if enabled in the config */
+	TUniquePtr<FOnlineSessionPingResponderEpic> PingResponder;
+
+	/** The port session hosts answer pings on */
+	int32 PingPort;
+
+	/** Whether search results are pinged as soon as they are available */
+	bool bPingSearchResults;
+
+	/** Whether roster changes are collected and sent once per tick, instead of once per call */
+	bool bBatchRosterUpdates;
+
+	/** Roster changes waiting to be sent, keyed by the name of the session */
+	TMap<FName, FPendingRosterEpic> PendingRosterUpdates;
+
+	/** The slots held by players, keyed by the name of the session and then the player id */
+	TMap<FName, TMap<FString, FSlotReservationEpic>> SlotReservations;
+
+	/** Time in seconds after which a slot reserved with ReserveSlot is released, if the player wasn't registered */
+	double SlotReservationTimeout;
+
+	/** When set, the boolean session settings are advertised as a single bit-packed attribute */
+	bool bCompactSessionFlags;
+
+	/** Searches prepared with PrepareSessionSearch, keyed by their id */
+	TMap<uint64, FPreparedSessionSearchEpic> PreparedSearches;
+
+	/** The id of the next prepared search */
+	uint64 NextPreparedSearchId;
 
 	/**
 	 * Creates a new instance of the FOnlineSessionEpic class.
@@ -115,17 +1109,9 @@ PACKAGE_SCOPE:
 	void Tick(float DeltaTime);
 
 	// IOnlineSession
-	class FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings) override
-	{
-		FScopeLock ScopeLock(&SessionLock);
-		return new (Sessions) FNamedOnlineSession(SessionName, SessionSettings);
-	}
-
-	class FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSession& Session) override
-	{
-		FScopeLock ScopeLock(&SessionLock);
-		return new (Sessions) FNamedOnlineSession(SessionName, Session);
-	}
+	// Adding a session under a name that's already taken fails and returns null, the existing session is kept
+	class FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings) override;
+	class FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSession& Session) override;
 
 public:
 
@@ -173,5 +1159,71 @@ public:
 	virtual void UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate) override;
 	virtual int32 GetNumSessions() override;
 	virtual void DumpSessionState() override;
+
+	/**
+	 * Searches multiple buckets, e.g. regions or game modes, in parallel.
+	 * Results are merged into the passed search as they arrive. A session is only reported once, even if multiple buckets returned it.
+	 * The search completes once every bucket was searched, or after the search's TimeoutInSeconds with the results found so far.
+	 * Completion is reported through the OnFindSessionsComplete delegates, new results through the OnFindSessionsResultsAvailable delegates.
+	 * @param SearchingPlayerId - The player searching
+	 * @param BucketIds - The buckets to search. Replaces the bucket id in the search parameters
+	 * @param SearchSettings - The search parameters shared by all buckets. MaxSearchResults applies per bucket
+	 * @returns - True if the searches were started
+	 */
+	bool FindSessionsInBuckets(FUniqueNetId const& SearchingPlayerId, TArray<FString> const& BucketIds, TSharedRef<FOnlineSessionSearch> const& SearchSettings);
+
+	/**
+	 * Converts the query of a session search to EOS once, so it can be run again and again without converting it every time,
+	 * e.g. to refresh a server browser. Later changes to the query settings of the search are ignored.
+	 * @param SearchingPlayerId - The player searching
+	 * @param SearchSettings - The search. Receives the results of every run
+	 * @param RefreshInterval - Time in seconds between the end of a run and the start of the next one. Zero to only run the search on request
+	 * @param bDifferential - Keeps the results of the last run and reports what changed through the OnSessionSearchResultsChanged delegates
+	 * @returns - The id of the prepared search. Zero if the query couldn't be converted
+	 */
+	uint64 PrepareSessionSearch(FUniqueNetId const& SearchingPlayerId, TSharedRef<FOnlineSessionSearch> const& SearchSettings, float RefreshInterval = 0.0f, bool bDifferential = false);
+
+	/**
+	 * Runs a prepared search. Every run completes through the OnFindSessionsComplete delegates, like FindSessions.
+	 * Automatic refreshes start after the first run.
+	 * @param PreparedSearchId - The id returned by PrepareSessionSearch
+	 * @returns - True if the search was started or answered from the cache
+	 */
+	bool ExecutePreparedSessionSearch(uint64 PreparedSearchId);
+
+	/** Stops the automatic refreshes of a prepared search and releases it. A run in progress still completes */
+	void ReleasePreparedSessionSearch(uint64 PreparedSearchId);
+
+	/** Fired every time a run of a differential search changed its results */
+	DEFINE_ONLINE_DELEGATE_TWO_PARAM(OnSessionSearchResultsChanged, uint64, TArray<FSessionResultDeltaEpic> const&);
+
+	/** Fired every time a session search appended a batch of results. With streaming enabled before the search completed */
+	DEFINE_ONLINE_DELEGATE_TWO_PARAM(OnFindSessionsResultsAvailable, TSharedRef<FOnlineSessionSearch> const&, int32);
+
+	/**
+	 * Reserves a slot of a hosted session for a player about to join, e.g. from AGameSession::ApproveLogin.
+	 * The decision is made locally and right away, so concurrent joins can't overbook the session.
+	 * RegisterPlayer(s) confirms the reservation. Unconfirmed reservations are released after SlotReservationTimeout seconds.
+	 * @param SessionName - The session to join
+	 * @param PlayerId - The joining player
+	 * @param bWasInvited - Invited players take private slots first
+	 * @returns - True if the player holds a slot. False if the session is full or doesn't exist
+	 */
+	bool ReserveSlot(FName SessionName, FUniqueNetId const& PlayerId, bool bWasInvited = false);
+
+	/** Releases the reservation of a player that won't be registered, e.g. because the connection failed */
+	void CancelSlotReservation(FName SessionName, FUniqueNetId const& PlayerId);
+
+	/** Fired every time FindFriendSession found the sessions of another friend */
+	DEFINE_ONLINE_DELEGATE_TWO_PARAM(OnFindFriendSessionResultsAvailable, int32, TArray<FOnlineSessionSearchResult> const&);
+
+	/** Fired every time the ping to the host of a search result was measured */
+	DEFINE_ONLINE_DELEGATE_ONE_PARAM(OnSearchResultPingComplete, FOnlineSessionSearchResult const&);
+
+	/** Returns the time to match and outcomes of all matchmaking requests completed so far */
+	FMatchmakingStatsEpic const& GetMatchmakingStats() const
+	{
+		return this->MatchmakingStats;
+	}
 };
 using FOnlineSessionEpicPtr = TSharedPtr<FOnlineSessionEpic, ESPMode::ThreadSafe>;
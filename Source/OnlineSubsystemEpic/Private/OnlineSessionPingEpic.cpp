@@ -0,0 +1,201 @@
+#include "OnlineSessionPingEpic.h"
+#include "OnlineSubsystem.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+#include "IPAddress.h"
+#include "Common/UdpSocketBuilder.h"
+
+/** Size of a probe: The magic number followed by the sequence number */
+static const int32 SessionPingProbeSize = sizeof(uint32) * 2;
+
+// ---------------------------------------------
+// FOnlineSessionPingEpic
+// ---------------------------------------------
+
+FOnlineSessionPingEpic::FOnlineSessionPingEpic(int32 InMaxInFlight, double InTimeout)
+	: Socket(nullptr)
+	, MaxInFlight(FMath::Max(1, InMaxInFlight))
+	, Timeout(InTimeout)
+	, NextSequence(0)
+{
+}
+
+FOnlineSessionPingEpic::~FOnlineSessionPingEpic()
+{
+	if (this->Socket)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(this->Socket);
+		this->Socket = nullptr;
+	}
+}
+
+bool FOnlineSessionPingEpic::Init()
+{
+	// Bind to any free port, answers are sent back to where the probe came from
+	this->Socket = FUdpSocketBuilder(TEXT("EOS session ping"))
+		.AsNonBlocking()
+		.BoundToPort(0)
+		.Build();
+
+	UE_CLOG_ONLINE(!this->Socket, Warning, TEXT("Couldn't create socket for session pings"));
+	return this->Socket != nullptr;
+}
+
+void FOnlineSessionPingEpic::Ping(TSharedRef<FInternetAddr> const& Address, FOnPingComplete const& OnComplete)
+{
+	this->QueuedPings.Add(FPingRequest{ Address, OnComplete, 0.0 });
+}
+
+void FOnlineSessionPingEpic::CancelAll()
+{
+	this->QueuedPings.Empty();
+	this->InFlightPings.Empty();
+}
+
+void FOnlineSessionPingEpic::Tick()
+{
+	if (!this->Socket)
+	{
+		return;
+	}
+
+	// Callbacks are collected and called at the end, so they're free to queue new pings
+	TArray<TPair<FOnPingComplete, int32>> completedPings;
+
+	// Read all answers that arrived since the last tick
+	// One byte larger than a probe, so oversized packets can be detected
+	uint8 buffer[SessionPingProbeSize + 1];
+	int32 bytesRead = 0;
+	TSharedRef<FInternetAddr> sender = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+	while (this->Socket->RecvFrom(buffer, sizeof(buffer), bytesRead, *sender))
+	{
+		// Taken per packet, so answers read late in the loop don't include the time spent on earlier ones
+		double const receiveTime = FPlatformTime::Seconds();
+		if (bytesRead != SessionPingProbeSize)
+		{
+			continue;
+		}
+
+		uint32 magic, sequence;
+		FMemory::Memcpy(&magic, buffer, sizeof(uint32));
+		FMemory::Memcpy(&sequence, buffer + sizeof(uint32), sizeof(uint32));
+		if (magic != SESSION_PING_MAGIC)
+		{
+			continue;
+		}
+
+		if (FPingRequest* request = this->InFlightPings.Find(sequence))
+		{
+			int32 const pingInMs = FMath::RoundToInt((receiveTime - request->SendTime) * 1000.0);
+			completedPings.Emplace(MoveTemp(request->OnComplete), pingInMs);
+			this->InFlightPings.Remove(sequence);
+		}
+	}
+
+	// Time out lost probes
+	double const now = FPlatformTime::Seconds();
+	for (auto it = this->InFlightPings.CreateIterator(); it; ++it)
+	{
+		if (now - it->Value.SendTime > this->Timeout)
+		{
+			completedPings.Emplace(MoveTemp(it->Value.OnComplete), -1);
+			it.RemoveCurrent();
+		}
+	}
+
+	// Fill the in flight window with queued pings
+	int32 const numToSend = FMath::Min(this->QueuedPings.Num(), this->MaxInFlight - this->InFlightPings.Num());
+	for (int32 i = 0; i < numToSend; ++i)
+	{
+		FPingRequest& request = this->QueuedPings[i];
+
+		uint32 const magic = SESSION_PING_MAGIC;
+		uint32 const sequence = this->NextSequence++;
+		FMemory::Memcpy(buffer, &magic, sizeof(uint32));
+		FMemory::Memcpy(buffer + sizeof(uint32), &sequence, sizeof(uint32));
+
+		int32 bytesSent = 0;
+		if (this->Socket->SendTo(buffer, SessionPingProbeSize, bytesSent, *request.Address))
+		{
+			request.SendTime = FPlatformTime::Seconds();
+			this->InFlightPings.Add(sequence, MoveTemp(request));
+		}
+		else
+		{
+			UE_LOG_ONLINE(Verbose, TEXT("Couldn't send session ping to %s"), *request.Address->ToString(true));
+			completedPings.Emplace(MoveTemp(request.OnComplete), -1);
+		}
+	}
+	if (numToSend > 0)
+	{
+		this->QueuedPings.RemoveAt(0, numToSend, false);
+	}
+
+	for (TPair<FOnPingComplete, int32>& completedPing : completedPings)
+	{
+		completedPing.Key(completedPing.Value);
+	}
+}
+
+// ---------------------------------------------
+// FOnlineSessionPingResponderEpic
+// ---------------------------------------------
+
+FOnlineSessionPingResponderEpic::FOnlineSessionPingResponderEpic()
+	: Socket(nullptr)
+{
+}
+
+FOnlineSessionPingResponderEpic::~FOnlineSessionPingResponderEpic()
+{
+	if (this->Socket)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(this->Socket);
+		this->Socket = nullptr;
+	}
+}
+
+bool FOnlineSessionPingResponderEpic::Init(int32 Port)
+{
+	this->Socket = FUdpSocketBuilder(TEXT("EOS session ping responder"))
+		.AsNonBlocking()
+		.AsReusable()
+		.BoundToPort(Port)
+		.Build();
+
+	UE_CLOG_ONLINE(!this->Socket, Warning, TEXT("Couldn't bind session ping responder to port %d"), Port);
+	UE_CLOG_ONLINE(this->Socket, Log, TEXT("Answering session pings on port %d"), Port);
+	return this->Socket != nullptr;
+}
+
+void FOnlineSessionPingResponderEpic::Tick()
+{
+	if (!this->Socket)
+	{
+		return;
+	}
+
+	// One byte larger than a probe, so oversized packets can be detected
+	uint8 buffer[SessionPingProbeSize + 1];
+	int32 bytesRead = 0;
+	TSharedRef<FInternetAddr> sender = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+	while (this->Socket->RecvFrom(buffer, sizeof(buffer), bytesRead, *sender))
+	{
+		// Only answer well formed probes, everything else is dropped
+		if (bytesRead != SessionPingProbeSize)
+		{
+			continue;
+		}
+
+		uint32 magic;
+		FMemory::Memcpy(&magic, buffer, sizeof(uint32));
+		if (magic != SESSION_PING_MAGIC)
+		{
+			continue;
+		}
+
+		// The answer is the unmodified probe
+		int32 bytesSent = 0;
+		this->Socket->SendTo(buffer, SessionPingProbeSize, bytesSent, *sender);
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FSocket;
+class FInternetAddr;
+
+/** Magic number identifying a session ping probe. Spells "EPNG" */
+#define SESSION_PING_MAGIC 0x45504E47
+
+/**
+ * Sends lightweight UDP probes to session hosts and measures the round trip time.
+ * Probes are sent concurrently, bounded by a maximum number of probes in flight.
+ * The remote end needs to run a FOnlineSessionPingResponderEpic.
+ */
+class FOnlineSessionPingEpic
+{
+public:
+	/** Callback for a finished ping. The ping is -1 if the host didn't answer in time */
+	typedef TFunction<void(int32 PingInMs)> FOnPingComplete;
+
+	/**
+	 * Creates a new ping engine
+	 * @param InMaxInFlight - The maximum number of probes waiting for an answer
+	 * @param InTimeout - Time in seconds after which a probe is considered lost
+	 */
+	FOnlineSessionPingEpic(int32 InMaxInFlight, double InTimeout);
+	~FOnlineSessionPingEpic();
+
+	/** Creates the socket used to send the probes. Returns false if the socket couldn't be created */
+	bool Init();
+
+	/**
+	 * Queues a ping to a host
+	 * @param Address - The address, including the port, the host's responder listens on
+	 * @param OnComplete - Called once the ping completed or timed out
+	 */
+	void Ping(TSharedRef<FInternetAddr> const& Address, FOnPingComplete const& OnComplete);
+
+	/** Drops all queued and in flight pings without calling their callbacks */
+	void CancelAll();
+
+	/** Sends queued probes, reads answers and times out lost probes */
+	void Tick();
+
+	/** Returns the number of pings that have been queued, but not yet completed */
+	int32 GetNumOutstanding() const
+	{
+		return this->QueuedPings.Num() + this->InFlightPings.Num();
+	}
+
+	/** Returns the time in seconds after which a probe is considered lost */
+	double GetTimeout() const
+	{
+		return this->Timeout;
+	}
+
+private:
+	/** A single ping, either waiting to be sent or waiting for an answer */
+	struct FPingRequest
+	{
+		/** The address the probe is sent to */
+		TSharedRef<FInternetAddr> Address;
+
+		/** Called once the ping completed */
+		FOnPingComplete OnComplete;
+
+		/** The time (in platform seconds) the probe was sent */
+		double SendTime;
+	};
+
+	/** The socket probes are sent from and answers are received on */
+	FSocket* Socket;
+
+	/** Maximum number of probes in flight */
+	int32 MaxInFlight;
+
+	/** Time in seconds after which a probe is considered lost */
+	double Timeout;
+
+	/** Sequence number for the next probe */
+	uint32 NextSequence;
+
+	/** Pings waiting to be sent, in order */
+	TArray<FPingRequest> QueuedPings;
+
+	/** Sent probes waiting for an answer, keyed by their sequence number */
+	TMap<uint32, FPingRequest> InFlightPings;
+};
+
+/**
+ * Answers session ping probes.
+ * Dedicated servers enable this, so clients can measure their latency to the server.
+ * Only well formed probes are answered and answers are never larger than the request.
+ */
+class FOnlineSessionPingResponderEpic
+{
+public:
+	FOnlineSessionPingResponderEpic();
+	~FOnlineSessionPingResponderEpic();
+
+	/** Binds the responder to a port. Returns false if the socket couldn't be created */
+	bool Init(int32 Port);
+
+	/** Answers all probes that arrived since the last tick */
+	void Tick();
+
+private:
+	/** The socket probes are received on */
+	FSocket* Socket;
+};
@@ -2,6 +2,7 @@
 #include "OnlineIdentityInterfaceEpic.h"
 #include "OnlineSessionInterfaceEpic.h"
 #include "OnlineUserInterfaceEpic.h"
+#include "OperationContextPoolEpic.h"
 #include "Utilities.h"
 #include <string>
 
@@ -370,6 +371,9 @@ bool FOnlineSubsystemEpic::Shutdown()
 	this->IsInit = false;
 	this->PlatformHandle = nullptr;
 
+	// The interfaces drop the contexts of their pending operations when they're destructed
+	int32 const numPendingOperations = FOperationContextPoolEpic::NumOutstanding();
+	UE_CLOG_ONLINE(numPendingOperations > 0, Log, TEXT("Shutting down with %d pending EOS operation(s)"), numPendingOperations);
 
 #define DESTRUCT_INTERFACE(Interface) \
 	if (Interface.IsValid()) \
@@ -429,6 +433,12 @@ bool FOnlineSubsystemEpic::Tick(float DeltaTime)
 		EOS_Platform_Tick(this->PlatformHandle);
 	}
 
+	// Ticked before the other interfaces, so operations waiting for a token refresh are issued within the same frame
+	if (this->IdentityInterface)
+	{
+		this->IdentityInterface->Tick(DeltaTime);
+	}
+
 	if (this->SessionInterface)
 	{
 		this->SessionInterface->Tick(DeltaTime);
@@ -2,6 +2,7 @@
 #include "OnlineSubsystemEpicTypes.h"
 #include "OnlineSubsystemEpic.h"
 #include "Utilities.h"
+#include "OperationContextPoolEpic.h"
 #include "eos_userinfo.h"
 #include "eos_auth.h"
 #include "OnlineIdentityInterfaceEpic.h"
@@ -27,18 +28,23 @@ typedef struct FQueryUserInfoAdditionalData {
 typedef struct FQueryUserIdMappingAdditionalInfo
 {
 	FOnlineUserEpic* OnlineUserPtr;
-	FUniqueNetIdEpic const& LocalUserId;
-	IOnlineUser::FOnQueryUserMappingComplete const& CompletionDelegate;
+	FUniqueNetIdEpic LocalUserId;
+	IOnlineUser::FOnQueryUserMappingComplete CompletionDelegate;
 } FQueryUserIdMappingAdditionalInfo;
 
 typedef struct FQueryExternalIdMappingsAdditionalData {
 	FOnlineUserEpic* OnlineUserPtr;
 	double StartTime;
 	int32 SubQueryIndex;
-	const IOnlineUser::FOnQueryExternalIdMappingsComplete& Delegate;
+	IOnlineUser::FOnQueryExternalIdMappingsComplete Delegate;
 	TSharedRef<FUniqueNetIdEpic const> QueryUserId;
 } FQueryExternalIdMappingsAdditionalData;
 
+/** Contexts of the running operations, passed to the EOS SDK as client data */
+static TOperationContextPoolEpic<FQueryUserInfoAdditionalData> QueryUserInfoContexts(TEXT("QueryUserInfo"));
+static TOperationContextPoolEpic<FQueryUserIdMappingAdditionalInfo> QueryUserIdMappingContexts(TEXT("QueryUserIdMapping"));
+static TOperationContextPoolEpic<FQueryExternalIdMappingsAdditionalData> QueryExternalIdMappingsContexts(TEXT("QueryExternalIdMappings"));
+
 
 // ---------------------------------------------
 // Free functions/Utility functions.
@@ -84,7 +90,12 @@ bool FilterByPredicate(FExternalIdMapping mapping, FString externalId, FExternal
 
 void FOnlineUserEpic::OnEOSQueryUserInfoComplete(EOS_UserInfo_QueryUserInfoCallbackInfo const* Data)
 {
-	FQueryUserInfoAdditionalData* additionalData = (FQueryUserInfoAdditionalData*)Data->ClientData;
+	TOptional<FQueryUserInfoAdditionalData> additionalData = QueryUserInfoContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
 	FOnlineUserEpic* thisPtr = additionalData->OnlineUserPtr;
 	checkf(thisPtr, TEXT("%s called, but \"this\" is missing."), *FString(__FUNCTION__));
 
@@ -192,14 +203,16 @@ void FOnlineUserEpic::OnEOSQueryUserInfoComplete(EOS_UserInfo_QueryUserInfoCallb
 			thisPtr->TriggerOnQueryUserInfoCompleteDelegates(additionalData->LocalUserId, error.IsEmpty(), userIds, completeErrorString);
 		}
 	}
-
-	// Release the memory from additionalUserData
-	delete(additionalData);
 }
 
 void FOnlineUserEpic::OnEOSQueryUserInfoByDisplayNameComplete(EOS_UserInfo_QueryUserInfoByDisplayNameCallbackInfo const* Data)
 {
-	FQueryUserIdMappingAdditionalInfo* additionalData = (FQueryUserIdMappingAdditionalInfo*)Data->ClientData;
+	TOptional<FQueryUserIdMappingAdditionalInfo> additionalData = QueryUserIdMappingContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
 	FOnlineUserEpic* thisPtr = additionalData->OnlineUserPtr;
 	EOS_HConnect connectHandle = EOS_Platform_GetConnectInterface(thisPtr->Subsystem->PlatformHandle);
 
@@ -233,14 +246,16 @@ void FOnlineUserEpic::OnEOSQueryUserInfoByDisplayNameComplete(EOS_UserInfo_Query
 	}
 
 	additionalData->CompletionDelegate.ExecuteIfBound(false, FUniqueNetIdEpic(), FString(), FUniqueNetIdEpic(), error);
-
-	// Release additional memory
-	delete(additionalData);
 }
 
 void FOnlineUserEpic::OnEOSQueryExternalIdMappingsByDisplayNameComplete(EOS_UserInfo_QueryUserInfoByDisplayNameCallbackInfo const* Data)
 {
-	FQueryExternalIdMappingsAdditionalData* additionalData = (FQueryExternalIdMappingsAdditionalData*)Data->ClientData;
+	TOptional<FQueryExternalIdMappingsAdditionalData> additionalData = QueryExternalIdMappingsContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
 	FOnlineUserEpic* thisPtr = additionalData->OnlineUserPtr;
 	EOS_HConnect connectHandle = EOS_Platform_GetConnectInterface(thisPtr->Subsystem->PlatformHandle);
 	
@@ -369,14 +384,16 @@ void FOnlineUserEpic::OnEOSQueryExternalIdMappingsByDisplayNameComplete(EOS_User
 			additionalData->Delegate.ExecuteIfBound(false, localUserNetId, queryOptions, userIds, completeErrorString);
 		}
 	}
-
-	// Release the additionalData memory
-	delete(additionalData);
 }
 
 void FOnlineUserEpic::OnEOSQueryExternalIdMappingsByIdComplete(EOS_UserInfo_QueryUserInfoCallbackInfo const* Data)
 {
-	FQueryExternalIdMappingsAdditionalData* additionalData = (FQueryExternalIdMappingsAdditionalData*)Data->ClientData;
+	TOptional<FQueryExternalIdMappingsAdditionalData> additionalData = QueryExternalIdMappingsContexts.Remove(Data->ClientData);
+	if (!additionalData)
+	{
+		return;
+	}
+
 	FOnlineUserEpic* thisPtr = additionalData->OnlineUserPtr;
 	EOS_HConnect connectHandle = EOS_Platform_GetConnectInterface(thisPtr->Subsystem->PlatformHandle);
 	
@@ -531,9 +548,6 @@ void FOnlineUserEpic::OnEOSQueryExternalIdMappingsByIdComplete(EOS_UserInfo_Quer
 			additionalData->Delegate.ExecuteIfBound(false, localUserNetId, queryOptions, userIds, completeErrorString);
 		}
 	}
-
-	// Release the additionalData memory
-	delete(additionalData);
 }
 
 // ---------------------------------------------
@@ -546,6 +560,12 @@ FOnlineUserEpic::FOnlineUserEpic(FOnlineSubsystemEpic* InSubsystem)
 	this->userInfoHandle = EOS_Platform_GetUserInfoInterface(InSubsystem->PlatformHandle);
 }
 
+FOnlineUserEpic::~FOnlineUserEpic()
+{
+	// Queries still running can't reach this instance anymore
+	FOperationContextPoolEpic::ReleaseAll(this);
+}
+
 void FOnlineUserEpic::Tick(float DeltaTime)
 {
 }
@@ -557,7 +577,7 @@ bool FOnlineUserEpic::QueryUserInfo(int32 LocalUserNum, const TArray<TSharedRef<
 
 	if (UserIds.Num())
 	{
-		if (0 <= LocalUserNum && LocalUserNum < MAX_LOCAL_PLAYERS)
+		if (0 <= LocalUserNum && LocalUserNum < this->Subsystem->IdentityInterface->GetMaxLocalUsers())
 		{
 			// Get the id of the local user specified by the index
 			IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
@@ -593,14 +613,14 @@ bool FOnlineUserEpic::QueryUserInfo(int32 LocalUserNum, const TArray<TSharedRef<
 						   localUserId->ToEpicAccountId(),
 						   targetUserId->ToEpicAccountId()
 						};
-						FQueryUserInfoAdditionalData* additionalData = new FQueryUserInfoAdditionalData{
+						void* clientData = QueryUserInfoContexts.Add(this, FQueryUserInfoAdditionalData{
 							this,
 							LocalUserNum,
 							startTime,
 							i
-						};
+						});
 
-						EOS_UserInfo_QueryUserInfo(this->userInfoHandle, &queryUserInfoOptions, additionalData, &FOnlineUserEpic::OnEOSQueryUserInfoComplete);
+						EOS_UserInfo_QueryUserInfo(this->userInfoHandle, &queryUserInfoOptions, clientData, &FOnlineUserEpic::OnEOSQueryUserInfoComplete);
 
 						result = ONLINE_IO_PENDING;
 					}
@@ -636,7 +656,7 @@ bool FOnlineUserEpic::GetAllUserInfo(int32 LocalUserNum, TArray< TSharedRef<clas
 	FString error;
 	bool success = false;
 
-	if (0 <= LocalUserNum && LocalUserNum < MAX_LOCAL_PLAYERS)
+	if (0 <= LocalUserNum && LocalUserNum < this->Subsystem->IdentityInterface->GetMaxLocalUsers())
 	{
 		IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
 		TSharedPtr<FUniqueNetIdEpic const> localUserNetId = StaticCastSharedPtr<FUniqueNetIdEpic const>(identityPtr->GetUniquePlayerId(LocalUserNum));
@@ -728,7 +748,7 @@ TSharedPtr<FOnlineUser> FOnlineUserEpic::GetUserInfo(int32 LocalUserNum, const c
 	FString error;
 	TSharedPtr<FUserOnlineAccount> localUser = nullptr;
 
-	if (0 <= LocalUserNum && LocalUserNum < MAX_LOCAL_PLAYERS)
+	if (0 <= LocalUserNum && LocalUserNum < this->Subsystem->IdentityInterface->GetMaxLocalUsers())
 	{
 		IOnlineIdentityPtr identityPtr = this->Subsystem->GetIdentityInterface();
 		TSharedPtr<FUniqueNetIdEpic const> localUserId = StaticCastSharedPtr<FUniqueNetIdEpic const>(identityPtr->GetUniquePlayerId(LocalUserNum));
@@ -814,18 +834,18 @@ bool FOnlineUserEpic::QueryUserIdMapping(const FUniqueNetId& UserId, const FStri
 	FUniqueNetIdEpic const epicNetId = static_cast<FUniqueNetIdEpic const>(UserId);
 	if (epicNetId.IsEpicAccountIdValid())
 	{
-		FQueryUserIdMappingAdditionalInfo* additionalInfo = new FQueryUserIdMappingAdditionalInfo{
+		void* clientData = QueryUserIdMappingContexts.Add(this, FQueryUserIdMappingAdditionalInfo{
 			this,
 			epicNetId,
 			Delegate
-		};
+		});
 
 		EOS_UserInfo_QueryUserInfoByDisplayNameOptions queryUserByDisplayNameOptions = {
 			EOS_USERINFO_QUERYUSERINFOBYDISPLAYNAME_API_LATEST,
 			epicNetId.ToEpicAccountId(),
 			TCHAR_TO_UTF8(*DisplayNameOrEmail),
 		};
-		EOS_UserInfo_QueryUserInfoByDisplayName(this->userInfoHandle, &queryUserByDisplayNameOptions, additionalInfo, &FOnlineUserEpic::OnEOSQueryUserInfoByDisplayNameComplete);
+		EOS_UserInfo_QueryUserInfoByDisplayName(this->userInfoHandle, &queryUserByDisplayNameOptions, clientData, &FOnlineUserEpic::OnEOSQueryUserInfoByDisplayNameComplete);
 	}
 	else
 	{
@@ -858,14 +878,18 @@ bool FOnlineUserEpic::QueryExternalIdMappings(const FUniqueNetId& UserId, const
 			TTuple<FExternalIdQueryOptions, TArray<FString>, TArray<bool>, TArray<FString>> queries = MakeTuple(QueryOptions, ExternalIds, states, errors);
 			this->externalIdMappingsQueries.Add(FDateTime::UtcNow().ToUnixTimestamp(), queries);
 
+			// Shared by all sub-queries
+			TSharedRef<FUniqueNetIdEpic const> queryUserId = MakeShared<FUniqueNetIdEpic const>(epicNetId);
+
 			for (int32 i = 0; i < ExternalIds.Num(); ++i)
 			{
 				FString id = ExternalIds[i];
-				FQueryExternalIdMappingsAdditionalData* additionalData = new FQueryExternalIdMappingsAdditionalData{
+				FQueryExternalIdMappingsAdditionalData additionalData = {
 					this,
 					startTime,
 					i,
-					Delegate
+					Delegate,
+					queryUserId
 				};
 
 				if (QueryOptions.bLookupByDisplayName)
@@ -875,7 +899,8 @@ bool FOnlineUserEpic::QueryExternalIdMappings(const FUniqueNetId& UserId, const
 						epicNetId.ToEpicAccountId(),
 						TCHAR_TO_UTF8(*id)
 					};
-					EOS_UserInfo_QueryUserInfoByDisplayName(this->userInfoHandle, &queryByDisplaynameOptions, additionalData, &FOnlineUserEpic::OnEOSQueryExternalIdMappingsByDisplayNameComplete);
+					void* clientData = QueryExternalIdMappingsContexts.Add(this, MoveTemp(additionalData));
+					EOS_UserInfo_QueryUserInfoByDisplayName(this->userInfoHandle, &queryByDisplaynameOptions, clientData, &FOnlineUserEpic::OnEOSQueryExternalIdMappingsByDisplayNameComplete);
 
 					success = true;
 				}
@@ -889,7 +914,8 @@ bool FOnlineUserEpic::QueryExternalIdMappings(const FUniqueNetId& UserId, const
 							epicNetId.ToEpicAccountId(),
 							//eaid
 						};
-						EOS_UserInfo_QueryUserInfo(this->userInfoHandle, &queryByIdOtios, additionalData, &FOnlineUserEpic::OnEOSQueryExternalIdMappingsByIdComplete);
+						void* clientData = QueryExternalIdMappingsContexts.Add(this, MoveTemp(additionalData));
+						EOS_UserInfo_QueryUserInfo(this->userInfoHandle, &queryByIdOtios, clientData, &FOnlineUserEpic::OnEOSQueryExternalIdMappingsByIdComplete);
 
 						success = true;
 					}
@@ -104,6 +104,8 @@ PACKAGE_SCOPE:
 	 */
 	FOnlineUserEpic(FOnlineSubsystemEpic* InSubsystem);
 
+	virtual ~FOnlineUserEpic();
+
 	/** Session tick for various background */
 	void Tick(float DeltaTime);
 
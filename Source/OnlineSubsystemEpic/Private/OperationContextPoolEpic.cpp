@@ -0,0 +1,47 @@
+#include "OperationContextPoolEpic.h"
+#include "OnlineSubsystem.h"
+
+FOperationContextPoolEpic::FOperationContextPoolEpic(TCHAR const* InName)
+	: Name(InName)
+{
+	GetPools().Add(this);
+}
+
+FOperationContextPoolEpic::~FOperationContextPoolEpic()
+{
+	GetPools().RemoveSingleSwap(this, false);
+}
+
+int32 FOperationContextPoolEpic::NumOutstanding(void const* Owner)
+{
+	int32 numOutstanding = 0;
+	for (FOperationContextPoolEpic const* pool : GetPools())
+	{
+		numOutstanding += pool->NumOwnedBy(Owner);
+	}
+	return numOutstanding;
+}
+
+int32 FOperationContextPoolEpic::ReleaseAll(void const* Owner)
+{
+	int32 numReleased = 0;
+	for (FOperationContextPoolEpic* pool : GetPools())
+	{
+		int32 const numPoolReleased = pool->ReleaseOwnedBy(Owner);
+		UE_CLOG_ONLINE(numPoolReleased > 0, Log, TEXT("Dropped %d pending %s operation(s). Their callbacks are ignored."), numPoolReleased, pool->Name);
+		numReleased += numPoolReleased;
+	}
+	return numReleased;
+}
+
+void FOperationContextPoolEpic::LogStaleCallback(void* ClientData) const
+{
+	UE_LOG_ONLINE(Verbose, TEXT("Ignoring callback of completed or released %s operation (handle 0x%llx)"), this->Name, static_cast<uint64>(reinterpret_cast<UPTRINT>(ClientData)));
+}
+
+TArray<FOperationContextPoolEpic*>& FOperationContextPoolEpic::GetPools()
+{
+	// Function local, so pools defined as statics in other files can register during static initialization
+	static TArray<FOperationContextPoolEpic*> pools;
+	return pools;
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+#include "Templates/Function.h"
+
+/**
+ * Base of all operation context pools.
+ * Keeps track of every pool, so pending operations can be counted and released for an owner at once.
+ * Pools aren't thread safe. They're only used from the game thread, where the EOS SDK calls its callbacks.
+ */
+class FOperationContextPoolEpic
+{
+public:
+	/**
+	 * Counts the operations that were started, but haven't completed yet
+	 * @param Owner - The object that started the operations. Nullptr counts the operations of all owners
+	 * @returns - The number of pending operations in all pools
+	 */
+	static int32 NumOutstanding(void const* Owner = nullptr);
+
+	/**
+	 * Drops the contexts of all pending operations started by an owner.
+	 * Callbacks that arrive for these operations later on are ignored.
+	 * Contexts owning SDK handles release them through their pool's release callback.
+	 * @param Owner - The object that started the operations
+	 * @returns - The number of dropped operations
+	 */
+	static int32 ReleaseAll(void const* Owner);
+
+protected:
+	/**
+	 * Registers a new pool
+	 * @param InName - Name of the operations stored in the pool, used when logging
+	 */
+	FOperationContextPoolEpic(TCHAR const* InName);
+
+	virtual ~FOperationContextPoolEpic();
+
+	/** Returns the number of pending operations started by Owner, or all pending operations if Owner is nullptr */
+	virtual int32 NumOwnedBy(void const* Owner) const = 0;
+
+	/** Drops all pending operations started by Owner and returns how many were dropped */
+	virtual int32 ReleaseOwnedBy(void const* Owner) = 0;
+
+	/** Logs that a callback arrived for an operation that already completed or was released */
+	void LogStaleCallback(void* ClientData) const;
+
+	/** Name of the operations stored in the pool */
+	TCHAR const* Name;
+
+private:
+	/** All pools that currently exist */
+	static TArray<FOperationContextPoolEpic*>& GetPools();
+};
+
+/**
+ * Stores the contexts of running EOS operations.
+ * Instead of a pointer to a heap allocated context, the EOS SDK gets a handle made of the context's slot and the slot's generation.
+ * Slots are allocated in slabs and reused once their operation completed, so starting an operation doesn't allocate after warm up.
+ * Every reuse of a slot bumps its generation, so a handle of a completed or released operation never resolves to another context.
+ * Slabs never move, pointers returned by Find stay valid until their context is removed.
+ */
+template <typename ContextType>
+class TOperationContextPoolEpic
+	: public FOperationContextPoolEpic
+{
+public:
+	/**
+	 * Creates a new pool
+	 * @param InName - Name of the operations stored in the pool, used when logging
+	 * @param InOnRelease - Optional. Called for every context dropped by ReleaseAll, e.g. to release the SDK handles it owns
+	 * @param InSlabSize - The number of slots allocated at once
+	 */
+	TOperationContextPoolEpic(TCHAR const* InName, TFunction<void(ContextType&)>&& InOnRelease = nullptr, int32 InSlabSize = 16)
+		: FOperationContextPoolEpic(InName)
+		, OnRelease(MoveTemp(InOnRelease))
+		, SlabSize(FMath::Max(1, InSlabSize))
+		, NumUsed(0)
+	{
+	}
+
+	/**
+	 * Stores the context of a new operation
+	 * @param Owner - The object starting the operation
+	 * @param Context - The context passed to the operation's callback
+	 * @returns - The handle to pass to the EOS SDK as client data. Never null
+	 */
+	void* Add(void const* Owner, ContextType&& Context)
+	{
+		if (this->FreeSlots.Num() == 0)
+		{
+			int32 const firstIndex = this->Slabs.Num() * this->SlabSize;
+			this->Slabs.Add(MakeUnique<FSlot[]>(this->SlabSize));
+
+			// Hand out the slots of a new slab in ascending order
+			this->FreeSlots.Reserve(this->Slabs.Num() * this->SlabSize);
+			for (int32 i = this->SlabSize - 1; i >= 0; --i)
+			{
+				this->FreeSlots.Add(firstIndex + i);
+			}
+		}
+
+		int32 const index = this->FreeSlots.Pop(false);
+		FSlot& slot = this->GetSlot(index);
+		slot.Context.Emplace(MoveTemp(Context));
+		slot.Owner = Owner;
+		++this->NumUsed;
+
+		return reinterpret_cast<void*>((static_cast<UPTRINT>(slot.Generation) << IndexBits) | static_cast<UPTRINT>(index + 1));
+	}
+
+	/**
+	 * Looks up the context of a running operation, without completing the operation.
+	 * Used by callbacks that are called multiple times for the same operation.
+	 * @param ClientData - The client data returned by the EOS SDK
+	 * @returns - The operation's context, or nullptr if the operation already completed or was released
+	 */
+	ContextType* Find(void* ClientData)
+	{
+		FSlot* slot = this->Resolve(ClientData);
+		return slot ? &slot->Context.GetValue() : nullptr;
+	}
+
+	/**
+	 * Completes an operation and returns its context. The handle becomes stale afterwards
+	 * @param ClientData - The client data returned by the EOS SDK
+	 * @returns - The operation's context, or an unset optional if the operation already completed or was released
+	 */
+	TOptional<ContextType> Remove(void* ClientData)
+	{
+		TOptional<ContextType> context;
+		if (FSlot* slot = this->Resolve(ClientData))
+		{
+			context.Emplace(MoveTemp(slot->Context.GetValue()));
+			this->FreeSlot(static_cast<int32>((reinterpret_cast<UPTRINT>(ClientData) & IndexMask) - 1));
+		}
+		else
+		{
+			this->LogStaleCallback(ClientData);
+		}
+		return context;
+	}
+
+	/** Returns the number of running operations */
+	int32 Num() const
+	{
+		return this->NumUsed;
+	}
+
+protected:
+	virtual int32 NumOwnedBy(void const* Owner) const override
+	{
+		if (!Owner)
+		{
+			return this->NumUsed;
+		}
+
+		int32 numOwned = 0;
+		for (int32 i = 0; i < this->Slabs.Num() * this->SlabSize; ++i)
+		{
+			FSlot const& slot = this->GetSlot(i);
+			if (slot.Context.IsSet() && slot.Owner == Owner)
+			{
+				++numOwned;
+			}
+		}
+		return numOwned;
+	}
+
+	virtual int32 ReleaseOwnedBy(void const* Owner) override
+	{
+		int32 numReleased = 0;
+		for (int32 i = 0; i < this->Slabs.Num() * this->SlabSize; ++i)
+		{
+			FSlot& slot = this->GetSlot(i);
+			if (slot.Context.IsSet() && slot.Owner == Owner)
+			{
+				if (this->OnRelease)
+				{
+					this->OnRelease(slot.Context.GetValue());
+				}
+				this->FreeSlot(i);
+				++numReleased;
+			}
+		}
+		return numReleased;
+	}
+
+private:
+	/** A single context and the generation used to validate handles to it */
+	struct FSlot
+	{
+		/** The context of the running operation. Unset if the slot is free */
+		TOptional<ContextType> Context;
+
+		/** The object that started the operation */
+		void const* Owner = nullptr;
+
+		/** Incremented every time the slot is freed */
+		uint32 Generation = 0;
+	};
+
+	/** The lower half of a handle stores the slot index plus one, the upper half the slot's generation */
+	static constexpr int32 IndexBits = sizeof(UPTRINT) * 4;
+	static constexpr UPTRINT IndexMask = (static_cast<UPTRINT>(1) << IndexBits) - 1;
+
+	FSlot& GetSlot(int32 Index)
+	{
+		return this->Slabs[Index / this->SlabSize][Index % this->SlabSize];
+	}
+
+	FSlot const& GetSlot(int32 Index) const
+	{
+		return this->Slabs[Index / this->SlabSize][Index % this->SlabSize];
+	}
+
+	/** Returns the slot a handle refers to, if the handle isn't stale */
+	FSlot* Resolve(void* ClientData)
+	{
+		UPTRINT const handle = reinterpret_cast<UPTRINT>(ClientData);
+		UPTRINT const index = (handle & IndexMask) - 1;
+		if (index >= static_cast<UPTRINT>(this->Slabs.Num() * this->SlabSize))
+		{
+			return nullptr;
+		}
+
+		// On 32 bit platforms the generation is truncated to the upper half of the handle by the shift
+		FSlot& slot = this->GetSlot(static_cast<int32>(index));
+		bool const bSameGeneration = (static_cast<UPTRINT>(slot.Generation) << IndexBits) == (handle & ~IndexMask);
+		return slot.Context.IsSet() && bSameGeneration ? &slot : nullptr;
+	}
+
+	/** Destroys the context in a slot and makes the slot available again */
+	void FreeSlot(int32 Index)
+	{
+		FSlot& slot = this->GetSlot(Index);
+		slot.Context.Reset();
+		slot.Owner = nullptr;
+		++slot.Generation;
+		--this->NumUsed;
+		this->FreeSlots.Add(Index);
+	}
+
+	/** Called for every context dropped by ReleaseOwnedBy */
+	TFunction<void(ContextType&)> OnRelease;
+
+	/** The number of slots in each slab */
+	int32 SlabSize;
+
+	/** The number of slots in use */
+	int32 NumUsed;
+
+	/** Fixed size blocks of slots. Only ever grows */
+	TArray<TUniquePtr<FSlot[]>> Slabs;
+
+	/** Indices of the unused slots. The slot used next is at the end */
+	TArray<int32> FreeSlots;
+};
@@ -0,0 +1,69 @@
+#include "TimerWheelEpic.h"
+
+FTimerWheelEpic::FTimerWheelEpic(double InResolution, int32 InNumSlots)
+	: Resolution(InResolution)
+	, Accumulator(0.0)
+	, CurrentTick(0)
+	, NextHandle(1)
+{
+	check(InResolution > 0.0);
+	this->Slots.SetNum(FMath::Max(1, InNumSlots));
+}
+
+uint64 FTimerWheelEpic::Schedule(double DelayInSeconds, FOnTimerExpired&& OnExpired)
+{
+	uint64 const numSlots = this->Slots.Num();
+
+	// A timer expires at the earliest with the next slot
+	double const delay = FMath::CeilToDouble(FMath::Max(0.0, DelayInSeconds) / this->Resolution);
+	uint64 const delayInTicks = FMath::Max<uint64>(1, static_cast<uint64>(delay));
+	uint64 const slot = (this->CurrentTick + delayInTicks) % numSlots;
+
+	uint64 const timerHandle = this->NextHandle++;
+	this->Timers.Add(timerHandle, FTimer{ MoveTemp(OnExpired), static_cast<uint32>((delayInTicks - 1) / numSlots) });
+	this->Slots[slot].Add(timerHandle);
+	return timerHandle;
+}
+
+bool FTimerWheelEpic::Cancel(uint64 TimerHandle)
+{
+	// The handle stays in its slot, it's skipped once the slot is processed
+	return this->Timers.Remove(TimerHandle) > 0;
+}
+
+void FTimerWheelEpic::Tick(float DeltaTime)
+{
+	// Callbacks are collected and called at the end, so they're free to schedule and cancel timers
+	TArray<FOnTimerExpired> expiredTimers;
+
+	this->Accumulator += DeltaTime;
+	while (this->Accumulator >= this->Resolution)
+	{
+		this->Accumulator -= this->Resolution;
+		++this->CurrentTick;
+
+		TArray<uint64>& slot = this->Slots[this->CurrentTick % this->Slots.Num()];
+		for (int32 i = slot.Num() - 1; i >= 0; --i)
+		{
+			FTimer* timer = this->Timers.Find(slot[i]);
+			if (timer && timer->Rounds > 0)
+			{
+				// Expires on a later turn of the wheel
+				--timer->Rounds;
+				continue;
+			}
+
+			if (timer)
+			{
+				expiredTimers.Add(MoveTemp(timer->OnExpired));
+				this->Timers.Remove(slot[i]);
+			}
+			slot.RemoveAtSwap(i, 1, false);
+		}
+	}
+
+	for (FOnTimerExpired& onExpired : expiredTimers)
+	{
+		onExpired();
+	}
+}
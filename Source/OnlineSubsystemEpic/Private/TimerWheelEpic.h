@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Hashed timer wheel.
+ * Timers are hashed into a fixed number of slots by their expiry tick.
+ * Advancing the wheel only visits the slots that passed, so the work per tick
+ * doesn't depend on the number of scheduled timers. Cancelling a timer is O(1).
+ */
+class FTimerWheelEpic
+{
+public:
+	/** Called once a timer expired */
+	typedef TFunction<void()> FOnTimerExpired;
+
+	/**
+	 * Creates a new timer wheel
+	 * @param InResolution - The length of a single slot in seconds. Timers expire with this precision
+	 * @param InNumSlots - The number of slots. Timers further out than a full turn of the wheel wait for multiple turns
+	 */
+	FTimerWheelEpic(double InResolution = 0.1, int32 InNumSlots = 256);
+
+	/**
+	 * Schedules a new timer
+	 * @param DelayInSeconds - The time after which the timer expires. Rounded up to the wheel's resolution
+	 * @param OnExpired - Called once the timer expired
+	 * @returns - The handle of the timer. Never zero
+	 */
+	uint64 Schedule(double DelayInSeconds, FOnTimerExpired&& OnExpired);
+
+	/**
+	 * Cancels a timer without calling its callback
+	 * @param TimerHandle - The handle returned when the timer was scheduled
+	 * @returns - True if the timer was still scheduled, false otherwise
+	 */
+	bool Cancel(uint64 TimerHandle);
+
+	/** Advances the wheel and calls the callbacks of all timers that expired */
+	void Tick(float DeltaTime);
+
+	/** Returns the number of scheduled timers */
+	int32 Num() const
+	{
+		return this->Timers.Num();
+	}
+
+private:
+	/** A single scheduled timer */
+	struct FTimer
+	{
+		/** Called once the timer expired */
+		FOnTimerExpired OnExpired;
+
+		/** The number of times the timer's slot has to pass before the timer expires */
+		uint32 Rounds;
+	};
+
+	/** The length of a single slot in seconds */
+	double Resolution;
+
+	/** Time passed since the last slot was processed */
+	double Accumulator;
+
+	/** The number of slots processed since the wheel was created */
+	uint64 CurrentTick;
+
+	/** Handle for the next timer */
+	uint64 NextHandle;
+
+	/**
+	 * The handles of the timers expiring in each slot.
+	 * Cancelled timers are only removed from the timer map and skipped once their slot is processed.
+	 */
+	TArray<TArray<uint64>> Slots;
+
+	/** All scheduled timers, keyed by their handle */
+	TMap<uint64, FTimer> Timers;
+};
@@ -69,7 +69,7 @@ namespace FUtils
 		{
 			return MakeTuple(EOS_EExternalCredentialType::EOS_ECT_OPENID_ACCESS_TOKEN, true);
 		}
-		else if (InputString.Equals(TEXT("device"), ESearchCase::IgnoreCase))
+		else if (InputString.Equals(TEXT("device"), ESearchCase::IgnoreCase) || InputString.Equals(TEXT("deviceid"), ESearchCase::IgnoreCase))
 		{
 			return MakeTuple(EOS_EExternalCredentialType::EOS_ECT_DEVICEID_ACCESS_TOKEN, true);
 		}